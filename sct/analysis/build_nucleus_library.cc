@@ -0,0 +1,105 @@
+/* Builds a library of nucleon configurations for one nucleus setting, to be
+ * used by MCGlauber::setNucleusLibrary() instead of building the nuclei
+ * during the run:
+ *
+ * build_nucleus_library --species=au197 --repulsion=0.4 --configurations=1e5
+ *                       --output=au197_r04.bin
+ *
+ * Configurations are generated unrotated - they are given a random rotation
+ * each time they are used. See nucleus_library.h for the file format.
+ */
+
+#include "sct/glauber/nucleus.h"
+#include "sct/glauber/nucleus_library.h"
+#include "sct/lib/enumerations.h"
+#include "sct/lib/flags.h"
+#include "sct/lib/logging.h"
+#include "sct/utils/random.h"
+
+#include <string>
+
+// program settings
+SCT_DEFINE_string(output, "nucleus_library.bin", "path of the library file");
+SCT_DEFINE_string(species, "au197", "nucleus species");
+SCT_DEFINE_bool(deformation, false, "turn on nucleus deformation");
+SCT_DEFINE_string(modification, "nominal",
+                  "glauber modification of the nucleus parameters "
+                  "(nominal, large, small)");
+SCT_DEFINE_int64(configurations, 100000, "number of configurations");
+SCT_DEFINE_double(repulsion, 0.0, "nucleon repulsion distance [fm]");
+SCT_DEFINE_string(smearing, "none",
+                  "nucleon position smearing (none, hardcore, gaussian)");
+SCT_DEFINE_double(smear_area, 4.2,
+                  "NN cross section [fm^2] that defines the hard core "
+                  "smearing profile");
+SCT_DEFINE_int(seed, -1, "random seed - a random seed is used if negative");
+
+int main(int argc, char *argv[]) {
+  std::string usage = "Builds a library of nucleon configurations for ";
+  usage += "MCGlauber.";
+  sct::SetUsageMessage(usage);
+
+  sct::InitLogging(&argc, argv);
+  sct::ParseCommandLineFlags(&argc, argv);
+
+  // read nucleus type from command line arguments
+  sct::GlauberSpecies species;
+  if (FLAGS_species == "Au197" || FLAGS_species == "au197")
+    species = sct::GlauberSpecies::Au197;
+  else if (FLAGS_species == "Sm154" || FLAGS_species == "sm154")
+    species = sct::GlauberSpecies::Sm154;
+  else if (FLAGS_species == "U238" || FLAGS_species == "u238")
+    species = sct::GlauberSpecies::U238;
+  else if (FLAGS_species == "Pb208" || FLAGS_species == "pb208")
+    species = sct::GlauberSpecies::Pb208;
+  else if (FLAGS_species == "Cu63" || FLAGS_species == "cu63")
+    species = sct::GlauberSpecies::Cu63;
+  else {
+    LOG(ERROR) << "Requested unknown nucleus: exiting";
+    return 1;
+  }
+
+  if (sct::stringToGlauberMod.count(FLAGS_modification) == 0) {
+    LOG(ERROR) << "Requested unknown modification: exiting";
+    return 1;
+  }
+  sct::GlauberMod mod = sct::stringToGlauberMod[FLAGS_modification];
+
+  sct::NucleonSmearing smearing;
+  if (FLAGS_smearing == "none")
+    smearing = sct::NucleonSmearing::None;
+  else if (FLAGS_smearing == "hardcore")
+    smearing = sct::NucleonSmearing::HardCore;
+  else if (FLAGS_smearing == "gaussian")
+    smearing = sct::NucleonSmearing::Gaussian;
+  else {
+    LOG(ERROR) << "Requested unknown nucleon smearing: exiting";
+    return 1;
+  }
+
+  if (FLAGS_configurations <= 0) {
+    LOG(ERROR) << "number of configurations must be positive: exiting";
+    return 1;
+  }
+
+  sct::Random::instance().seed(FLAGS_seed);
+
+  sct::Nucleus nucleus(species, mod, FLAGS_deformation);
+  nucleus.setRepulsionDistance(FLAGS_repulsion);
+  nucleus.setNucleonSmearing(smearing, FLAGS_smear_area);
+  nucleus.setQAMode(sct::NucleusQA::Off);
+
+  LOG(INFO) << "building " << FLAGS_configurations << " configurations of "
+            << FLAGS_species << " into " << FLAGS_output;
+  if (!sct::BuildNucleusLibrary(nucleus, FLAGS_configurations,
+                                FLAGS_output)) {
+    LOG(ERROR) << "failed to build the library: exiting";
+    return 1;
+  }
+
+  LOG(INFO) << "library written, " << nucleus.repulsionRejections()
+            << " of " << nucleus.repulsionCandidates()
+            << " nucleon candidates rejected by the repulsion distance";
+  gflags::ShutDownCommandLineFlags();
+  return 0;
+}
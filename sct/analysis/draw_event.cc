@@ -319,7 +319,7 @@ double GetParticipantPlane(sct::Nucleus *nucleus1, sct::Nucleus *nucleus2,
 
   for (auto &nucleus : {nucleus1, nucleus2})
     for (int i = 0; i < nucleus->size(); ++i) {
-      sct::Nucleon &n = (*nucleus)[i];
+      auto n = (*nucleus)[i];
       if (n.nColl() == 0)
         continue;
       mQx += cos(n.phi() * order);
@@ -429,7 +429,7 @@ void PrintEvent(sct::MCGlauber &gen, std::string outFile, std::string nameA,
 
   // draw nucleons in first nucleus
   for (int i = 0; i < gen.nucleusA()->size(); ++i) {
-    sct::Nucleon &n = (*gen.nucleusA())[i];
+    auto n = (*gen.nucleusA())[i];
     double x = n.x();
     double y = n.y();
     TEllipse t(x, y, nucleon_radius, nucleon_radius);
@@ -442,7 +442,7 @@ void PrintEvent(sct::MCGlauber &gen, std::string outFile, std::string nameA,
 
   // draw nucleons in second nucleus
   for (int i = 0; i < gen.nucleusB()->size(); ++i) {
-    sct::Nucleon &n = (*gen.nucleusB())[i];
+    auto n = (*gen.nucleusB())[i];
     double x = n.x();
     double y = n.y();
     TEllipse t(x, y, nucleon_radius, nucleon_radius);
@@ -68,6 +68,9 @@ SCT_DEFINE_bool(useStGlauberChi2, true,
 SCT_DEFINE_bool(useStGlauberNorm, true,
                 "use StGlauber Normalization instead of integral norm");
 SCT_DEFINE_double(trigBias, 1.0, "trigger bias");
+SCT_DEFINE_bool(fastMultiplicity, false,
+                "sample the multiplicity model with one NBD & binomial draw "
+                "per event, instead of the StGlauber per-track sampling");
 SCT_DEFINE_int(minMult, 100,
                "minimum multiplicity for chi2 comparisons in fit");
 SCT_DEFINE_int(seed, 252452, "seed for sct RNG");
@@ -126,6 +129,8 @@ int main(int argc, char *argv[]) {
   fitter.minimumMultiplicityCut(FLAGS_minMult);
   fitter.useStGlauberChi2(FLAGS_useStGlauberChi2);
   fitter.useStGlauberNorm(FLAGS_useStGlauberNorm);
+  if (FLAGS_fastMultiplicity)
+    fitter.setMultiplicitySampling(sct::MultiplicitySampling::Fast);
   sct::Random::instance().seed(FLAGS_seed);
 
   // scan
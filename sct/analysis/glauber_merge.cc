@@ -0,0 +1,54 @@
+/* Merges the outputs of several run_glauber jobs with the same settings (for
+ * instance, the same job run with different seeds on many batch nodes) into
+ * a single GlauberTree file, with one header entry for the merged sample:
+ *
+ * glauber_merge --output=glauber_merged.root shard_0.root shard_1.root ...
+ *
+ * The event counters are summed, the total cross section is recomputed for
+ * the merged sample, and the QA histograms are added.
+ */
+
+#include "sct/glauber/glauber_merge.h"
+#include "sct/lib/flags.h"
+#include "sct/lib/logging.h"
+#include "sct/lib/string/string_utils.h"
+
+#include <string>
+#include <vector>
+
+// program settings
+SCT_DEFINE_string(output, "glauber_merged.root",
+                  "path of the merged output ROOT file");
+SCT_DEFINE_string(inputs, "",
+                  "comma separated list of input files - files can also be "
+                  "given as arguments after the flags");
+
+int main(int argc, char *argv[]) {
+  std::string usage = "Merges GlauberTree files from run_glauber into a ";
+  usage += "single file, with a combined header & cross section.";
+  sct::SetUsageMessage(usage);
+
+  sct::InitLogging(&argc, argv);
+  sct::ParseCommandLineFlags(&argc, argv);
+
+  std::vector<std::string> inputs;
+  if (!FLAGS_inputs.empty())
+    sct::SplitString(FLAGS_inputs, inputs, ',');
+  for (int i = 1; i < argc; ++i)
+    inputs.push_back(argv[i]);
+
+  if (inputs.empty()) {
+    LOG(ERROR) << "no input files given: exiting";
+    return 1;
+  }
+
+  LOG(INFO) << "merging " << inputs.size() << " files into " << FLAGS_output;
+  if (!sct::MergeGlauberTrees(inputs, FLAGS_output)) {
+    LOG(ERROR) << "merge failed: exiting";
+    return 1;
+  }
+
+  LOG(INFO) << "merge successful";
+  gflags::ShutDownCommandLineFlags();
+  return 0;
+}
@@ -6,6 +6,7 @@
  *
  */
 
+#include "sct/glauber/event_sink.h"
 #include "sct/glauber/glauber_tree.h"
 #include "sct/glauber/mc_glauber.h"
 #include "sct/lib/enumerations.h"
@@ -14,10 +15,14 @@
 #include "sct/lib/string/string_utils.h"
 #include "sct/utils/nucleus_info.h"
 #include "sct/utils/random.h"
+#include "sct/utils/root_random.h"
+#include "sct/utils/thread_pool.h"
 
 #include <algorithm>
+#include <iterator>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "boost/filesystem.hpp"
 
@@ -39,7 +44,26 @@ SCT_DEFINE_string(modification, "nominal",
 
 // EXPERIMENTAL - currently, ROOT seems to have a problem with
 // this, even though I turned on thread safety...
-SCT_DEFINE_bool(multithread, false, "allow parallelization of glauber jobs");
+SCT_DEFINE_bool(multithread, false,
+                "runs all glauber jobs at once, with their event chunks "
+                "balanced over one shared pool of pool_threads threads");
+SCT_DEFINE_int(pool_threads, 0,
+               "size of the shared thread pool for multithread - 0 uses one "
+               "thread per core");
+SCT_DEFINE_bool(shared_nuclei, false,
+                "in systematic runs, the variations of the collision settings "
+                "(largexsec, smallxsec, gauss) collide the nuclei of the "
+                "nominal job instead of generating their own. Each still has "
+                "its own output file");
+SCT_DEFINE_string(scan_energies, "",
+                  "comma separated list of additional collision energies: "
+                  "each job also collides its nuclei with the NN cross "
+                  "section of every energy, into its own output file - a "
+                  "beam energy scan in a single pass");
+SCT_DEFINE_int(threads, 1,
+               "number of worker threads used to generate the events of each "
+               "glauber job, if multithread is off. Output for a given seed "
+               "does not depend on it");
 
 // collision settings
 SCT_DEFINE_string(species, "au197", "nucleus species");
@@ -48,6 +72,54 @@ SCT_DEFINE_int(energy, 200, "collision energy");
 SCT_DEFINE_bool(random_seed, true,
                 "if true, uses a random seed for the thread RNGs - otherwise "
                 "uses a counter");
+SCT_DEFINE_int(seed, -1,
+               "if non-negative, the glauber job for each modification uses "
+               "seed + its index in the list of modifications, overriding "
+               "random_seed - the output is then reproducible");
+SCT_DEFINE_string(rng, "mt19937",
+                  "random engine used to generate events: [mt19937, philox]");
+SCT_DEFINE_int(write_queue, 10000,
+               "maximum number of events waiting to be written to disk by the "
+               "background writer thread");
+SCT_DEFINE_int(auto_flush, -30000000,
+               "output tree basket flush interval: events if positive, bytes "
+               "if negative");
+SCT_DEFINE_int(auto_save, -300000000,
+               "output tree header save interval, after which a crashed job "
+               "can be recovered: events if positive, bytes if negative");
+SCT_DEFINE_int(checkpoint, 0,
+               "if positive, the run state is saved to the output file every "
+               "checkpoint chunks of 1000 events, so a killed job can be "
+               "resumed");
+SCT_DEFINE_bool(resume, false,
+                "finishes the jobs in existing output files from their last "
+                "checkpoint, instead of starting new jobs");
+SCT_DEFINE_bool(append, false,
+                "adds events events to the finished jobs in existing output "
+                "files, instead of starting new jobs");
+SCT_DEFINE_string(b_strata, "",
+                  "comma separated impact parameter stratum edges in fm, for "
+                  "biased impact parameter sampling. Events are weighted");
+SCT_DEFINE_string(b_fractions, "",
+                  "comma separated relative number of events to generate in "
+                  "each impact parameter stratum");
+
+// parses a comma separated list of numbers
+std::vector<double> ParseList(const std::string &str) {
+  std::vector<std::string> tokens;
+  sct::SplitString(str, tokens, ',');
+  std::vector<double> values;
+  for (auto &token : tokens)
+    values.push_back(std::stod(token));
+  return values;
+}
+
+// writes a QA histogram to the current directory as name, replacing the
+// histogram of an earlier part of the job
+void WriteHistogram(TH1 *histogram, const std::string &name) {
+  histogram->SetName(name.c_str());
+  histogram->Write("", TObject::kOverwrite);
+}
 
 void PrintSettings() {
   LOG(INFO) << "Running MC Glauber:";
@@ -55,56 +127,184 @@ void PrintSettings() {
   LOG(INFO) << "collision energy: " << FLAGS_energy << " GeV";
   LOG(INFO) << "deformation: " << (FLAGS_deformation ? "On" : "Off");
   LOG(INFO) << "number of events: " << FLAGS_events;
+  LOG(INFO) << "threads per job: " << FLAGS_threads;
+  LOG(INFO) << "random engine: " << FLAGS_rng;
+  if (FLAGS_resume)
+    LOG(INFO) << "resuming jobs from their last checkpoint";
+  else if (FLAGS_append)
+    LOG(INFO) << "appending events to existing output files";
+  if (!FLAGS_b_strata.empty())
+    LOG(INFO) << "impact parameter strata: " << FLAGS_b_strata
+              << " fractions: " << FLAGS_b_fractions;
+  if (FLAGS_systematic && FLAGS_shared_nuclei)
+    LOG(INFO) << "collision variations share the nuclei of the nominal job";
+  if (!FLAGS_scan_energies.empty())
+    LOG(INFO) << "energy scan: " << FLAGS_scan_energies << " GeV";
 }
 
-// job to run a single parameter set
+// converts an energy in GeV to a CollisionEnergy - returns false for unknown
+// energies
+bool ToCollisionEnergy(int energy, sct::CollisionEnergy &result) {
+  switch (energy) {
+  case 2760:
+    result = sct::CollisionEnergy::E2760;
+    return true;
+  case 200:
+    result = sct::CollisionEnergy::E200;
+    return true;
+  case 62:
+    result = sct::CollisionEnergy::E62;
+    return true;
+  case 39:
+    result = sct::CollisionEnergy::E39;
+    return true;
+  case 27:
+    result = sct::CollisionEnergy::E27;
+    return true;
+  case 19:
+    result = sct::CollisionEnergy::E19;
+    return true;
+  case 14:
+    result = sct::CollisionEnergy::E14;
+    return true;
+  case 11:
+    result = sct::CollisionEnergy::E11;
+    return true;
+  case 7:
+    result = sct::CollisionEnergy::E7;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// output file of the job for modification mod at energy (in GeV)
+std::string OutputName(const std::string &outDir, sct::GlauberMod mod,
+                       int energy) {
+  return sct::MakeString(outDir, "/glauber_", sct::glauberModToString[mod],
+                         "_", FLAGS_species, "_", energy, "gev_deformed_",
+                         (FLAGS_deformation ? "true" : "false"), ".root");
+}
+
+// writes the QA histograms of a job into the file of result, and closes it
+void WriteQA(sct::MCGlauber &generator, sct::GlauberTree *result,
+             TH1D *accepted_ip, sct::NPartNCollSink &npart_ncoll,
+             const std::string &modstring) {
+  // the QA histograms go into the same file as the trees
+  result->file()->cd();
+
+  // get woods-saxon distributions
+  TH1D *rA = generator.nucleusA()->generatedR();
+  if (rA != nullptr) {
+    WriteHistogram(rA, "rA");
+    WriteHistogram(generator.nucleusA()->generatedCosTheta(), "costhetaA");
+  }
+  TH1D *rB = generator.nucleusB()->generatedR();
+  if (rB != nullptr) {
+    WriteHistogram(rB, "rB");
+    WriteHistogram(generator.nucleusB()->generatedCosTheta(), "costhetaB");
+  }
+  if (generator.nuclearPDFA() != nullptr) {
+    WriteHistogram(generator.nuclearPDFA(), "rcosthetaA");
+    WriteHistogram(generator.nuclearPDFB(), "rcosthetaB");
+  }
+  WriteHistogram(generator.generatedImpactParameter(), "generatedIP");
+  WriteHistogram(accepted_ip, "acceptedIP");
+  WriteHistogram(npart_ncoll.histogram(),
+                 sct::MakeString("npartncoll_", modstring));
+  result->close();
+}
+
+// job to run a single parameter set - the events are generated on pool if it
+// is not null, otherwise with threads worker threads. The collision
+// variations in variants, and the same modification at each of the
+// scan_energies, are generated with the nuclei of the job, each into its own
+// output file
 void RunGlauber(sct::GlauberSpecies species, sct::CollisionEnergy energy,
                 sct::GlauberMod mod, std::string outDir, bool deformation,
-                int nEvents, int seed) {
+                int nEvents, int seed, sct::ThreadPool *pool,
+                const std::vector<sct::GlauberMod> &variants,
+                const std::vector<sct::CollisionEnergy> &scan_energies) {
   std::string modstring = sct::glauberModToString[mod];
 
-  sct::Random::instance().seed(seed);
-
   // create and run the generator
   sct::MCGlauber generator(species, species, energy, mod, deformation,
                            deformation);
-  generator.run(nEvents);
-  sct::GlauberTree *result = generator.results();
+  generator.setSeed(seed);
+  generator.setRandomEngine(FLAGS_rng == "philox"
+                                ? sct::RandomEngine::Philox
+                                : sct::RandomEngine::MT19937);
+  if (!FLAGS_b_strata.empty())
+    generator.setImpactParameterStrata(ParseList(FLAGS_b_strata),
+                                       ParseList(FLAGS_b_fractions));
+
+  // events are streamed to the output file while they are generated
+  std::string outName = OutputName(outDir, mod, FLAGS_energy);
+  generator.setOutputFile(outName, FLAGS_write_queue, FLAGS_auto_flush,
+                          FLAGS_auto_save);
+  generator.setCheckpointInterval(FLAGS_checkpoint);
+  std::vector<std::string> variant_names;
+  for (auto variant : variants) {
+    generator.addCollisionVariant(variant,
+                                  OutputName(outDir, variant, FLAGS_energy));
+    variant_names.push_back(sct::glauberModToString[variant]);
+  }
+  for (auto scan_energy : scan_energies) {
+    int gev = static_cast<int>(scan_energy);
+    generator.addCollisionVariant(scan_energy, OutputName(outDir, mod, gev));
+    variant_names.push_back(sct::MakeString(modstring, "_", gev, "gev"));
+  }
 
-  int binx = sct::NucleusInfo::instance().massNumber(species) * 2 + 1;
-  int biny = sct::NucleusInfo::instance().massNumber(species) * 8;
+  // the npart x ncoll distribution is filled while the events are generated -
+  // when a job is continued, it is filled from the full tree afterwards
+  bool continued = FLAGS_resume || FLAGS_append;
+  sct::NPartNCollSink npart_ncoll(
+      sct::NucleusInfo::instance().massNumber(species) * 2);
+  if (!continued)
+    generator.addEventSink(&npart_ncoll);
 
-  TH2D *ncollnpart = new TH2D(sct::MakeString("npartncoll_", modstring).c_str(),
-                              ";nPart;nColl", binx, 0, binx, biny, 0, biny);
-  for (int i = 0; i < result->getEntries(); ++i) {
-    result->getEntry(i);
-    ncollnpart->Fill(result->nPart(), result->nColl());
+  bool success = true;
+  if (FLAGS_resume)
+    success = pool != nullptr ? generator.resume(*pool)
+                              : generator.resume(FLAGS_threads);
+  else if (FLAGS_append)
+    success = pool != nullptr ? generator.append(nEvents, *pool)
+                              : generator.append(nEvents, FLAGS_threads);
+  else if (pool != nullptr)
+    generator.run(nEvents, *pool);
+  else
+    generator.run(nEvents, FLAGS_threads);
+  if (!success) {
+    LOG(ERROR) << "could not continue the job in " << outName;
+    return;
   }
+  sct::GlauberTree *result = generator.results();
 
-  std::string outName = sct::MakeString(
-      outDir, "/glauber_", modstring, "_", FLAGS_species, "_", FLAGS_energy,
-      "gev_deformed_", (FLAGS_deformation ? "true" : "false"), ".root");
-  // create output file
-  TFile file(outName.c_str(), "RECREATE");
+  if (continued) {
+    npart_ncoll.begin();
+    for (unsigned i = 0; i < result->getEntries(); ++i) {
+      result->getEntry(i);
+      npart_ncoll.event(result->event());
+    }
+  }
 
-  // get woods-saxon distributions
-  TH2D *WSA = generator.nuclearPDFA();
-  WSA->SetName("rcosthetaA");
-  WSA->Write();
-  TH2D *WSB = generator.nuclearPDFB();
-  WSB->SetName("rcosthetaB");
-  WSB->Write();
-  TH1D *genIP = generator.generatedImpactParameter();
-  genIP->SetName("generatedIP");
-  genIP->Write();
-  TH1D *acceptIP = generator.acceptedImpactParameter();
-  acceptIP->SetName("acceptedIP");
-  acceptIP->Write();
-  result->write();
-  ncollnpart->Write();
-
-  file.Close("nodelete");
-  delete ncollnpart;
+  WriteQA(generator, result, generator.acceptedImpactParameter(), npart_ncoll,
+          modstring);
+
+  // the variations are not passed to the event sinks - their npart x ncoll
+  // distributions are filled from their trees
+  for (unsigned i = 0; i < generator.nCollisionVariants(); ++i) {
+    sct::GlauberTree *variant = generator.variantResults(i);
+    sct::NPartNCollSink variant_npart_ncoll(
+        sct::NucleusInfo::instance().massNumber(species) * 2);
+    variant_npart_ncoll.begin();
+    for (unsigned j = 0; j < variant->getEntries(); ++j) {
+      variant->getEntry(j);
+      variant_npart_ncoll.event(variant->event());
+    }
+    WriteQA(generator, variant, generator.variantAcceptedImpactParameter(i),
+            variant_npart_ncoll, variant_names[i]);
+  }
 }
 
 int main(int argc, char *argv[]) {
@@ -112,6 +312,9 @@ int main(int argc, char *argv[]) {
   // multiple threads
   ROOT::EnableThreadSafety();
 
+  // ROOT sampling draws from the per-thread sct::Random streams
+  sct::RootRandom::install();
+
   // set help message
   std::string usage = "Runs an MC glauber simulation for the specified nuclei ";
   usage += "at the specified energy. can perform systematic variations of the ";
@@ -140,39 +343,35 @@ int main(int argc, char *argv[]) {
 
   // read energy from command line arguments
   sct::CollisionEnergy energy;
-  switch (FLAGS_energy) {
-  case 2760:
-    energy = sct::CollisionEnergy::E2760;
-    break;
-  case 200:
-    energy = sct::CollisionEnergy::E200;
-    break;
-  case 62:
-    energy = sct::CollisionEnergy::E62;
-    break;
-  case 39:
-    energy = sct::CollisionEnergy::E39;
-    break;
-  case 27:
-    energy = sct::CollisionEnergy::E27;
-    break;
-  case 19:
-    energy = sct::CollisionEnergy::E19;
-    break;
-  case 14:
-    energy = sct::CollisionEnergy::E14;
-    break;
-  case 11:
-    energy = sct::CollisionEnergy::E11;
-    break;
-  case 7:
-    energy = sct::CollisionEnergy::E7;
-    break;
-  default:
+  if (!ToCollisionEnergy(FLAGS_energy, energy)) {
     LOG(ERROR) << "requested unknown energy: exiting";
     return 1;
   }
 
+  // and the energies of the scan
+  std::vector<sct::CollisionEnergy> scan_energies;
+  if (!FLAGS_scan_energies.empty()) {
+    for (auto gev : ParseList(FLAGS_scan_energies)) {
+      sct::CollisionEnergy scan_energy;
+      if (!ToCollisionEnergy(static_cast<int>(gev), scan_energy)) {
+        LOG(ERROR) << "requested unknown scan energy " << gev << ": exiting";
+        return 1;
+      }
+      // the job's own energy is already generated
+      if (scan_energy != energy)
+        scan_energies.push_back(scan_energy);
+    }
+  }
+
+  // jobs with collision variants can not be continued
+  bool has_variants =
+      !scan_energies.empty() || (FLAGS_systematic && FLAGS_shared_nuclei);
+  if (has_variants && (FLAGS_resume || FLAGS_append)) {
+    LOG(ERROR) << "jobs with shared nuclei or an energy scan can not be "
+               << "continued: exiting";
+    return 1;
+  }
+
   // build output directory if it doesn't exist, using boost::filesystem
   boost::filesystem::path dir(FLAGS_outDir);
   boost::filesystem::create_directories(dir);
@@ -183,11 +382,25 @@ int main(int argc, char *argv[]) {
       sct::GlauberMod::Small,     sct::GlauberMod::LargeXSec,
       sct::GlauberMod::SmallXSec, sct::GlauberMod::Gauss};
 
+  if (FLAGS_rng != "mt19937" && FLAGS_rng != "philox") {
+    LOG(ERROR) << "requested unknown random engine: exiting";
+    return 1;
+  }
+
   PrintSettings();
 
   // setup a random seed for the RNG
   int seed = 0;
   std::random_device rng;
+  auto nextSeed = [&](sct::GlauberMod mod) -> int {
+    if (FLAGS_seed >= 0)
+      return FLAGS_seed + std::distance(modifiers.begin(),
+                                        std::find(modifiers.begin(),
+                                                  modifiers.end(), mod));
+    if (FLAGS_random_seed)
+      return rng();
+    return sct::Counter::instance().counter();
+  };
 
   // if we are not running systematics, we only have one setting to run
   if (FLAGS_systematic == false) {
@@ -196,49 +409,58 @@ int main(int argc, char *argv[]) {
                    ::tolower);
     sct::GlauberMod mod = sct::stringToGlauberMod[modstring];
 
-    if (FLAGS_random_seed) {
-      seed = rng();
-    } else {
-      seed = sct::Counter::instance().counter();
-    }
+    seed = nextSeed(mod);
 
     RunGlauber(species, energy, mod, FLAGS_outDir, FLAGS_deformation,
-               FLAGS_events, seed);
+               FLAGS_events, seed, nullptr, {}, scan_energies);
   } else {
-    // if we can multithread we'll run all the systematics at once
+    // with shared nuclei, the collision variations are generated by the
+    // nominal job. Seeds are still taken from the full list of modifications
+    std::vector<sct::GlauberMod> jobs = modifiers;
+    std::vector<sct::GlauberMod> variants;
+    if (FLAGS_shared_nuclei) {
+      variants = {sct::GlauberMod::LargeXSec, sct::GlauberMod::SmallXSec,
+                  sct::GlauberMod::Gauss};
+      for (auto variant : variants)
+        jobs.erase(std::find(jobs.begin(), jobs.end(), variant));
+    }
+    auto jobVariants = [&](sct::GlauberMod mod) {
+      return mod == sct::GlauberMod::Nominal ? variants
+                                             : std::vector<sct::GlauberMod>();
+    };
+
+    // if we can multithread we'll run all the systematics at once - each job
+    // merges its own events in its own thread, and the chunks of all jobs
+    // are generated by the shared pool
     if (FLAGS_multithread) {
+      sct::ThreadPool pool(FLAGS_pool_threads);
+      LOG(INFO) << "thread pool size: " << pool.size();
       std::vector<std::thread> workers;
-      for (auto mod : modifiers) {
-        if (FLAGS_random_seed) {
-          seed = rng();
-        } else {
-          seed = sct::Counter::instance().counter();
-        }
+      for (auto mod : jobs) {
+        seed = nextSeed(mod);
         LOG(INFO) << "Running Glauber with modification: "
                   << sct::glauberModToString[mod];
         workers.push_back(std::thread(RunGlauber, species, energy, mod,
                                       FLAGS_outDir, FLAGS_deformation,
-                                      FLAGS_events, seed));
+                                      FLAGS_events, seed, &pool,
+                                      jobVariants(mod), scan_energies));
       }
       for (int i = 0; i < workers.size(); ++i) {
         workers[i].join();
         LOG(INFO) << "Running Glauber with modification: "
-                  << sct::glauberModToString[modifiers[i]] << " done";
+                  << sct::glauberModToString[jobs[i]] << " done";
       }
     }
 
     // otherwise, run sequentially
     else {
-      for (auto mod : modifiers) {
-        if (FLAGS_random_seed) {
-          seed = rng();
-        } else {
-          seed = sct::Counter::instance().counter();
-        }
+      for (auto mod : jobs) {
+        seed = nextSeed(mod);
         LOG(INFO) << "Running Glauber with modification: "
                   << sct::glauberModToString[mod];
         RunGlauber(species, energy, mod, FLAGS_outDir, FLAGS_deformation,
-                   FLAGS_events, seed);
+                   FLAGS_events, seed, nullptr, jobVariants(mod),
+                   scan_energies);
         LOG(INFO) << "done";
       }
     }
@@ -19,7 +19,8 @@ MultiplicityModel::MultiplicityModel(double npp, double k, double x,
       cent_mult_(cent_mult),
       trigger_bias_(trigger_bias),
       x_(x),
-      const_efficiency_(const_eff) {
+      const_efficiency_(const_eff),
+      sampling_(MultiplicitySampling::StGlauber) {
   setNBD(npp, k);
 }
 
@@ -29,7 +30,8 @@ MultiplicityModel::MultiplicityModel(const MultiplicityModel& rhs)
       cent_mult_(rhs.cent_mult_),
       trigger_bias_(rhs.trigger_bias_),
       x_(rhs.x_),
-      const_efficiency_(rhs.const_efficiency_) {
+      const_efficiency_(rhs.const_efficiency_),
+      sampling_(rhs.sampling_) {
   setNBD(rhs.npp(), rhs.k());
 }
 
@@ -43,6 +45,8 @@ double MultiplicityModel::twoComponentMultiplicity(double npart,
 double MultiplicityModel::multiplicity(double npart, double ncoll) const {
   // taking into account trigger & TPC efficiency,
   // get multiplicity from NBD
+  if (sampling_ == MultiplicitySampling::Fast)
+    return fastMultiplicity(npart, ncoll);
 
   double nch_pp = twoComponentMultiplicity(npart, ncoll);
   double nch_sampled = nch_pp;
@@ -70,6 +74,22 @@ double MultiplicityModel::multiplicity(double npart, double ncoll) const {
   return mult;
 }
 
+double MultiplicityModel::fastMultiplicity(double npart, double ncoll) const {
+  // the sum of the NBD samples of all sources is a single NBD sample
+  int sources = TMath::Nint(twoComponentMultiplicity(npart, ncoll));
+  unsigned ideal_mult = sources > 0 ? random(sources) : 0;
+
+  // each of 2 * ideal_mult tracks is kept if uniform2() <= eff, which has
+  // probability eff / 2
+  double eff = evalEfficiency(ideal_mult);
+  unsigned mult = Random::instance().binomial(2 * ideal_mult, eff / 2.0);
+
+  if (trigger_bias_ == 1.0) return mult;
+
+  // and each kept track adds another with probability trigger_bias_
+  return mult + Random::instance().binomial(mult, trigger_bias_);
+}
+
 TH1D* MultiplicityModel::multiplicity(double npart, double ncoll,
                                       double weight) const {
   double nch_pp = twoComponentMultiplicity(npart, ncoll);
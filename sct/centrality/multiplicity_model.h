@@ -9,8 +9,14 @@
  *  approximately constant over a wide range of collision energies, so
  *  it probably has nothing to do with "hard" and "soft" processes, but
  *  it works well in the model.
+ *
+ *  By default, multiplicity() samples as StGlauber does, with a cost
+ *  linear in the multiplicity. setSampling(MultiplicitySampling::Fast)
+ *  draws the same distribution with a constant number of random numbers
+ *  per event.
  */
 
+#include "sct/lib/enumerations.h"
 #include "sct/utils/negative_binomial.h"
 
 namespace sct {
@@ -76,7 +82,17 @@ class MultiplicityModel : public NegativeBinomial {
   inline void setTriggerBias(double val) { trigger_bias_ = val; }
   inline double triggerBias() { return trigger_bias_; }
 
+  // selects the sampling algorithm of multiplicity(npart, ncoll) - default is
+  // MultiplicitySampling::StGlauber. Both give the same distribution
+  inline void setSampling(MultiplicitySampling sampling) {
+    sampling_ = sampling;
+  }
+  inline MultiplicitySampling sampling() const { return sampling_; }
+
  private:
+  // multiplicity(npart, ncoll) with MultiplicitySampling::Fast
+  double fastMultiplicity(double npart, double ncoll) const;
+
   double pp_efficiency_;       // pp_efficiency
   double central_efficiency_;  // efficiency at 0-5% centrality for the given
                                // collision system
@@ -84,6 +100,7 @@ class MultiplicityModel : public NegativeBinomial {
   double trigger_bias_;        // trigger bias
   double x_;                   // fraction of production from hard processes
   bool const_efficiency_;      // flag for constant or non-constant efficiency
+  MultiplicitySampling sampling_;  // algorithm used by multiplicity()
 };
 }  // namespace sct
 
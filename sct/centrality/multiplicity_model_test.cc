@@ -0,0 +1,68 @@
+#include "sct/centrality/multiplicity_model.h"
+#include "sct/lib/enumerations.h"
+#include "sct/lib/logging.h"
+#include "sct/lib/string/string_utils.h"
+#include "sct/utils/random.h"
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "TH1D.h"
+
+namespace {
+// fills a multiplicity histogram with n events at (npart, ncoll)
+void Sample(const sct::MultiplicityModel &model, double npart, double ncoll,
+            int n, TH1D &h) {
+  for (int i = 0; i < n; ++i)
+    h.Fill(model.multiplicity(npart, ncoll));
+}
+} // namespace
+
+// the fast sampling gives the same multiplicity distribution as the
+// StGlauber sampling, for peripheral & central events, with & without a
+// trigger bias
+TEST(MultiplicityModel, fastSamplingEquivalence) {
+  sct::Random::instance().seed(4321);
+  int n = 2e4;
+
+  struct Point {
+    double npart;
+    double ncoll;
+    double trigger_bias;
+  };
+  for (auto &point : {Point{20, 25, 1.0}, Point{350, 900, 1.0},
+                      Point{120, 250, 0.3}, Point{350, 900, 0.3}}) {
+    sct::MultiplicityModel stglauber(2.38, 2.0, 0.13, 0.98, 0.84, 540,
+                                     point.trigger_bias);
+    sct::MultiplicityModel fast(stglauber);
+    fast.setSampling(sct::MultiplicitySampling::Fast);
+    EXPECT_EQ(stglauber.sampling(), sct::MultiplicitySampling::StGlauber);
+    EXPECT_EQ(fast.sampling(), sct::MultiplicitySampling::Fast);
+
+    double max = 3.0 * stglauber.twoComponentMultiplicity(point.npart,
+                                                          point.ncoll) *
+                     stglauber.npp() + 50;
+    int bins = static_cast<int>(max / 5.0);
+    std::string suffix = sct::MakeString(point.npart, "_", point.trigger_bias);
+    TH1D h_stglauber(("mult_stglauber_" + suffix).c_str(), "", bins, 0, max);
+    TH1D h_fast(("mult_fast_" + suffix).c_str(), "", bins, 0, max);
+    Sample(stglauber, point.npart, point.ncoll, n, h_stglauber);
+    Sample(fast, point.npart, point.ncoll, n, h_fast);
+
+    double error =
+        std::sqrt(std::pow(h_stglauber.GetStdDev(), 2) / n +
+                  std::pow(h_fast.GetStdDev(), 2) / n);
+    EXPECT_NEAR(h_stglauber.GetMean(), h_fast.GetMean(), 5.0 * error);
+    EXPECT_NEAR(h_stglauber.GetStdDev(), h_fast.GetStdDev(),
+                0.05 * h_stglauber.GetStdDev());
+    EXPECT_GE(h_stglauber.Chi2Test(&h_fast, "UU"), 1e-3);
+  }
+}
+
+// no sources give no multiplicity
+TEST(MultiplicityModel, fastSamplingEmpty) {
+  sct::MultiplicityModel model;
+  model.setSampling(sct::MultiplicitySampling::Fast);
+  EXPECT_EQ(model.multiplicity(0, 0), 0);
+}
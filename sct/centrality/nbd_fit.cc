@@ -1,5 +1,6 @@
 #include "sct/centrality/nbd_fit.h"
 
+#include "sct/glauber/glauber_tree.h"
 #include "sct/lib/enumerations.h"
 #include "sct/lib/logging.h"
 #include "sct/lib/string/string_utils.h"
@@ -25,7 +26,7 @@ template <typename T> T Round(T t, int digits) {
 NBDFit::NBDFit(TH1D *data, TH2D *glauber)
     : multiplicity_model_(nullptr), refmult_data_(nullptr),
       npart_ncoll_(nullptr), minmult_fit_(100), use_stglauber_chi2_(true),
-      use_stglauber_norm_(true) {
+      use_stglauber_norm_(true), sampling_(MultiplicitySampling::StGlauber) {
   if (data != nullptr)
     loadData(*data);
 
@@ -59,12 +60,35 @@ void NBDFit::loadGlauber(const TH2D &glauber) {
   npart_ncoll_->SetDirectory(0);
 }
 
+void NBDFit::loadGlauber(GlauberTree &glauber) {
+  glauber.getHeaderEntry();
+  unsigned n_nucleons = glauber.massNumberA() + glauber.massNumberB();
+  unsigned npart_bins = n_nucleons + 1;
+  unsigned ncoll_bins = n_nucleons * 4;
+
+  TH2D npart_ncoll("nbdfit_internal_npartncoll", ";nPart;nColl", npart_bins,
+                   0, npart_bins, ncoll_bins, 0, ncoll_bins);
+  npart_ncoll.SetDirectory(0);
+  for (unsigned i = 0; i < glauber.getEntries(); ++i) {
+    glauber.getEntry(i);
+    npart_ncoll.Fill(glauber.nPart(), glauber.nColl(), glauber.weight());
+  }
+  loadGlauber(npart_ncoll);
+}
+
 // When using Fit(...) must set the NBD parameters beforehand
 void NBDFit::setParameters(double npp, double k, double x, double pp_eff,
                            double aa_eff, double cent_mult, double trigger_bias,
                            bool const_efficiency) {
   multiplicity_model_ = make_unique<MultiplicityModel>(
       npp, k, x, pp_eff, aa_eff, cent_mult, trigger_bias, const_efficiency);
+  multiplicity_model_->setSampling(sampling_);
+}
+
+void NBDFit::setMultiplicitySampling(MultiplicitySampling sampling) {
+  sampling_ = sampling;
+  if (multiplicity_model_ != nullptr)
+    multiplicity_model_->setSampling(sampling);
 }
 
 unique_ptr<FitResult> NBDFit::fit(unsigned nevents, string name) {
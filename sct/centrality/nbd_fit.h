@@ -24,6 +24,7 @@
 
 namespace sct {
 class NegativeBinomial;
+class GlauberTree;
 
 struct FitResult {
   double chi2;
@@ -43,10 +44,16 @@ public:
   virtual ~NBDFit();
 
   // To load in individually the data or glauber histograms, clears any
-  // older histogram that was already loaded.
+  // older histogram that was already loaded. Glauber events from biased
+  // impact parameter sampling must be filled into the histogram with their
+  // event weights
   void loadData(const TH1D &data);
   void loadGlauber(const TH2D &glauber);
 
+  // builds the NPart x NColl distribution directly from all events in a
+  // GlauberTree, with their event weights
+  void loadGlauber(GlauberTree &glauber);
+
   // Can perform centrality definition calculation
   void makeCentDefs(bool flag = true);
 
@@ -104,6 +111,14 @@ public:
   void useIntegralNorm(bool flag = true) { use_stglauber_norm_ = !flag; }
   inline bool usingStGlauberNorm() { return use_stglauber_norm_; }
 
+  // selects the sampling algorithm of the multiplicity model (default is
+  // MultiplicitySampling::StGlauber) - see MultiplicityModel::setSampling.
+  // The fast sampling costs the same for central & peripheral events
+  void setMultiplicitySampling(MultiplicitySampling sampling);
+  inline MultiplicitySampling multiplicitySampling() const {
+    return sampling_;
+  }
+
 private:
   std::pair<double, int> chi2_root(TH1 *h1, TH1 *h2);
   std::pair<double, int> chi2_stglauber(TH1 *h1, TH1 *h2);
@@ -128,6 +143,9 @@ private:
   // flag for using StGlauber normalization for histograms, or using a simple
   // integral normalization above minmult_fit_
   bool use_stglauber_norm_;
+
+  // sampling algorithm of the multiplicity model
+  MultiplicitySampling sampling_;
 };
 } // namespace sct
 
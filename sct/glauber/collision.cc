@@ -1,16 +1,70 @@
 #include "sct/glauber/collision.h"
 
+#include "sct/glauber/hard_core_kernel.h"
 #include "sct/lib/logging.h"
 #include "sct/lib/math.h"
 #include "sct/utils/random.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace sct {
 
+namespace {
+// bins per unit of dR^2 / sig^2 in the Gaussian profile table - the linear
+// interpolation error is below 1e-5 for any cutoff. The table stops at 8 sigma,
+// beyond which the exact probability (< 1e-13) is used
+constexpr double gaussian_bins_per_sigma2 = 82.0;
+constexpr double gaussian_table_sigma2 = 64.0;
+}  // namespace
+
 Collision::Collision()
-    : inelasticXSec_(0), profile_(CollisionProfile::HardCore) {}
+    : inelasticXSec_(0), interaction_radius_(0), interaction_radius2_(0),
+      profile_(CollisionProfile::HardCore), gaussian_cutoff_(5.0),
+      search_(CollisionSearch::BruteForce) {
+  buildGaussianTable();
+}
+
+Collision::Collision(const Collision &rhs)
+    : inelasticXSec_(rhs.inelasticXSec_),
+      interaction_radius_(rhs.interaction_radius_),
+      interaction_radius2_(rhs.interaction_radius2_), profile_(rhs.profile_),
+      gaussian_cutoff_(rhs.gaussian_cutoff_),
+      gaussian_cutoff2_(rhs.gaussian_cutoff2_),
+      gaussian_scale_(rhs.gaussian_scale_),
+      gaussian_table_(rhs.gaussian_table_), search_(rhs.search_) {
+  if (rhs.mult_model_ != nullptr)
+    mult_model_ = make_unique<MultiplicityModel>(*rhs.mult_model_);
+  clear();
+}
 
 Collision::~Collision() {}
 
+void Collision::setGaussianCutoff(double n_sigma) {
+  if (n_sigma <= 0.0) {
+    LOG(ERROR) << "Gaussian collision profile cutoff must be positive: "
+               << "setting to default (5 sigma)";
+    n_sigma = 5.0;
+  }
+  gaussian_cutoff_ = n_sigma;
+  buildGaussianTable();
+}
+
+void Collision::buildGaussianTable() {
+  gaussian_cutoff2_ = pow(gaussian_cutoff_, 2.0) * interaction_radius2_;
+  gaussian_scale_ = interaction_radius2_ > 0.0
+                        ? gaussian_bins_per_sigma2 / interaction_radius2_
+                        : 0.0;
+
+  // bin i is at dR^2 / sig^2 = i / gaussian_bins_per_sigma2, so the bin width
+  // does not depend on the cutoff
+  double range = std::min(pow(gaussian_cutoff_, 2.0), gaussian_table_sigma2);
+  unsigned bins = static_cast<unsigned>(ceil(range * gaussian_bins_per_sigma2));
+  gaussian_table_.resize(bins + 1);
+  for (unsigned i = 0; i <= bins; ++i)
+    gaussian_table_[i] = exp(-0.5 * i / gaussian_bins_per_sigma2);
+}
+
 void Collision::setMultiplicityModel(double npp, double k, double x,
                                      double pp_eff, double aa_eff,
                                      double aa_cent, double trig_eff,
@@ -24,16 +78,23 @@ bool Collision::collide(Container &nucleus_A, Container &nucleus_B) {
   clear();
 
   // count the number of binary collisions
-  for (int i = 0; i < nucleus_A.size(); ++i) {
-    for (int j = 0; j < nucleus_B.size(); ++j) {
-      if (nucleonCollision(nucleus_A[i], nucleus_B[j])) {
-        nColl_++;
-        nucleus_A[i].incrementNColl();
-        nucleus_B[j].incrementNColl();
-      }
-    }
-  }
+  if (search_ == CollisionSearch::CellList)
+    cellListSearch(nucleus_A, nucleus_B);
+  else
+    bruteForceSearch(nucleus_A, nucleus_B);
+
+  return eventAverages(nucleus_A, nucleus_B);
+}
 
+// instantiate for common containers
+template bool
+Collision::collide<std::vector<Nucleon>>(std::vector<Nucleon> &nucleus_A,
+                                         std::vector<Nucleon> &nucleus_B);
+template bool Collision::collide<Nucleus>(Nucleus &nucleus_A,
+                                          Nucleus &nucleus_B);
+
+template <typename Container>
+bool Collision::eventAverages(Container &nucleus_A, Container &nucleus_B) {
   // if there are no binary collisions, return
   if (nColl_ == 0)
     return false;
@@ -47,7 +108,7 @@ bool Collision::collide(Container &nucleus_A, Container &nucleus_B) {
   // calculate kinematic event averages
   for (auto nucleus : {&nucleus_A, &nucleus_B}) {
     for (int i = 0; i < nucleus->size(); ++i) {
-      Nucleon nucleon = (*nucleus)[i];
+      auto &&nucleon = (*nucleus)[i];
 
       if (nucleon.nColl() > 0) {
         // particle weighted averages
@@ -89,7 +150,7 @@ bool Collision::collide(Container &nucleus_A, Container &nucleus_B) {
     }
   }
 
-  // now calculate eccentricity for each class
+  // now calculate averages and reaction plane eccentricity for each class
   for (int idx :
        {nPart_index, nColl_index, spectator_index, multiplicity_index}) {
     if (count_[idx] == 0)
@@ -115,51 +176,162 @@ bool Collision::collide(Container &nucleus_A, Container &nucleus_B) {
       // reaction plane eccentricity
       eccRP2_[idx] = (sigmaY2 - sigmaX2) / sigmaSum2;
     }
+  } // weight index
 
-    // calculate nth order participant plane eccentricity
-    for (int order : {2, 3, 4}) {
-      std::pair<double, double> pp_ecc =
-          participantPlaneEcc(nucleus_A, nucleus_B, order, idx);
-      if (order == 2) {
-        pp2_[idx] = pp_ecc.first;
-        eccPP2_[idx] = pp_ecc.second;
-      }
-      if (order == 3) {
-        pp3_[idx] = pp_ecc.first;
-        eccPP3_[idx] = pp_ecc.second;
-      }
-      if (order == 4) {
-        pp4_[idx] = pp_ecc.first;
-        eccPP4_[idx] = pp_ecc.second;
-      }
-    } // participant plane order
-  }   // weight index
+  // calculate 2nd, 3rd and 4th order participant planes & eccentricities for
+  // all weights
+  participantPlanes(nucleus_A, nucleus_B);
   return true;
 }
 
-// instantiate for common containers
-template bool
-Collision::collide<std::vector<Nucleon>>(std::vector<Nucleon> &nucleus_A,
-                                         std::vector<Nucleon> &nucleus_B);
-template bool Collision::collide<Nucleus>(Nucleus &nucleus_A,
-                                          Nucleus &nucleus_B);
+// used by CollisionScan
+template bool Collision::eventAverages<Nucleus>(Nucleus &nucleus_A,
+                                                Nucleus &nucleus_B);
+
+template <typename Container>
+void Collision::bruteForceSearch(Container &nucleus_A, Container &nucleus_B) {
+  for (int i = 0; i < nucleus_A.size(); ++i) {
+    for (int j = 0; j < nucleus_B.size(); ++j) {
+      if (pairCollision(nucleus_A[i].x() - nucleus_B[j].x(),
+                        nucleus_A[i].y() - nucleus_B[j].y())) {
+        nColl_++;
+        nucleus_A[i].incrementNColl();
+        nucleus_B[j].incrementNColl();
+      }
+    }
+  }
+}
+
+void Collision::bruteForceSearch(Nucleus &nucleus_A, Nucleus &nucleus_B) {
+  if (profile_ != CollisionProfile::HardCore) {
+    bruteForceSearch<Nucleus>(nucleus_A, nucleus_B);
+    return;
+  }
+
+  nColl_ += hardCoreCollisions(
+      nucleus_A.xArray().data(), nucleus_A.yArray().data(), nucleus_A.size(),
+      nucleus_A.nCollArray().data(), nucleus_B.xArray().data(),
+      nucleus_B.yArray().data(), nucleus_B.size(),
+      nucleus_B.nCollArray().data(), interaction_radius2_);
+}
+
+template <typename Container>
+void Collision::cellListSearch(Container &nucleus_A, Container &nucleus_B) {
+  if (nucleus_A.size() == 0 || nucleus_B.size() == 0)
+    return;
+
+  // bounding box of nucleus B in the transverse plane
+  double x_min = nucleus_B[0].x();
+  double x_max = x_min;
+  double y_min = nucleus_B[0].y();
+  double y_max = y_min;
+  for (int j = 1; j < nucleus_B.size(); ++j) {
+    x_min = std::min(x_min, nucleus_B[j].x());
+    x_max = std::max(x_max, nucleus_B[j].x());
+    y_min = std::min(y_min, nucleus_B[j].y());
+    y_max = std::max(y_max, nucleus_B[j].y());
+  }
+
+  // the cell size is padded slightly, so that rounding in the cell index
+  // calculation can never place two nucleons within the interaction distance
+  // more than one cell apart
+  double cell_size = maxInteractionDistance() * (1.0 + 1e-9);
+  if (cell_size <= 0.0) {
+    bruteForceSearch(nucleus_A, nucleus_B);
+    return;
+  }
+  int nx = static_cast<int>((x_max - x_min) / cell_size) + 1;
+  int ny = static_cast<int>((y_max - y_min) / cell_size) + 1;
+
+  // a very small cross section relative to the nucleus size would give an
+  // unreasonably large grid - brute force is cheaper at that point anyways
+  if (static_cast<double>(nx) * ny > 4.0 * nucleus_B.size() + 64) {
+    bruteForceSearch(nucleus_A, nucleus_B);
+    return;
+  }
+
+  // counting sort of nucleus B into cells: count the occupancy of each cell,
+  // accumulate to get the end of each cell, then fill backwards so that
+  // cell_start_ is left pointing at the start of each cell
+  int n_cells = nx * ny;
+  cell_start_.assign(n_cells + 1, 0);
+  cell_nucleons_.resize(nucleus_B.size());
+  nucleon_cell_.resize(nucleus_B.size());
+  for (int j = 0; j < nucleus_B.size(); ++j) {
+    int cx = static_cast<int>((nucleus_B[j].x() - x_min) / cell_size);
+    int cy = static_cast<int>((nucleus_B[j].y() - y_min) / cell_size);
+    nucleon_cell_[j] = cy * nx + cx;
+    cell_start_[nucleon_cell_[j]]++;
+  }
+  for (int c = 1; c < n_cells; ++c)
+    cell_start_[c] += cell_start_[c - 1];
+  cell_start_[n_cells] = nucleus_B.size();
+  for (int j = nucleus_B.size() - 1; j >= 0; --j)
+    cell_nucleons_[--cell_start_[nucleon_cell_[j]]] = j;
+
+  // test each nucleon in A against the 3x3 block of cells around it
+  for (int i = 0; i < nucleus_A.size(); ++i) {
+    double x = nucleus_A[i].x();
+    double y = nucleus_A[i].y();
+    double fx = std::floor((x - x_min) / cell_size);
+    double fy = std::floor((y - y_min) / cell_size);
+    if (fx < -1.0 || fx > nx || fy < -1.0 || fy > ny)
+      continue;
+    int cx = static_cast<int>(fx);
+    int cy = static_cast<int>(fy);
+
+    for (int iy = std::max(cy - 1, 0); iy <= std::min(cy + 1, ny - 1); ++iy) {
+      for (int ix = std::max(cx - 1, 0); ix <= std::min(cx + 1, nx - 1);
+           ++ix) {
+        int cell = iy * nx + ix;
+        for (unsigned k = cell_start_[cell]; k < cell_start_[cell + 1]; ++k) {
+          unsigned j = cell_nucleons_[k];
+          if (pairCollision(x - nucleus_B[j].x(), y - nucleus_B[j].y())) {
+            nColl_++;
+            nucleus_A[i].incrementNColl();
+            nucleus_B[j].incrementNColl();
+          }
+        }
+      }
+    }
+  }
+}
 
 bool Collision::nucleonCollision(Nucleon nucleon_A, Nucleon nucleon_B) {
-  double dR = nucleon_A.deltaXY(nucleon_B);
-  double dRMax = sqrt(inelasticXSec_ / pi);
+  return pairCollision(nucleon_A.x() - nucleon_B.x(),
+                       nucleon_A.y() - nucleon_B.y());
+}
+
+bool Collision::pairCollision(double dx, double dy) {
+  double dR2 = dx * dx + dy * dy;
 
   switch (profile_) {
   case CollisionProfile::HardCore:
-    if (dR <= dRMax)
+    // squared distances, to match the vectorized kernel in hard_core_kernel.h
+    if (dR2 <= interaction_radius2_)
       return true;
     return false;
     break;
   case CollisionProfile::Gaussian:
-    return Random::instance().uniform() <= exp(-pow(dR / dRMax, 2.0) / 2.0);
+    // pairs beyond the cutoff are rejected without a random number
+    if (dR2 >= gaussian_cutoff2_)
+      return false;
+    return Random::instance().uniform() <= gaussianProbability(dR2);
     break;
   }
 }
 
+double Collision::collisionProbability(double dx, double dy) const {
+  double dR2 = dx * dx + dy * dy;
+  switch (profile_) {
+  case CollisionProfile::HardCore:
+    return dR2 <= interaction_radius2_ ? 1.0 : 0.0;
+  case CollisionProfile::Gaussian:
+    return dR2 < gaussian_cutoff2_ ? gaussianProbability(dR2) : 0.0;
+  }
+  return 0.0;
+}
+
 void Collision::clear() {
   nColl_ = 0;
   count_.fill(0);
@@ -178,16 +350,7 @@ void Collision::clear() {
 }
 
 template <typename Container>
-std::pair<double, double>
-Collision::participantPlaneEcc(Container &nucleus_A, Container &nucleus_B,
-                               int order, int weightIdx) {
-  double qx = 0;
-  double qy = 0;
-  double qw = 0;
-
-  if (nPart() <= 2)
-    return {-999.0, -999.0};
-
+void Collision::participantPlanes(Container &nucleus_A, Container &nucleus_B) {
   // get indices for the arrays
   constexpr unsigned nPart_index = static_cast<int>(GlauberWeight::NPart);
   constexpr unsigned nColl_index = static_cast<int>(GlauberWeight::NColl);
@@ -196,43 +359,86 @@ Collision::participantPlaneEcc(Container &nucleus_A, Container &nucleus_B,
   constexpr unsigned multiplicity_index =
       static_cast<int>(GlauberWeight::Multiplicity);
 
-  for (auto nucleus : {&nucleus_A, &nucleus_B}) {
-    for (int i = 0; i < nucleus->size(); ++i) {
-      Nucleon nucleon = (*nucleus)[i];
-      double nColl = nucleon.nColl();
+  // weights without any entries are left at zero
+  std::array<bool, nGlauberWeights> active;
+  for (unsigned idx = 0; idx < nGlauberWeights; ++idx)
+    active[idx] = count_[idx] > 0;
+  if (mult_model_ == nullptr)
+    active[multiplicity_index] = false;
 
-      // spectators have zero collisions
-      if (weightIdx == spectator_index && nColl > 0)
+  if (nPart() <= 2) {
+    for (unsigned idx = 0; idx < nGlauberWeights; ++idx) {
+      if (!active[idx])
         continue;
+      pp2_[idx] = pp3_[idx] = pp4_[idx] = -999.0;
+      eccPP2_[idx] = eccPP3_[idx] = eccPP4_[idx] = -999.0;
+    }
+    return;
+  }
 
-      // participants have one or more collisions
-      if (weightIdx != spectator_index && nColl == 0)
+  // Q-vectors: q_n = sum(w * r^2 * exp(i * n * phi)), and the normalization
+  // sum(w * r^2), where (r, phi) are relative to the weighted center
+  std::array<double, nGlauberWeights> q2x, q2y, q3x, q3y, q4x, q4y, qw;
+  for (auto q : {&q2x, &q2y, &q3x, &q3y, &q4x, &q4y, &qw})
+    q->fill(0.0);
+
+  // r^2 * exp(i * n * phi) is built from powers of z = x + iy instead of trig
+  // functions: z^2 = r^2 exp(2i phi), z^3 / r = r^2 exp(3i phi), and
+  // z^4 / r^2 = r^2 exp(4i phi)
+  auto accumulate = [&](unsigned idx, double x, double y, double weight) {
+    double dx = x - avgX_[idx];
+    double dy = y - avgY_[idx];
+    double r2 = dx * dx + dy * dy;
+    if (r2 == 0.0 || weight == 0.0)
+      return;
+    double z2x = dx * dx - dy * dy;
+    double z2y = 2.0 * dx * dy;
+    double inv_r = 1.0 / sqrt(r2);
+    double inv_r2 = inv_r * inv_r;
+    double w = weight;
+    q2x[idx] += w * z2x;
+    q2y[idx] += w * z2y;
+    q3x[idx] += w * (z2x * dx - z2y * dy) * inv_r;
+    q3y[idx] += w * (z2x * dy + z2y * dx) * inv_r;
+    q4x[idx] += w * (z2x * z2x - z2y * z2y) * inv_r2;
+    q4y[idx] += w * (2.0 * z2x * z2y) * inv_r2;
+    qw[idx] += w * r2;
+  };
+
+  for (auto nucleus : {&nucleus_A, &nucleus_B}) {
+    for (int i = 0; i < nucleus->size(); ++i) {
+      auto &&nucleon = (*nucleus)[i];
+      double x = nucleon.x();
+      double y = nucleon.y();
+      unsigned n_coll = nucleon.nColl();
+
+      if (n_coll == 0) {
+        // spectators have zero collisions
+        if (active[spectator_index])
+          accumulate(spectator_index, x, y, 1.0);
         continue;
+      }
 
-      TVector3 tmp(nucleon.x() - avgX_[weightIdx],
-                   nucleon.y() - avgY_[weightIdx], nucleon.z());
-      double weight = 1.0;
-      if (weightIdx == nColl_index)
-        weight = nColl;
-      else if (weightIdx == multiplicity_index)
-        weight = nucleon.multiplicity();
-      double r = tmp.Perp();
-      double phi = tmp.Phi();
-
-      qx += weight * r * r * cos(order * phi);
-      qy += weight * r * r * sin(order * phi);
-      qw += weight * r * r;
+      // participants have one or more collisions
+      if (active[nPart_index])
+        accumulate(nPart_index, x, y, 1.0);
+      if (active[nColl_index])
+        accumulate(nColl_index, x, y, n_coll);
+      if (active[multiplicity_index])
+        accumulate(multiplicity_index, x, y, nucleon.multiplicity());
     }
   }
 
-  qx /= count_[weightIdx];
-  qy /= count_[weightIdx];
-  qw /= count_[weightIdx];
-
-  double participant_plane = atan2(qy, -qx);
-  double eccentricity = sqrt(qx * qx + qy * qy) / qw;
-
-  return {participant_plane, eccentricity};
+  for (unsigned idx = 0; idx < nGlauberWeights; ++idx) {
+    if (!active[idx])
+      continue;
+    pp2_[idx] = atan2(q2y[idx], -q2x[idx]);
+    pp3_[idx] = atan2(q3y[idx], -q3x[idx]);
+    pp4_[idx] = atan2(q4y[idx], -q4x[idx]);
+    eccPP2_[idx] = sqrt(q2x[idx] * q2x[idx] + q2y[idx] * q2y[idx]) / qw[idx];
+    eccPP3_[idx] = sqrt(q3x[idx] * q3x[idx] + q3y[idx] * q3y[idx]) / qw[idx];
+    eccPP4_[idx] = sqrt(q4x[idx] * q4x[idx] + q4y[idx] * q4y[idx]) / qw[idx];
+  }
 }
 
 } // namespace sct
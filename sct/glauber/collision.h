@@ -10,18 +10,31 @@
 #include "sct/glauber/nucleon.h"
 #include "sct/glauber/nucleus.h"
 #include "sct/lib/enumerations.h"
+#include "sct/lib/math.h"
 #include "sct/lib/memory.h"
 
 #include <array>
+#include <cmath>
+#include <vector>
 
 namespace sct {
+class CollisionScan;
+
 class Collision {
  public:
   Collision();
+  // copies the collision settings (cross section, profile and multiplicity
+  // model) - collision statistics are not copied
+  Collision(const Collision& rhs);
   ~Collision();
 
   // defines the cross section for a collision between two nucleons
-  inline void setNNCrossSection(double nn_xsec) { inelasticXSec_ = nn_xsec; }
+  inline void setNNCrossSection(double nn_xsec) {
+    inelasticXSec_ = nn_xsec;
+    interaction_radius2_ = nn_xsec / pi;
+    interaction_radius_ = sqrt(interaction_radius2_);
+    buildGaussianTable();
+  }
   inline double NNCrossSection() const { return inelasticXSec_; }
 
   // defines the method for calculating nucleon-nucleon collisions:
@@ -32,11 +45,41 @@ class Collision {
   //       gaussian probability distribution for collision: exp(-x^2/(2*sig^2))
   //       x = distance between nucleons in XY plane
   //       sig = sqrt(NNCrossSection/pi)
+  //       the probability is read from a table over x^2, and is zero beyond
+  //       gaussianCutoff() * sig, so distant pairs don't draw a random number
   inline void setCollisionProfile(CollisionProfile profile) {
     profile_ = profile;
   }
   inline CollisionProfile collisionProfile() const { return profile_; }
 
+  // distance (in units of sig) beyond which the Gaussian profile gives no
+  // collisions (default is 5, where the probability is 4e-6)
+  void setGaussianCutoff(double n_sigma);
+  inline double gaussianCutoff() const { return gaussian_cutoff_; }
+
+  // maximum transverse distance at which two nucleons can collide
+  inline double maxInteractionDistance() const {
+    return profile_ == CollisionProfile::HardCore
+               ? interaction_radius_
+               : gaussian_cutoff_ * interaction_radius_;
+  }
+
+  // defines the method used to find colliding nucleon pairs:
+  // 1) CollisionSearch::BruteForce (default)
+  //       every nucleon in A is tested against every nucleon in B - O(A*B)
+  // 2) CollisionSearch::CellList
+  //       nucleus B is binned in a 2D grid in the transverse plane, with a
+  //       cell size equal to maxInteractionDistance(). each nucleon in A is
+  //       only tested against the nucleons in its own and the eight
+  //       neighbouring cells. Gives identical results to BruteForce for the
+  //       HardCore profile, and is faster for heavy nuclei. For the Gaussian
+  //       profile, pairs are tested in a different order, so the results are
+  //       only statistically equivalent
+  // for Nucleus, the HardCore BruteForce search uses a vectorized kernel, with
+  // the instruction set chosen at runtime (see hard_core_kernel.h)
+  inline void setCollisionSearch(CollisionSearch search) { search_ = search; }
+  inline CollisionSearch collisionSearch() const { return search_; }
+
   // estimates a multiplicity for each binary collision, allowing
   // observables to be calculated weighted by the estimated multiplicity
   // generally, these parameters come from a fit of the glauber model to data,
@@ -57,6 +100,10 @@ class Collision {
   // checks if two nucleons collide using the specified collision profile
   bool nucleonCollision(Nucleon nucleon_A, Nucleon nucleon_B);
 
+  // probability for two nucleons separated by (dx, dy) in the transverse
+  // plane to collide
+  double collisionProbability(double dx, double dy) const;
+
   // zeros collision statistics
   void clear();
 
@@ -64,6 +111,9 @@ class Collision {
   inline unsigned nColl() const { return nColl_; }
   inline unsigned nPart() const { return count_[0]; }
   inline unsigned spectators() const { return count_[2]; }
+  // summed multiplicity of the participants - zero without a multiplicity
+  // model
+  inline unsigned multiplicity() const { return count_[3]; }
 
   // access to arrays
   std::array<unsigned, nGlauberWeights>& countArray() { return count_; }
@@ -81,17 +131,73 @@ class Collision {
   std::array<double, nGlauberWeights>& partPlane4() { return pp4_; }
 
  private:
-  // used by collide() to calculate participant plane eccentricity
+  // the scan sets the collision counts of several collisions at once
+  friend class CollisionScan;
+
+  // used by collide() to count binary collisions, with either search method
   template <typename Container>
-  std::pair<double, double> participantPlaneEcc(Container& nucleusA,
-                                                Container& nucleusB, int order,
-                                                int weightIdx);
+  void bruteForceSearch(Container& nucleus_A, Container& nucleus_B);
+  void bruteForceSearch(Nucleus& nucleus_A, Nucleus& nucleus_B);
+  template <typename Container>
+  void cellListSearch(Container& nucleus_A, Container& nucleus_B);
+
+  // checks if two nucleons separated by (dx, dy) in the transverse plane
+  // collide using the specified collision profile
+  bool pairCollision(double dx, double dy);
+
+  // Gaussian collision probability for a squared distance dR2 < the squared
+  // cutoff distance, interpolated from the table. Distances past the end of
+  // the table use the exact probability
+  inline double gaussianProbability(double dR2) const {
+    double pos = dR2 * gaussian_scale_;
+    if (pos >= gaussian_table_.size() - 1)
+      return exp(-0.5 * dR2 / interaction_radius2_);
+    unsigned bin = static_cast<unsigned>(pos);
+    double frac = pos - bin;
+    return gaussian_table_[bin] +
+           frac * (gaussian_table_[bin + 1] - gaussian_table_[bin]);
+  }
+
+  // tabulates the Gaussian profile up to the cutoff distance
+  void buildGaussianTable();
+
+  // used by collide() to calculate the event averages, eccentricities and
+  // participant planes, once nColl_ and the collision counts of the nucleons
+  // are set. Returns false if there are no binary collisions
+  template <typename Container>
+  bool eventAverages(Container& nucleus_A, Container& nucleus_B);
+
+  // used by collide() to calculate the 2nd, 3rd and 4th order participant
+  // planes and eccentricities for every weight together. This is the second
+  // of two passes over the nucleons: it requires the averages of the first
+  // pass, eventAverages(), to center the Q-vectors
+  template <typename Container>
+  void participantPlanes(Container& nucleusA, Container& nucleusB);
 
-  double inelasticXSec_;  // nucleon-nucleon cross section
+  double inelasticXSec_;        // nucleon-nucleon cross section
+  double interaction_radius_;   // sqrt(inelasticXSec_ / pi)
+  double interaction_radius2_;  // inelasticXSec_ / pi
 
   CollisionProfile profile_;  // either normal hard-core collision profile
                               // or gaussian profile
 
+  // Gaussian profile lookup table: gaussian_table_[i] is the collision
+  // probability at the squared distance i / gaussian_scale_, up to the squared
+  // cutoff distance gaussian_cutoff2_ or 8 sigma, whichever is smaller
+  double gaussian_cutoff_;
+  double gaussian_cutoff2_;
+  double gaussian_scale_;
+  std::vector<double> gaussian_table_;
+
+  CollisionSearch search_;  // brute force or cell list pair search
+
+  // cell list storage, reused between events: nucleons in B are sorted by
+  // cell, with the nucleons of cell c at cell_nucleons_[cell_start_[c]] up to
+  // cell_nucleons_[cell_start_[c + 1]]
+  std::vector<unsigned> cell_start_;
+  std::vector<unsigned> cell_nucleons_;
+  std::vector<unsigned> nucleon_cell_;
+
   // multiplicity model
   unique_ptr<MultiplicityModel> mult_model_;
 
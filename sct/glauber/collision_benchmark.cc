@@ -1,6 +1,14 @@
 #include "sct/glauber/collision.h"
+#include "sct/glauber/collision_scan.h"
+#include "sct/glauber/hard_core_kernel.h"
 #include "sct/glauber/nucleus.h"
+#include "sct/lib/enumerations.h"
 #include "sct/lib/logging.h"
+#include "sct/lib/math.h"
+#include "sct/utils/random.h"
+
+#include <cmath>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
@@ -23,6 +31,75 @@ static void BM_Collision(benchmark::State& state) {
   }
 }
 
+// compares the brute force and cell list collision searches as a function of
+// mass number - range(0) is the mass number, range(1) the CollisionSearch
+static void BM_CollisionSearch(benchmark::State& state) {
+  sct::parameter_list params;
+  params["radius"] = 1.12 * pow(state.range(0), 1.0 / 3.0);
+  params["skin_depth"] = 0.54;
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusA.generate();
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusB.generate();
+
+  sct::Collision collision;
+  collision.setNNCrossSection(4.2);
+  collision.setCollisionSearch(
+      static_cast<sct::CollisionSearch>(state.range(1)));
+
+  for (auto _ : state) {
+    collision.collide(nucleusA, nucleusB);
+  }
+}
+
+static void CollisionSearchArgs(benchmark::internal::Benchmark* b) {
+  for (int mass_number = 2; mass_number <= 512; mass_number *= 2)
+    for (auto search :
+         {sct::CollisionSearch::BruteForce, sct::CollisionSearch::CellList})
+      b->Args({mass_number, static_cast<int>(search)});
+}
+
+// compares the instruction sets of the hard-core pair kernel - range(0) is the
+// mass number, range(1) the SimdLevel
+static void BM_HardCoreKernel(benchmark::State& state) {
+  sct::parameter_list params;
+  params["radius"] = 1.12 * pow(state.range(0), 1.0 / 3.0);
+  params["skin_depth"] = 0.54;
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusA.generate();
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusB.generate();
+
+  sct::SimdLevel level = static_cast<sct::SimdLevel>(state.range(1));
+  if (level > sct::detectSimdLevel()) {
+    state.SkipWithError("instruction set not supported by this CPU");
+    return;
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sct::hardCoreCollisions(
+        nucleusA.xArray().data(), nucleusA.yArray().data(), nucleusA.size(),
+        nucleusA.nCollArray().data(), nucleusB.xArray().data(),
+        nucleusB.yArray().data(), nucleusB.size(),
+        nucleusB.nCollArray().data(), 4.2 / sct::pi, level));
+  }
+}
+
+static void HardCoreKernelArgs(benchmark::internal::Benchmark* b) {
+  for (int mass_number : {16, 63, 197, 208, 238})
+    for (auto level : {sct::SimdLevel::Scalar, sct::SimdLevel::SSE2,
+                       sct::SimdLevel::AVX2, sct::SimdLevel::AVX512})
+      b->Args({mass_number, static_cast<int>(level)});
+}
+
 static void BM_XSec(benchmark::State& state) {
   sct::parameter_list params;
   params["radius"] = 6.0;
@@ -42,7 +119,122 @@ static void BM_XSec(benchmark::State& state) {
   }
 }
 
+// Gaussian collision profile as a function of the cutoff distance - range(0)
+// is the mass number, range(1) the CollisionSearch and range(2) the cutoff in
+// units of sigma. BM_GaussianProfileExact is the baseline without cutoff
+static void BM_GaussianProfile(benchmark::State& state) {
+  sct::parameter_list params;
+  params["radius"] = 1.12 * pow(state.range(0), 1.0 / 3.0);
+  params["skin_depth"] = 0.54;
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusA.generate(-3.0);
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusB.generate(3.0);
+
+  sct::Collision collision;
+  collision.setNNCrossSection(4.2);
+  collision.setCollisionProfile(sct::CollisionProfile::Gaussian);
+  collision.setCollisionSearch(
+      static_cast<sct::CollisionSearch>(state.range(1)));
+  collision.setGaussianCutoff(state.range(2));
+
+  for (auto _ : state) {
+    collision.collide(nucleusA, nucleusB);
+  }
+}
+
+static void GaussianProfileArgs(benchmark::internal::Benchmark* b) {
+  for (int mass_number : {63, 197, 238})
+    for (auto search :
+         {sct::CollisionSearch::BruteForce, sct::CollisionSearch::CellList})
+      for (int cutoff : {5, 3})
+        b->Args({mass_number, static_cast<int>(search), cutoff});
+}
+
+// Gaussian collision profile without cutoff or table: every pair is tested
+// with a random number against the exact exp() - range(0) is the mass number
+static void BM_GaussianProfileExact(benchmark::State& state) {
+  sct::parameter_list params;
+  params["radius"] = 1.12 * pow(state.range(0), 1.0 / 3.0);
+  params["skin_depth"] = 0.54;
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusA.generate(-3.0);
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusB.generate(3.0);
+
+  double sigma2 = 4.2 / sct::pi;
+  for (auto _ : state) {
+    unsigned n_coll = 0;
+    for (unsigned i = 0; i < nucleusA.size(); ++i)
+      for (unsigned j = 0; j < nucleusB.size(); ++j) {
+        double dx = nucleusA[i].x() - nucleusB[j].x();
+        double dy = nucleusA[i].y() - nucleusB[j].y();
+        if (sct::Random::instance().uniform() <=
+            exp(-0.5 * (dx * dx + dy * dy) / sigma2))
+          n_coll++;
+      }
+    benchmark::DoNotOptimize(n_coll);
+  }
+}
+
+// the NN cross sections of the nine beam energies (7.7 - 2760 GeV), collided
+// one at a time (range(1) = 0) or in a CollisionScan (range(1) = 1) - range(0)
+// is the mass number
+static void BM_CollisionScan(benchmark::State& state) {
+  sct::parameter_list params;
+  params["radius"] = 1.12 * pow(state.range(0), 1.0 / 3.0);
+  params["skin_depth"] = 0.54;
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusA.generate(-3.0);
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(state.range(0), params,
+                         sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleusB.generate(3.0);
+
+  std::vector<double> xsecs{3.08, 3.12, 3.15, 3.2, 3.3, 3.4, 3.6, 4.2, 6.4};
+  std::vector<sct::Collision> collisions(xsecs.size());
+  std::vector<sct::Collision*> pointers;
+  for (unsigned i = 0; i < xsecs.size(); ++i) {
+    collisions[i].setNNCrossSection(xsecs[i]);
+    pointers.push_back(&collisions[i]);
+  }
+  sct::CollisionScan scan(pointers);
+
+  for (auto _ : state) {
+    if (state.range(1) == 1) {
+      scan.collide(nucleusA, nucleusB);
+      continue;
+    }
+    for (auto& collision : collisions) {
+      nucleusA.clearCollisions();
+      nucleusB.clearCollisions();
+      collision.collide(nucleusA, nucleusB);
+    }
+  }
+}
+
+static void CollisionScanArgs(benchmark::internal::Benchmark* b) {
+  for (int mass_number : {63, 197, 238})
+    for (int scan : {0, 1})
+      b->Args({mass_number, scan});
+}
+
 BENCHMARK(BM_Collision)->Range(10, 1000);
 BENCHMARK(BM_XSec)->Range(10, 1000);
+BENCHMARK(BM_CollisionSearch)->Apply(CollisionSearchArgs);
+BENCHMARK(BM_HardCoreKernel)->Apply(HardCoreKernelArgs);
+BENCHMARK(BM_GaussianProfile)->Apply(GaussianProfileArgs);
+BENCHMARK(BM_GaussianProfileExact)->Arg(63)->Arg(197)->Arg(238);
+BENCHMARK(BM_CollisionScan)->Apply(CollisionScanArgs);
 
 BENCHMARK_MAIN();
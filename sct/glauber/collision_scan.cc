@@ -0,0 +1,90 @@
+#include "sct/glauber/collision_scan.h"
+
+#include "sct/lib/assert.h"
+
+#include <algorithm>
+
+namespace sct {
+
+CollisionScan::CollisionScan(const std::vector<Collision *> &collisions)
+    : collisions_(collisions) {
+  SCT_ASSERT(supported(collisions),
+             "CollisionScan requires the HardCore collision profile");
+
+  for (auto collision : collisions_)
+    radius2_.push_back(collision->interaction_radius2_);
+  std::sort(radius2_.begin(), radius2_.end());
+  radius2_.erase(std::unique(radius2_.begin(), radius2_.end()),
+                 radius2_.end());
+
+  for (auto collision : collisions_)
+    bucket_.push_back(std::lower_bound(radius2_.begin(), radius2_.end(),
+                                       collision->interaction_radius2_) -
+                      radius2_.begin());
+  pairs_.resize(radius2_.size());
+}
+
+bool CollisionScan::supported(const std::vector<Collision *> &collisions) {
+  for (auto collision : collisions)
+    if (collision->collisionProfile() != CollisionProfile::HardCore)
+      return false;
+  return true;
+}
+
+unsigned CollisionScan::collide(Nucleus &nucleus_A, Nucleus &nucleus_B) {
+  for (auto &bucket : pairs_)
+    bucket.clear();
+  if (radius2_.empty())
+    return 0;
+
+  // bucket every pair within the largest radius - a pair in bucket k collides
+  // for all radii from radius2_[k] on, with the same dR2 <= r2 test as the
+  // single collision search
+  const double *x_a = nucleus_A.xArray().data();
+  const double *y_a = nucleus_A.yArray().data();
+  const double *x_b = nucleus_B.xArray().data();
+  const double *y_b = nucleus_B.yArray().data();
+  unsigned n_a = nucleus_A.size();
+  unsigned n_b = nucleus_B.size();
+  double r2_max = radius2_.back();
+  distance2_.resize(n_b);
+  for (unsigned i = 0; i < n_a; ++i) {
+    // the distances are calculated in a separate loop, which vectorizes
+    for (unsigned j = 0; j < n_b; ++j) {
+      double dx = x_a[i] - x_b[j];
+      double dy = y_a[i] - y_b[j];
+      distance2_[j] = dx * dx + dy * dy;
+    }
+    for (unsigned j = 0; j < n_b; ++j) {
+      if (distance2_[j] > r2_max)
+        continue;
+      unsigned k = std::lower_bound(radius2_.begin(), radius2_.end(),
+                                    distance2_[j]) -
+                   radius2_.begin();
+      pairs_[k].emplace_back(i, j);
+    }
+  }
+
+  // each collision counts the pairs of its own bucket & all smaller ones
+  unsigned hits = 0;
+  for (unsigned c = 0; c < collisions_.size(); ++c) {
+    Collision &collision = *collisions_[c];
+    collision.clear();
+    nucleus_A.clearCollisions();
+    nucleus_B.clearCollisions();
+    unsigned *n_coll_a = nucleus_A.nCollArray().data();
+    unsigned *n_coll_b = nucleus_B.nCollArray().data();
+    for (unsigned k = 0; k <= bucket_[c]; ++k) {
+      for (auto &pair : pairs_[k]) {
+        n_coll_a[pair.first]++;
+        n_coll_b[pair.second]++;
+      }
+      collision.nColl_ += pairs_[k].size();
+    }
+    if (collision.eventAverages(nucleus_A, nucleus_B))
+      hits++;
+  }
+  return hits;
+}
+
+} // namespace sct
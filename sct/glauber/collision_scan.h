@@ -0,0 +1,59 @@
+#ifndef SCT_GLAUBER_COLLISION_SCAN_H
+#define SCT_GLAUBER_COLLISION_SCAN_H
+
+/* Collides a pair of nuclei with several HardCore collisions at once - for
+ * instance with the NN cross sections of all energies of a beam energy scan,
+ * or of the cross section systematics. The transverse distance of every
+ * nucleon pair is only calculated once: each pair within the largest
+ * interaction radius is put in the bucket of the smallest radius that it is
+ * within, and the colliding pairs of a cross section are then the buckets up
+ * to its own radius. Each collision is left with the same results (nColl,
+ * nPart, averages, eccentricities & participant planes) as its own
+ * Collision::collide() would give.
+ */
+
+#include "sct/glauber/collision.h"
+#include "sct/glauber/nucleus.h"
+
+#include <utility>
+#include <vector>
+
+namespace sct {
+
+class CollisionScan {
+ public:
+  // collisions are not owned, and must outlive the scan. Their cross sections
+  // are read here, so they must not be changed afterwards. All of them must
+  // use the HardCore profile (see supported())
+  explicit CollisionScan(const std::vector<Collision*>& collisions);
+
+  // true if the collisions can be scanned together - they all have to use
+  // the HardCore profile
+  static bool supported(const std::vector<Collision*>& collisions);
+
+  // collides the two nuclei with every collision, in the order they were
+  // given - with a multiplicity model, the random numbers are drawn in the
+  // same order as by calling collide() of each in turn. The collision counts
+  // left in the nuclei are those of the last collision. Returns the number of
+  // collisions with at least one binary collision
+  unsigned collide(Nucleus& nucleus_A, Nucleus& nucleus_B);
+
+  inline unsigned size() const { return collisions_.size(); }
+
+ private:
+  std::vector<Collision*> collisions_;
+
+  // sorted, distinct squared interaction radii, and the index of the radius
+  // of each collision
+  std::vector<double> radius2_;
+  std::vector<unsigned> bucket_;
+
+  // storage reused between events: the squared distances of one nucleon in A
+  // to all nucleons in B, and the (A, B) indices of the pairs in each bucket
+  std::vector<double> distance2_;
+  std::vector<std::vector<std::pair<unsigned, unsigned>>> pairs_;
+};
+
+}  // namespace sct
+
+#endif  // SCT_GLAUBER_COLLISION_SCAN_H
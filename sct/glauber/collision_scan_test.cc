@@ -0,0 +1,78 @@
+#include "sct/glauber/collision.h"
+#include "sct/glauber/collision_scan.h"
+#include "sct/glauber/nucleus.h"
+#include "sct/lib/enumerations.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// the scan gives every collision the same results as its own collide(), for
+// cross sections in any order, including duplicates
+TEST(CollisionScan, matchesCollide) {
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(sct::GlauberSpecies::Au197);
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(sct::GlauberSpecies::Au197);
+
+  std::vector<double> xsecs{6.4, 3.08, 4.2, 4.2, 3.6};
+  std::vector<sct::Collision> scanned(xsecs.size());
+  std::vector<sct::Collision> single(xsecs.size());
+  std::vector<sct::Collision*> collisions;
+  for (unsigned i = 0; i < xsecs.size(); ++i) {
+    scanned[i].setNNCrossSection(xsecs[i]);
+    single[i].setNNCrossSection(xsecs[i]);
+    collisions.push_back(&scanned[i]);
+  }
+  ASSERT_TRUE(sct::CollisionScan::supported(collisions));
+  sct::CollisionScan scan(collisions);
+
+  for (int event = 0; event < 50; ++event) {
+    double b = 0.3 * event;
+    nucleusA.generate(-b / 2.0);
+    nucleusB.generate(b / 2.0);
+    sct::Nucleus copyA(nucleusA);
+    sct::Nucleus copyB(nucleusB);
+
+    unsigned hits = 0;
+    for (unsigned i = 0; i < xsecs.size(); ++i) {
+      copyA.clearCollisions();
+      copyB.clearCollisions();
+      if (single[i].collide(copyA, copyB))
+        hits++;
+    }
+    EXPECT_EQ(scan.collide(nucleusA, nucleusB), hits);
+
+    for (unsigned i = 0; i < xsecs.size(); ++i) {
+      EXPECT_EQ(scanned[i].nColl(), single[i].nColl());
+      EXPECT_EQ(scanned[i].nPart(), single[i].nPart());
+      EXPECT_EQ(scanned[i].spectators(), single[i].spectators());
+      for (unsigned w = 0; w < sct::nGlauberWeights; ++w) {
+        EXPECT_DOUBLE_EQ(scanned[i].averageX()[w], single[i].averageX()[w]);
+        EXPECT_DOUBLE_EQ(scanned[i].reactionPlane2Ecc()[w],
+                         single[i].reactionPlane2Ecc()[w]);
+        EXPECT_DOUBLE_EQ(scanned[i].partPlane2Ecc()[w],
+                         single[i].partPlane2Ecc()[w]);
+        EXPECT_DOUBLE_EQ(scanned[i].partPlane3Ecc()[w],
+                         single[i].partPlane3Ecc()[w]);
+      }
+    }
+
+    // the nuclei are left with the counts of the last collision
+    for (unsigned j = 0; j < nucleusA.size(); ++j)
+      EXPECT_EQ(nucleusA[j].nColl(), copyA[j].nColl());
+    for (unsigned j = 0; j < nucleusB.size(); ++j)
+      EXPECT_EQ(nucleusB[j].nColl(), copyB[j].nColl());
+  }
+}
+
+// the Gaussian profile draws random numbers per pair, and can not be scanned
+TEST(CollisionScan, supported) {
+  sct::Collision hard_core;
+  hard_core.setNNCrossSection(4.2);
+  sct::Collision gaussian(hard_core);
+  gaussian.setCollisionProfile(sct::CollisionProfile::Gaussian);
+
+  EXPECT_TRUE(sct::CollisionScan::supported({&hard_core}));
+  EXPECT_FALSE(sct::CollisionScan::supported({&hard_core, &gaussian}));
+}
@@ -408,3 +408,152 @@ TEST(Collision, multipleProtonCollisionSpectators) {
   EXPECT_EQ(collision.countArray()[1] / 2, 3);
   EXPECT_EQ(collision.countArray()[0], 4);
 }
+
+// test that the cell list search finds exactly the same collisions as the
+// brute force search for a hard core collision profile
+TEST(Collision, cellListSearch) {
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(sct::GlauberSpecies::Au197);
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(sct::GlauberSpecies::Au197);
+
+  sct::Collision brute_force;
+  brute_force.setCollisionProfile(sct::CollisionProfile::HardCore);
+  brute_force.setNNCrossSection(4.2);
+  sct::Collision cell_list(brute_force);
+  cell_list.setCollisionSearch(sct::CollisionSearch::CellList);
+
+  EXPECT_EQ(brute_force.collisionSearch(), sct::CollisionSearch::BruteForce);
+  EXPECT_EQ(cell_list.collisionSearch(), sct::CollisionSearch::CellList);
+
+  for (int i = 0; i < 50; ++i) {
+    double b = 0.3 * i;
+    nucleusA.generate(-b / 2.0);
+    nucleusB.generate(b / 2.0);
+    sct::Nucleus copyA(nucleusA);
+    sct::Nucleus copyB(nucleusB);
+
+    bool bf_collided = brute_force.collide(nucleusA, nucleusB);
+    bool cl_collided = cell_list.collide(copyA, copyB);
+
+    EXPECT_EQ(bf_collided, cl_collided);
+    EXPECT_EQ(brute_force.nColl(), cell_list.nColl());
+    EXPECT_EQ(brute_force.nPart(), cell_list.nPart());
+    EXPECT_EQ(brute_force.spectators(), cell_list.spectators());
+    for (int j = 0; j < nucleusA.size(); ++j)
+      EXPECT_EQ(nucleusA[j].nColl(), copyA[j].nColl());
+    for (int j = 0; j < nucleusB.size(); ++j)
+      EXPECT_EQ(nucleusB[j].nColl(), copyB[j].nColl());
+  }
+}
+
+// compare the participant planes & eccentricities for all orders against a
+// direct calculation with trig functions
+TEST(Collision, participantPlaneAllOrders) {
+  sct::Collision collision;
+  collision.setCollisionProfile(sct::CollisionProfile::HardCore);
+  collision.setNNCrossSection(4.2);
+
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(sct::GlauberSpecies::Cu63);
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(sct::GlauberSpecies::Cu63);
+
+  for (int event = 0; event < 20; ++event) {
+    nucleusA.generate(-1.5);
+    nucleusB.generate(1.5);
+    if (!collision.collide(nucleusA, nucleusB))
+      continue;
+
+    for (int idx : {0, 1, 2}) {
+      for (int order : {2, 3, 4}) {
+        double qx = 0.0;
+        double qy = 0.0;
+        double qw = 0.0;
+        for (auto nucleus : {&nucleusA, &nucleusB}) {
+          for (int i = 0; i < nucleus->size(); ++i) {
+            unsigned n_coll = (*nucleus)[i].nColl();
+            if ((idx == 2) != (n_coll == 0))
+              continue;
+            double weight = idx == 1 ? n_coll : 1.0;
+            double dx = (*nucleus)[i].x() - collision.averageX()[idx];
+            double dy = (*nucleus)[i].y() - collision.averageY()[idx];
+            double r2 = dx * dx + dy * dy;
+            double phi = atan2(dy, dx);
+            qx += weight * r2 * cos(order * phi);
+            qy += weight * r2 * sin(order * phi);
+            qw += weight * r2;
+          }
+        }
+
+        double plane = order == 2 ? collision.partPlane2()[idx]
+                                  : order == 3 ? collision.partPlane3()[idx]
+                                               : collision.partPlane4()[idx];
+        double ecc = order == 2 ? collision.partPlane2Ecc()[idx]
+                                : order == 3 ? collision.partPlane3Ecc()[idx]
+                                             : collision.partPlane4Ecc()[idx];
+        EXPECT_NEAR(plane, atan2(qy, -qx), 1e-8);
+        EXPECT_NEAR(ecc, sqrt(qx * qx + qy * qy) / qw, 1e-8);
+      }
+    }
+  }
+}
+
+// the tabulated Gaussian profile must match the exact probability up to the
+// cutoff distance, and be zero beyond it, for small & large cutoffs
+TEST(Collision, gaussianProfileTable) {
+  sct::Collision collision;
+  collision.setCollisionProfile(sct::CollisionProfile::Gaussian);
+  collision.setNNCrossSection(4.2);
+  double sigma = sqrt(4.2 / sct::pi);
+
+  for (double cutoff : {4.0, 20.0}) {
+    collision.setGaussianCutoff(cutoff);
+    EXPECT_NEAR(collision.maxInteractionDistance(), cutoff * sigma, 1e-12);
+
+    for (int i = 0; i < 1000; ++i) {
+      double d = 1.25 * cutoff * sigma * i / 1000.0;
+      double expected =
+          d < cutoff * sigma ? exp(-d * d / (2.0 * sigma * sigma)) : 0;
+      EXPECT_NEAR(collision.collisionProbability(d * 0.6, d * 0.8), expected,
+                  1e-5);
+    }
+  }
+}
+
+// with the Gaussian profile, both searches must give the expected number of
+// binary collisions
+TEST(Collision, gaussianCellListSearch) {
+  sct::Nucleus nucleusA;
+  nucleusA.setParameters(sct::GlauberSpecies::Cu63);
+  sct::Nucleus nucleusB;
+  nucleusB.setParameters(sct::GlauberSpecies::Cu63);
+  nucleusA.generate(-2.0);
+  nucleusB.generate(2.0);
+
+  sct::Collision brute_force;
+  brute_force.setCollisionProfile(sct::CollisionProfile::Gaussian);
+  brute_force.setNNCrossSection(4.2);
+  sct::Collision cell_list(brute_force);
+  cell_list.setCollisionSearch(sct::CollisionSearch::CellList);
+
+  double expected = 0.0;
+  for (int i = 0; i < nucleusA.size(); ++i)
+    for (int j = 0; j < nucleusB.size(); ++j)
+      expected += brute_force.collisionProbability(
+          nucleusA[i].x() - nucleusB[j].x(), nucleusA[i].y() - nucleusB[j].y());
+
+  int n_trials = 200;
+  for (auto collision : {&brute_force, &cell_list}) {
+    double sum = 0.0;
+    for (int trial = 0; trial < n_trials; ++trial) {
+      sct::Nucleus copyA(nucleusA);
+      sct::Nucleus copyB(nucleusB);
+      collision->collide(copyA, copyB);
+      sum += collision->nColl();
+    }
+    // nColl is a sum of independent Bernoulli trials, so its variance is at
+    // most its mean
+    EXPECT_NEAR(sum / n_trials, expected, 5.0 * sqrt(expected / n_trials));
+  }
+}
@@ -0,0 +1,89 @@
+#include "sct/glauber/event_sink.h"
+
+#include "sct/lib/string/string_utils.h"
+#include "sct/utils/random.h"
+
+namespace sct {
+
+void GlauberEventBatch::reserve(unsigned n) {
+  b.reserve(n);
+  weight.reserve(n);
+  n_part.reserve(n);
+  n_coll.reserve(n);
+  n_spec.reserve(n);
+  multiplicity.reserve(n);
+  for (unsigned i = 0; i < nGlauberWeights; ++i) {
+    rp2ecc[i].reserve(n);
+    pp2ecc[i].reserve(n);
+    pp3ecc[i].reserve(n);
+    pp4ecc[i].reserve(n);
+  }
+}
+
+void GlauberEventBatch::push_back(const GlauberEvent &event) {
+  b.push_back(event.b);
+  weight.push_back(event.weight);
+  n_part.push_back(event.n_part);
+  n_coll.push_back(event.n_coll);
+  n_spec.push_back(event.n_spec);
+  multiplicity.push_back(event.multiplicity);
+  for (unsigned i = 0; i < nGlauberWeights; ++i) {
+    rp2ecc[i].push_back(event.rp2ecc[i]);
+    pp2ecc[i].push_back(event.pp2ecc[i]);
+    pp3ecc[i].push_back(event.pp3ecc[i]);
+    pp4ecc[i].push_back(event.pp4ecc[i]);
+  }
+}
+
+void GlauberEventBatch::clear() {
+  b.clear();
+  weight.clear();
+  n_part.clear();
+  n_coll.clear();
+  n_spec.clear();
+  multiplicity.clear();
+  for (unsigned i = 0; i < nGlauberWeights; ++i) {
+    rp2ecc[i].clear();
+    pp2ecc[i].clear();
+    pp3ecc[i].clear();
+    pp4ecc[i].clear();
+  }
+}
+
+BatchEventSink::BatchEventSink(unsigned batch_size)
+    : batch_size_(batch_size > 0 ? batch_size : 1) {
+  batch_.reserve(batch_size_);
+}
+
+void BatchEventSink::begin() { batch_.clear(); }
+
+void BatchEventSink::end() {
+  if (batch_.size() > 0)
+    batch(batch_);
+  batch_.clear();
+}
+
+void BatchEventSink::event(const GlauberEvent &event) {
+  batch_.push_back(event);
+  if (batch_.size() == batch_size_) {
+    batch(batch_);
+    batch_.clear();
+  }
+}
+
+NPartNCollSink::NPartNCollSink(unsigned n_nucleons) {
+  unsigned npart_bins = n_nucleons + 1;
+  unsigned ncoll_bins = n_nucleons * 4;
+  npart_ncoll_ = make_unique<TH2D>(
+      MakeString("npartncoll_sink_", Counter::instance().counter()).c_str(),
+      ";nPart;nColl", npart_bins, 0, npart_bins, ncoll_bins, 0, ncoll_bins);
+  npart_ncoll_->SetDirectory(0);
+}
+
+void NPartNCollSink::begin() { npart_ncoll_->Reset(); }
+
+void NPartNCollSink::event(const GlauberEvent &event) {
+  npart_ncoll_->Fill(event.n_part, event.n_coll, event.weight);
+}
+
+} // namespace sct
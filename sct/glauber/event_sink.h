@@ -0,0 +1,142 @@
+#ifndef SCT_GLAUBER_EVENT_SINK_H
+#define SCT_GLAUBER_EVENT_SINK_H
+
+/* Receivers for the events generated by MCGlauber, as an alternative (or in
+ * addition) to the GlauberTree. Sinks are registered with
+ * MCGlauber::addEventSink(), and receive every accepted event in order, from
+ * the thread that called run(), so they need no locking of their own:
+ *
+ * NPartNCollSink npart_ncoll(394);
+ * generator.addEventSink(&npart_ncoll);
+ * generator.setTreeOutput(false);
+ * generator.run(1e6, 8);
+ * NBDFit fitter(data, npart_ncoll.histogram());
+ *
+ * EventSink is the per-event interface. BatchEventSink collects events into a
+ * structure of arrays (GlauberEventBatch), and hands out a batch every
+ * batchSize() events, and a last partial batch at the end of the run.
+ */
+
+#include "sct/glauber/glauber_tree.h"
+#include "sct/lib/enumerations.h"
+#include "sct/lib/memory.h"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "TH2D.h"
+
+namespace sct {
+
+class EventSink {
+public:
+  virtual ~EventSink() {}
+
+  // called at the start and at the end of every run
+  virtual void begin() {}
+  virtual void end() {}
+
+  // called for every accepted event
+  virtual void event(const GlauberEvent &event) = 0;
+};
+
+// event quantities for a batch of events, as one array per quantity. The
+// eccentricities are indexed by GlauberWeight first, then by event
+struct GlauberEventBatch {
+  std::vector<double> b;
+  std::vector<double> weight;
+  std::vector<unsigned> n_part;
+  std::vector<unsigned> n_coll;
+  std::vector<unsigned> n_spec;
+  std::vector<unsigned> multiplicity;
+  std::array<std::vector<double>, nGlauberWeights> rp2ecc;
+  std::array<std::vector<double>, nGlauberWeights> pp2ecc;
+  std::array<std::vector<double>, nGlauberWeights> pp3ecc;
+  std::array<std::vector<double>, nGlauberWeights> pp4ecc;
+
+  inline unsigned size() const { return b.size(); }
+
+  void reserve(unsigned n);
+  void push_back(const GlauberEvent &event);
+  void clear();
+};
+
+class BatchEventSink : public EventSink {
+public:
+  explicit BatchEventSink(unsigned batch_size);
+
+  void begin() override;
+  void end() override;
+  void event(const GlauberEvent &event) override;
+
+  inline unsigned batchSize() const { return batch_size_; }
+
+protected:
+  // called with every full batch, and with the remaining events at the end of
+  // the run
+  virtual void batch(const GlauberEventBatch &batch) = 0;
+
+private:
+  unsigned batch_size_;
+  GlauberEventBatch batch_;
+};
+
+// calls a function for every event
+class CallbackEventSink : public EventSink {
+public:
+  explicit CallbackEventSink(std::function<void(const GlauberEvent &)> f)
+      : callback_(f) {}
+
+  void event(const GlauberEvent &event) override { callback_(event); }
+
+private:
+  std::function<void(const GlauberEvent &)> callback_;
+};
+
+// calls a function for every batch of events
+class CallbackBatchSink : public BatchEventSink {
+public:
+  CallbackBatchSink(unsigned batch_size,
+                    std::function<void(const GlauberEventBatch &)> f)
+      : BatchEventSink(batch_size), callback_(f) {}
+
+protected:
+  void batch(const GlauberEventBatch &batch) override { callback_(batch); }
+
+private:
+  std::function<void(const GlauberEventBatch &)> callback_;
+};
+
+// fills the nPart x nColl distribution, with the event weights - the input
+// for NBDFit. n_nucleons is the total number of nucleons in both nuclei. The
+// histogram is reset at the start of every run
+class NPartNCollSink : public EventSink {
+public:
+  explicit NPartNCollSink(unsigned n_nucleons);
+
+  void begin() override;
+  void event(const GlauberEvent &event) override;
+
+  TH2D *histogram() { return npart_ncoll_.get(); }
+
+private:
+  unique_ptr<TH2D> npart_ncoll_;
+};
+
+// writes every event to a GlauberTree, which is not owned by the sink
+class GlauberTreeSink : public EventSink {
+public:
+  explicit GlauberTreeSink(GlauberTree *tree) : tree_(tree) {}
+
+  void event(const GlauberEvent &event) override { tree_->fill(event); }
+
+  GlauberTree *tree() { return tree_; }
+
+private:
+  GlauberTree *tree_;
+};
+
+} // namespace sct
+
+#endif // SCT_GLAUBER_EVENT_SINK_H
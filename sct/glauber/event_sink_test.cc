@@ -0,0 +1,95 @@
+#include "sct/glauber/event_sink.h"
+#include "sct/glauber/glauber_tree.h"
+#include "sct/glauber/mc_glauber.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "TH2D.h"
+
+// batches are handed out every batch size events, with a last partial batch,
+// and hold the same events as the tree
+TEST(EventSink, batches) {
+  int nEvents = 25;
+
+  std::vector<unsigned> batch_sizes;
+  std::vector<double> b;
+  std::vector<unsigned> n_part;
+  sct::CallbackBatchSink sink(10, [&](const sct::GlauberEventBatch& batch) {
+    batch_sizes.push_back(batch.size());
+    b.insert(b.end(), batch.b.begin(), batch.b.end());
+    n_part.insert(n_part.end(), batch.n_part.begin(), batch.n_part.end());
+  });
+
+  sct::MCGlauber generator;
+  generator.addEventSink(&sink);
+  generator.run(nEvents, 2);
+
+  EXPECT_EQ(batch_sizes, (std::vector<unsigned>{10, 10, 5}));
+
+  sct::GlauberTree* tree = generator.results();
+  ASSERT_EQ(tree->getEntries(), nEvents);
+  ASSERT_EQ(b.size(), nEvents);
+  for (int i = 0; i < nEvents; ++i) {
+    tree->getEntry(i);
+    EXPECT_EQ(b[i], tree->B());
+    EXPECT_EQ(n_part[i], tree->nPart());
+  }
+}
+
+// with a multiplicity model, the batches & the tree hold the multiplicity of
+// each event
+TEST(EventSink, multiplicity) {
+  int nEvents = 20;
+
+  std::vector<unsigned> multiplicity;
+  sct::CallbackBatchSink sink(10, [&](const sct::GlauberEventBatch& batch) {
+    multiplicity.insert(multiplicity.end(), batch.multiplicity.begin(),
+                        batch.multiplicity.end());
+  });
+
+  sct::MCGlauber generator;
+  generator.setSeed(1234);
+  generator.setMultiplicityModel(2.38, 2.0, 0.13, 0.98, 0.84, 540);
+  generator.addEventSink(&sink);
+  generator.run(nEvents);
+
+  sct::GlauberTree* tree = generator.results();
+  ASSERT_EQ(multiplicity.size(), nEvents);
+  unsigned sum = 0;
+  for (int i = 0; i < nEvents; ++i) {
+    tree->getEntry(i);
+    EXPECT_EQ(multiplicity[i], tree->multiplicity());
+    sum += multiplicity[i];
+  }
+  EXPECT_GT(sum, 0);
+}
+
+// the npart x ncoll sink gives the same histogram as the tree, and works
+// without tree output
+TEST(EventSink, nPartNColl) {
+  int nEvents = 50;
+
+  sct::MCGlauber generator_tree;
+  generator_tree.setSeed(1234);
+  generator_tree.run(nEvents);
+
+  sct::NPartNCollSink sink(2 * 197);
+  sct::MCGlauber generator_sink;
+  generator_sink.setSeed(1234);
+  generator_sink.setTreeOutput(false);
+  generator_sink.addEventSink(&sink);
+  generator_sink.run(nEvents);
+
+  EXPECT_EQ(generator_sink.results()->getEntries(), 0);
+  EXPECT_EQ(sink.histogram()->GetEntries(), nEvents);
+
+  sct::GlauberTree* tree = generator_tree.results();
+  TH2D* histogram = sink.histogram();
+  for (int i = 0; i < nEvents; ++i) {
+    tree->getEntry(i);
+    int bin = histogram->FindBin(tree->nPart(), tree->nColl());
+    EXPECT_GE(histogram->GetBinContent(bin), 1.0);
+  }
+}
@@ -0,0 +1,238 @@
+#include "sct/glauber/glauber_merge.h"
+
+#include "sct/lib/logging.h"
+#include "sct/lib/math.h"
+#include "sct/lib/memory.h"
+#include "sct/lib/string/string_utils.h"
+#include "sct/utils/random.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "TClass.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TTree.h"
+
+namespace sct {
+
+namespace {
+// sums of the event weights (and squared weights) of the generated & the
+// accepted events of one input, which determine its cross section
+struct WeightSums {
+  double generated = 0.0;
+  double generated2 = 0.0;
+  double accepted = 0.0;
+  double accepted2 = 0.0;
+};
+
+// reads the exact weight sums from the run state MCGlauber stores in its
+// output files. Returns false if the file has no run state
+bool ReadRunState(TFile &file, WeightSums &sums) {
+  TDirectory *dir = file.GetDirectory("checkpoint");
+  TTree *state = dir == nullptr ? nullptr : (TTree *)dir->Get("state");
+  if (state == nullptr)
+    return false;
+  state->SetBranchAddress("weightgenerated", &sums.generated);
+  state->SetBranchAddress("weight2generated", &sums.generated2);
+  state->SetBranchAddress("weightaccepted", &sums.accepted);
+  state->SetBranchAddress("weight2accepted", &sums.accepted2);
+  bool found = state->GetEntry(0) > 0;
+  delete state;
+  return found;
+}
+
+// the weight sums of an input without a run state: the accepted sums are
+// taken from its events, and the generated sums follow from the header cross
+// section & error, which MCGlauber::writeHeader calculates as
+//   x = area * accepted / generated
+//   (error / x)^2 = accepted2 / accepted^2 + generated2 / generated^2
+// For unweighted inputs, these are the event counters
+WeightSums HeaderWeightSums(const GlauberTree &tree, double accepted,
+                            double accepted2) {
+  WeightSums sums;
+  bool unweighted = accepted == tree.NEventsAccepted() &&
+                    accepted2 == tree.NEventsAccepted();
+  if (unweighted || accepted <= 0.0 || tree.totalXsec() <= 0.0) {
+    sums.generated = tree.NEventsThrown();
+    sums.generated2 = tree.NEventsThrown();
+    sums.accepted = tree.NEventsAccepted();
+    sums.accepted2 = tree.NEventsAccepted();
+    return sums;
+  }
+
+  double area = (pow(tree.BMax(), 2) - pow(tree.BMin(), 2)) * pi * 10;
+  double relative2 = pow(tree.totalXsecError() / tree.totalXsec(), 2) -
+                     accepted2 / pow(accepted, 2);
+  sums.accepted = accepted;
+  sums.accepted2 = accepted2;
+  sums.generated = area * accepted / tree.totalXsec();
+  sums.generated2 = std::max(relative2, 0.0) * pow(sums.generated, 2);
+  return sums;
+}
+
+// adds the top level histograms of file to histograms - the first histogram
+// of each name is copied
+void MergeHistograms(TFile &file,
+                     std::map<string, unique_ptr<TH1>> &histograms) {
+  // keys are listed once for each cycle - Get() returns the latest
+  std::set<string> names;
+  TIter next(file.GetListOfKeys());
+  while (TKey *key = (TKey *)next()) {
+    TClass *type = TClass::GetClass(key->GetClassName());
+    if (type != nullptr && type->InheritsFrom("TH1"))
+      names.insert(key->GetName());
+  }
+
+  for (auto &name : names) {
+    TH1 *histogram = (TH1 *)file.Get(name.c_str());
+    if (histogram == nullptr)
+      continue;
+    unique_ptr<TH1> &merged = histograms[name];
+    if (merged == nullptr) {
+      merged.reset((TH1 *)histogram->Clone(
+          MakeString(name, "_", Counter::instance().counter()).c_str()));
+      merged->SetDirectory(0);
+    } else {
+      merged->Add(histogram);
+    }
+    delete histogram;
+  }
+}
+} // namespace
+
+bool CompatibleGlauberHeaders(const GlauberTree &a, const GlauberTree &b,
+                              string *reason) {
+  string difference;
+  auto differ = [&](bool equal, const string &setting) {
+    if (!equal && difference.empty())
+      difference = setting;
+  };
+
+  differ(a.nameNucleusA() == b.nameNucleusA(), "nucleus A");
+  differ(a.nameNucleusB() == b.nameNucleusB(), "nucleus B");
+  differ(a.massNumberA() == b.massNumberA(), "mass number A");
+  differ(a.massNumberB() == b.massNumberB(), "mass number B");
+  differ(a.radiusA() == b.radiusA(), "radius A");
+  differ(a.radiusB() == b.radiusB(), "radius B");
+  differ(a.skinDepthA() == b.skinDepthA(), "skin depth A");
+  differ(a.skinDepthB() == b.skinDepthB(), "skin depth B");
+  differ(a.beta2A() == b.beta2A(), "beta2 A");
+  differ(a.beta2B() == b.beta2B(), "beta2 B");
+  differ(a.beta4A() == b.beta4A(), "beta4 A");
+  differ(a.beta4B() == b.beta4B(), "beta4 B");
+  differ(a.hulthenAA() == b.hulthenAA(), "hulthen a A");
+  differ(a.hulthenAB() == b.hulthenAB(), "hulthen a B");
+  differ(a.hulthenBA() == b.hulthenBA(), "hulthen b A");
+  differ(a.hulthenBB() == b.hulthenBB(), "hulthen b B");
+  differ(a.sigmaNN() == b.sigmaNN(), "NN cross section");
+  differ(a.sqrtSNN() == b.sqrtSNN(), "collision energy");
+  differ(a.repulsionD() == b.repulsionD(), "repulsion distance");
+  differ(a.smearHardCore() == b.smearHardCore() &&
+             a.smearGaussian() == b.smearGaussian(),
+         "nucleon smearing");
+  differ(a.collisionHardCore() == b.collisionHardCore() &&
+             a.collisionGaussian() == b.collisionGaussian(),
+         "collision profile");
+  differ(a.BMin() == b.BMin() && a.BMax() == b.BMax(),
+         "impact parameter range");
+
+  if (reason != nullptr)
+    *reason = difference;
+  return difference.empty();
+}
+
+bool MergeGlauberTrees(const std::vector<string> &inputs,
+                       const string &output) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "no input files to merge";
+    return false;
+  }
+
+  // the headers are checked before anything is written
+  GlauberTree reference(GlauberTree::TreeMode::Read);
+  for (unsigned i = 0; i < inputs.size(); ++i) {
+    GlauberTree input(GlauberTree::TreeMode::Read);
+    if (!input.open(inputs[i]) || !input.getHeaderEntry(0)) {
+      LOG(ERROR) << "could not read the header of " << inputs[i]
+                 << ": is it the output of a finished run?";
+      return false;
+    }
+    if (i == 0) {
+      reference.open(inputs[i]);
+      reference.getHeaderEntry(0);
+      continue;
+    }
+    string reason;
+    if (!CompatibleGlauberHeaders(reference, input, &reason)) {
+      LOG(ERROR) << "can not merge " << inputs[i] << " with " << inputs[0]
+                 << ": the " << reason << " differs";
+      return false;
+    }
+  }
+
+  GlauberTree merged(GlauberTree::TreeMode::Write);
+  // the merge is bound by reading the inputs, so the tree is filled in this
+  // thread, alongside the ROOT reads
+  if (!merged.create(output))
+    return false;
+
+  unsigned events_accepted = 0;
+  unsigned events_thrown = 0;
+  WeightSums total;
+  std::map<string, unique_ptr<TH1>> histograms;
+  for (auto &filename : inputs) {
+    VLOG(1) << "merging " << filename;
+    GlauberTree input(GlauberTree::TreeMode::Read, filename);
+    input.getHeaderEntry(0);
+
+    double accepted = 0.0;
+    double accepted2 = 0.0;
+    for (unsigned i = 0; i < input.getEntries(); ++i) {
+      input.getEntry(i);
+      merged.fill(input.event());
+      accepted += input.weight();
+      accepted2 += input.weight() * input.weight();
+    }
+
+    WeightSums sums;
+    if (!ReadRunState(*input.file(), sums))
+      sums = HeaderWeightSums(input, accepted, accepted2);
+    total.generated += sums.generated;
+    total.generated2 += sums.generated2;
+    total.accepted += sums.accepted;
+    total.accepted2 += sums.accepted2;
+    events_accepted += input.NEventsAccepted();
+    events_thrown += input.NEventsThrown();
+
+    MergeHistograms(*input.file(), histograms);
+  }
+
+  // the same cross section as MCGlauber::writeHeader, for the merged sample
+  merged.copyHeader(reference);
+  double area =
+      (pow(reference.BMax(), 2) - pow(reference.BMin(), 2)) * pi * 10;
+  double x_total = area * total.accepted / total.generated;
+  double x_error =
+      x_total * sqrt(total.accepted2 / pow(total.accepted, 2) +
+                     total.generated2 / pow(total.generated, 2));
+  merged.setNEventsAccepted(events_accepted);
+  merged.setNEventsThrown(events_thrown);
+  merged.setTotalXsec(x_total);
+  merged.setTotalXsecError(x_error);
+  merged.fillHeader();
+
+  {
+    TDirectory::TContext context(merged.file().get());
+    for (auto &histogram : histograms)
+      histogram.second->Write(histogram.first.c_str(), TObject::kOverwrite);
+  }
+  merged.close();
+  return true;
+}
+
+} // namespace sct
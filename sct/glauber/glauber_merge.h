@@ -0,0 +1,39 @@
+#ifndef SCT_GLAUBER_GLAUBER_MERGE_H
+#define SCT_GLAUBER_GLAUBER_MERGE_H
+
+/* Merges GlauberTree files, such as the outputs of MCGlauber runs with
+ * different seeds, into a single file. hadd can not be used for this, since
+ * it keeps one header entry per file, and does not combine the cross
+ * sections.
+ *
+ * The generator settings in the headers of all inputs must agree (see
+ * CompatibleGlauberHeaders). The merged header has the summed event counters,
+ * and a total cross section & error recomputed from the summed event weights
+ * of all inputs. The events are copied one input at a time, so memory use
+ * does not depend on the size of the inputs, and the histograms at the top
+ * level of the inputs (the QA histograms written by run_glauber) are added.
+ */
+
+#include "sct/glauber/glauber_tree.h"
+#include "sct/lib/string/string.h"
+
+#include <vector>
+
+namespace sct {
+
+// returns true if the generator settings in the current header entries of a &
+// b agree: nuclei, nuclear PDF parameters, NN cross section, energy,
+// repulsion distance, smearing, collision profile & impact parameter range.
+// Otherwise, the first difference is described in reason, if it is not null
+bool CompatibleGlauberHeaders(const GlauberTree &a, const GlauberTree &b,
+                              string *reason = nullptr);
+
+// merges the GlauberTree files inputs into output, which is overwritten.
+// Returns false if an input can not be read, or the inputs are not
+// compatible - in which case output is not created
+bool MergeGlauberTrees(const std::vector<string> &inputs,
+                       const string &output);
+
+} // namespace sct
+
+#endif // SCT_GLAUBER_GLAUBER_MERGE_H
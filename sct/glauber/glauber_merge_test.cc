@@ -0,0 +1,97 @@
+#include "sct/glauber/glauber_merge.h"
+#include "sct/glauber/glauber_tree.h"
+#include "sct/glauber/mc_glauber.h"
+#include "sct/lib/math.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// the merged file holds the events of all inputs in order, and a single header
+// with the summed counters & the cross section of the combined sample
+TEST(GlauberMerge, mergeSeeds) {
+  std::vector<int> nEvents{30, 20};
+  std::vector<std::string> inputs;
+  for (unsigned i = 0; i < nEvents.size(); ++i) {
+    inputs.push_back(testing::TempDir() + "glauber_merge_test_" +
+                     std::to_string(i) + ".root");
+    sct::MCGlauber generator;
+    generator.setSeed(1234 + i);
+    generator.setOutputFile(inputs.back());
+    generator.run(nEvents[i]);
+  }
+
+  std::string output = testing::TempDir() + "glauber_merge_test.root";
+  ASSERT_TRUE(sct::MergeGlauberTrees(inputs, output));
+
+  sct::GlauberTree merged(sct::GlauberTree::TreeMode::Read, output);
+  ASSERT_EQ(merged.getEntries(), nEvents[0] + nEvents[1]);
+  merged.getHeaderEntry(0);
+
+  unsigned accepted = 0;
+  unsigned thrown = 0;
+  unsigned entry = 0;
+  for (auto &filename : inputs) {
+    sct::GlauberTree input(sct::GlauberTree::TreeMode::Read, filename);
+    input.getHeaderEntry(0);
+    EXPECT_TRUE(sct::CompatibleGlauberHeaders(input, merged));
+    accepted += input.NEventsAccepted();
+    thrown += input.NEventsThrown();
+    for (unsigned i = 0; i < input.getEntries(); ++i, ++entry) {
+      input.getEntry(i);
+      merged.getEntry(entry);
+      EXPECT_EQ(merged.B(), input.B());
+      EXPECT_EQ(merged.nPart(), input.nPart());
+    }
+  }
+
+  double area = (pow(merged.BMax(), 2) - pow(merged.BMin(), 2)) * sct::pi * 10;
+  double xsec = area * accepted / thrown;
+  EXPECT_EQ(merged.NEventsAccepted(), accepted);
+  EXPECT_EQ(merged.NEventsThrown(), thrown);
+  EXPECT_NEAR(merged.totalXsec(), xsec, 1e-9 * xsec);
+  EXPECT_NEAR(merged.totalXsecError(),
+              xsec * sqrt(1.0 / accepted + 1.0 / thrown), 1e-9 * xsec);
+
+  for (auto &filename : inputs)
+    std::remove(filename.c_str());
+  std::remove(output.c_str());
+}
+
+// inputs with different settings are refused, and no output is written
+TEST(GlauberMerge, incompatibleHeaders) {
+  std::vector<std::string> inputs{
+      testing::TempDir() + "glauber_merge_test_a.root",
+      testing::TempDir() + "glauber_merge_test_b.root"};
+
+  sct::MCGlauber generator_a;
+  generator_a.setOutputFile(inputs[0]);
+  generator_a.run(10);
+
+  sct::MCGlauber generator_b;
+  generator_b.setImpactParameterRange(0, 10);
+  generator_b.setOutputFile(inputs[1]);
+  generator_b.run(10);
+
+  generator_a.results()->close();
+  generator_b.results()->close();
+
+  sct::GlauberTree tree_a(sct::GlauberTree::TreeMode::Read, inputs[0]);
+  sct::GlauberTree tree_b(sct::GlauberTree::TreeMode::Read, inputs[1]);
+  tree_a.getHeaderEntry(0);
+  tree_b.getHeaderEntry(0);
+  std::string reason;
+  EXPECT_FALSE(sct::CompatibleGlauberHeaders(tree_a, tree_b, &reason));
+  EXPECT_EQ(reason, "impact parameter range");
+
+  std::string output =
+      testing::TempDir() + "glauber_merge_incompatible_test.root";
+  std::remove(output.c_str());
+  EXPECT_FALSE(sct::MergeGlauberTrees(inputs, output));
+  EXPECT_EQ(fopen(output.c_str(), "r"), nullptr);
+
+  for (auto &filename : inputs)
+    std::remove(filename.c_str());
+}
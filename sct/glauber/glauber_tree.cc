@@ -3,14 +3,49 @@
 #include "sct/lib/logging.h"
 #include "sct/lib/math.h"
 
+#include "TDirectory.h"
+#include "TROOT.h"
+
 namespace sct {
 
+void GlauberEvent::clear() {
+  b = 0;
+  weight = 1;
+  n_part = 0;
+  n_coll = 0;
+  n_spec = 0;
+  multiplicity = 0;
+
+  for (unsigned i = 0; i < GlauberTree::n_nuclei; ++i) {
+    theta[i] = 0;
+    phi[i] = 0;
+  }
+
+  for (unsigned i = 0; i < nGlauberWeights; ++i) {
+    sum_x[i] = 0;
+    sum_y[i] = 0;
+    sum_x2[i] = 0;
+    sum_y2[i] = 0;
+    sum_xy[i] = 0;
+    rp2ecc[i] = 0;
+    pp2ecc[i] = 0;
+    pp3ecc[i] = 0;
+    pp4ecc[i] = 0;
+    pp2[i] = 0;
+    pp3[i] = 0;
+    pp4[i] = 0;
+  }
+}
+
 GlauberTree::GlauberTree(TreeMode mode, const string &filename)
-    : file_(), header_(nullptr), event_(nullptr), nameA_(new string()),
-      nameB_(new string()) {
+    : file_(), file_backed_(false), header_(nullptr), event_(nullptr),
+      auto_flush_(-30000000), auto_save_(-300000000), weight_(1.0),
+      nameA_(new string()), nameB_(new string()), libraryA_(new string()),
+      libraryB_(new string()), libraryReuse_(0) {
   switch (mode) {
   case TreeMode::Write:
-    createBranches();
+    if (filename.empty() || !create(filename))
+      createBranches();
     return;
   case TreeMode::Read:
     if (!filename.empty()) {
@@ -24,14 +59,143 @@ GlauberTree::GlauberTree(TreeMode mode, const string &filename)
 }
 
 GlauberTree::~GlauberTree() {
+  stopWriter();
   if (file_.get() == nullptr) {
     delete header_;
     delete event_;
   }
 }
 
+bool GlauberTree::create(const string &filename) {
+  flush();
+
+  // trees in a previous file are deleted with the file
+  if (file_ != nullptr) {
+    header_ = nullptr;
+    event_ = nullptr;
+  }
+  file_ = make_shared<TFile>(filename.c_str(), "RECREATE");
+  file_backed_ = true;
+  if (!file_->IsOpen()) {
+    LOG(ERROR) << "failed to create root file at " << filename
+               << " does the directory exist?";
+    file_.reset();
+    file_backed_ = false;
+    return false;
+  }
+
+  // new trees are attached to the current directory
+  TDirectory::TContext context(file_.get());
+  createBranches();
+  event_->SetAutoFlush(auto_flush_);
+  event_->SetAutoSave(auto_save_);
+  return true;
+}
+
+bool GlauberTree::update(const string &filename) {
+  flush();
+
+  // trees in a previous file are deleted with the file
+  if (file_ == nullptr) {
+    delete header_;
+    delete event_;
+  }
+  header_ = nullptr;
+  event_ = nullptr;
+  file_ = make_shared<TFile>(filename.c_str(), "UPDATE");
+  file_backed_ = false;
+  if (!file_->IsOpen()) {
+    LOG(ERROR) << "failed to open root file at " << filename
+               << " for update: does path exist?";
+    file_.reset();
+    return false;
+  }
+  event_ = (TTree *)file_->Get("event");
+  header_ = (TTree *)file_->Get("header");
+  if (event_ == nullptr || header_ == nullptr) {
+    LOG(ERROR) << "event or header tree not found in root file: was the"
+               << " file written by a sct GlauberTree?";
+    file_.reset();
+    header_ = nullptr;
+    event_ = nullptr;
+    return false;
+  }
+  file_backed_ = true;
+  loadBranches();
+  event_->SetAutoFlush(auto_flush_);
+  event_->SetAutoSave(auto_save_);
+  return true;
+}
+
+void GlauberTree::setAutoFlush(Long64_t val) {
+  flush();
+  auto_flush_ = val;
+  if (event_ != nullptr)
+    event_->SetAutoFlush(val);
+}
+
+void GlauberTree::setAutoSave(Long64_t val) {
+  flush();
+  auto_save_ = val;
+  if (event_ != nullptr)
+    event_->SetAutoSave(val);
+}
+
+void GlauberTree::setAsyncWrite(unsigned queue_size) {
+  stopWriter();
+  if (queue_size == 0)
+    return;
+
+  // the writer thread uses ROOT while the caller keeps using it
+  ROOT::EnableThreadSafety();
+  write_queue_ = make_unique<BoundedQueue<GlauberEvent>>(queue_size);
+  writer_ = std::thread([this]() {
+    GlauberEvent event;
+    while (write_queue_->pop(event)) {
+      copyEvent(event);
+      fillTree();
+      write_queue_->taskDone();
+    }
+  });
+}
+
+void GlauberTree::flush() const {
+  if (write_queue_ != nullptr)
+    write_queue_->wait();
+}
+
+void GlauberTree::stopWriter() {
+  if (write_queue_ == nullptr)
+    return;
+  write_queue_->close();
+  writer_.join();
+  write_queue_.reset();
+}
+
+void GlauberTree::save() {
+  if (!file_backed_ || file_ == nullptr)
+    return;
+  write();
+  file_->SaveSelf();
+  file_->Flush();
+}
+
+void GlauberTree::close() {
+  stopWriter();
+  if (!file_backed_ || file_ == nullptr)
+    return;
+  write();
+  file_->Close();
+  file_.reset();
+  file_backed_ = false;
+  header_ = nullptr;
+  event_ = nullptr;
+}
+
 void GlauberTree::clearEvent() {
+  flush();
   b_ = 0;
+  weight_ = 1;
   nPart_ = 0;
   nColl_ = 0;
 
@@ -111,6 +275,19 @@ bool GlauberTree::read(shared_ptr<TFile> file) {
 }
 
 void GlauberTree::write() {
+  flush();
+
+  // trees in our own file replace their autosaved copies - in memory trees
+  // are written to the current directory
+  if (file_backed_) {
+    TDirectory::TContext context(file_.get());
+    if (header_ != nullptr)
+      header_->Write("", TObject::kOverwrite);
+    if (event_ != nullptr)
+      event_->Write("", TObject::kOverwrite);
+    return;
+  }
+
   if (header_ != nullptr)
     header_->Write();
   if (event_ != nullptr)
@@ -138,6 +315,10 @@ void GlauberTree::loadBranches() {
   // load in the event TTree first
   VLOG(1) << "Loading event tree from file";
   event_->SetBranchAddress("b", &b_);
+  // trees from unweighted runs may not have a weight branch
+  weight_ = 1;
+  if (event_->GetBranch("weight") != nullptr)
+    event_->SetBranchAddress("weight", &weight_);
   event_->SetBranchAddress("npart", &nPart_);
   event_->SetBranchAddress("ncoll", &nColl_);
   event_->SetBranchAddress("nspec", &nSpec_);
@@ -187,6 +368,15 @@ void GlauberTree::loadBranches() {
   header_->SetBranchAddress("bmin", &bMin_);
   header_->SetBranchAddress("eventsaccepted", &eventsAccepted_);
   header_->SetBranchAddress("eventsthrown", &eventsThrown_);
+  // trees from runs before nucleus libraries have no library branches
+  libraryA_->clear();
+  libraryB_->clear();
+  libraryReuse_ = 0;
+  if (header_->GetBranch("libraryA") != nullptr) {
+    header_->SetBranchAddress("libraryA", &libraryA_);
+    header_->SetBranchAddress("libraryB", &libraryB_);
+    header_->SetBranchAddress("libraryreuse", &libraryReuse_);
+  }
 }
 
 void GlauberTree::createBranches() {
@@ -197,6 +387,7 @@ void GlauberTree::createBranches() {
   // create the event tree
   event_ = new TTree("event", "event-wise sct record");
   event_->Branch("b", &b_);
+  event_->Branch("weight", &weight_);
   event_->Branch("npart", &nPart_);
   event_->Branch("ncoll", &nColl_);
   event_->Branch("nspec", &nSpec_);
@@ -247,27 +438,47 @@ void GlauberTree::createBranches() {
   header_->Branch("bmin", &bMin_);
   header_->Branch("eventsaccepted", &eventsAccepted_);
   header_->Branch("eventsthrown", &eventsThrown_);
+  header_->Branch("libraryA", &libraryA_);
+  header_->Branch("libraryB", &libraryB_);
+  header_->Branch("libraryreuse", &libraryReuse_);
 }
 
 unsigned GlauberTree::getEntries() const {
+  flush();
   if (event_ != nullptr)
     return event_->GetEntries();
   return 0;
 }
 
 bool GlauberTree::getEntry(unsigned int idx) {
+  flush();
   if (event_ != nullptr)
     return event_->GetEntry(idx);
   return false;
 }
 
 bool GlauberTree::getHeaderEntry(unsigned int idx) {
+  flush();
   if (header_ != nullptr)
     return header_->GetEntry(idx);
   return false;
 }
 
 void GlauberTree::fill() {
+  flush();
+  fillTree();
+}
+
+void GlauberTree::fill(const GlauberEvent &event) {
+  if (write_queue_ != nullptr) {
+    write_queue_->push(event);
+    return;
+  }
+  copyEvent(event);
+  fillTree();
+}
+
+void GlauberTree::fillTree() {
   if (event_ != nullptr) {
     event_->Fill();
   } else {
@@ -276,7 +487,74 @@ void GlauberTree::fill() {
   }
 }
 
+void GlauberTree::setEvent(const GlauberEvent &event) {
+  flush();
+  copyEvent(event);
+}
+
+void GlauberTree::copyEvent(const GlauberEvent &event) {
+  b_ = event.b;
+  weight_ = event.weight;
+  nPart_ = event.n_part;
+  nColl_ = event.n_coll;
+  nSpec_ = event.n_spec;
+  multiplicity_ = event.multiplicity;
+
+  for (unsigned i = 0; i < n_nuclei; ++i) {
+    theta_[i] = event.theta[i];
+    phi_[i] = event.phi[i];
+  }
+
+  for (unsigned i = 0; i < nGlauberWeights; ++i) {
+    sumX_[i] = event.sum_x[i];
+    sumY_[i] = event.sum_y[i];
+    sumX2_[i] = event.sum_x2[i];
+    sumY2_[i] = event.sum_y2[i];
+    sumXY_[i] = event.sum_xy[i];
+    rp2ecc_[i] = event.rp2ecc[i];
+    pp2ecc_[i] = event.pp2ecc[i];
+    pp3ecc_[i] = event.pp3ecc[i];
+    pp4ecc_[i] = event.pp4ecc[i];
+    pp2_[i] = event.pp2[i];
+    pp3_[i] = event.pp3[i];
+    pp4_[i] = event.pp4[i];
+  }
+}
+
+GlauberEvent GlauberTree::event() const {
+  flush();
+  GlauberEvent event;
+  event.b = b_;
+  event.weight = weight_;
+  event.n_part = nPart_;
+  event.n_coll = nColl_;
+  event.n_spec = nSpec_;
+  event.multiplicity = multiplicity_;
+
+  for (unsigned i = 0; i < n_nuclei; ++i) {
+    event.theta[i] = theta_[i];
+    event.phi[i] = phi_[i];
+  }
+
+  for (unsigned i = 0; i < nGlauberWeights; ++i) {
+    event.sum_x[i] = sumX_[i];
+    event.sum_y[i] = sumY_[i];
+    event.sum_x2[i] = sumX2_[i];
+    event.sum_y2[i] = sumY2_[i];
+    event.sum_xy[i] = sumXY_[i];
+    event.rp2ecc[i] = rp2ecc_[i];
+    event.pp2ecc[i] = pp2ecc_[i];
+    event.pp3ecc[i] = pp3ecc_[i];
+    event.pp4ecc[i] = pp4ecc_[i];
+    event.pp2[i] = pp2_[i];
+    event.pp3[i] = pp3_[i];
+    event.pp4[i] = pp4_[i];
+  }
+  return event;
+}
+
 void GlauberTree::fillHeader() {
+  flush();
   if (header_ != nullptr) {
     header_->Fill();
   } else {
@@ -285,4 +563,46 @@ void GlauberTree::fillHeader() {
   }
 }
 
+void GlauberTree::clearHeader() {
+  flush();
+  if (header_ != nullptr)
+    header_->Reset();
+}
+
+void GlauberTree::copyHeader(const GlauberTree &rhs) {
+  flush();
+  *nameA_ = *rhs.nameA_;
+  *nameB_ = *rhs.nameB_;
+  massNumberA_ = rhs.massNumberA_;
+  massNumberB_ = rhs.massNumberB_;
+  radiusA_ = rhs.radiusA_;
+  radiusB_ = rhs.radiusB_;
+  skinDepthA_ = rhs.skinDepthA_;
+  skinDepthB_ = rhs.skinDepthB_;
+  beta2A_ = rhs.beta2A_;
+  beta2B_ = rhs.beta2B_;
+  beta4A_ = rhs.beta4A_;
+  beta4B_ = rhs.beta4B_;
+  hulthenaA_ = rhs.hulthenaA_;
+  hulthenaB_ = rhs.hulthenaB_;
+  hulthenbA_ = rhs.hulthenbA_;
+  hulthenbB_ = rhs.hulthenbB_;
+  sigmaNN_ = rhs.sigmaNN_;
+  sqrtSNN_ = rhs.sqrtSNN_;
+  repulsionD_ = rhs.repulsionD_;
+  totalXsec_ = rhs.totalXsec_;
+  totalXsecError_ = rhs.totalXsecError_;
+  smearHardCore_ = rhs.smearHardCore_;
+  smearGaussian_ = rhs.smearGaussian_;
+  collisionHardCore_ = rhs.collisionHardCore_;
+  collisionGaussian_ = rhs.collisionGaussian_;
+  bMax_ = rhs.bMax_;
+  bMin_ = rhs.bMin_;
+  eventsAccepted_ = rhs.eventsAccepted_;
+  eventsThrown_ = rhs.eventsThrown_;
+  *libraryA_ = *rhs.libraryA_;
+  *libraryB_ = *rhs.libraryB_;
+  libraryReuse_ = rhs.libraryReuse_;
+}
+
 } // namespace sct
@@ -3,24 +3,103 @@
 
 #include "sct/lib/enumerations.h"
 #include "sct/lib/memory.h"
+#include "sct/utils/bounded_queue.h"
+
+#include <thread>
 
 #include "TBranch.h"
 #include "TFile.h"
 #include "TTree.h"
 
 namespace sct {
+
+// the event-wise record of a GlauberTree as a plain value type - used to hold
+// events outside of the tree, for instance while they are passed between
+// generator threads
+struct GlauberEvent {
+  double b;
+  double weight;
+  unsigned n_part;
+  unsigned n_coll;
+  unsigned n_spec;
+  unsigned multiplicity;
+  double theta[2];
+  double phi[2];
+  double sum_x[nGlauberWeights];
+  double sum_y[nGlauberWeights];
+  double sum_x2[nGlauberWeights];
+  double sum_y2[nGlauberWeights];
+  double sum_xy[nGlauberWeights];
+  double rp2ecc[nGlauberWeights];
+  double pp2ecc[nGlauberWeights];
+  double pp3ecc[nGlauberWeights];
+  double pp4ecc[nGlauberWeights];
+  double pp2[nGlauberWeights];
+  double pp3[nGlauberWeights];
+  double pp4[nGlauberWeights];
+
+  GlauberEvent() { clear(); }
+
+  void clear();
+};
+
 class GlauberTree {
  public:
   static const unsigned n_nuclei = 2;  // 2 nucleus collision (A, B)
   enum class TreeMode { Read, Write };
 
-  // if filename is empty, assumes user wants to create a new tree
+  // if filename is empty, assumes user wants to create a new tree in memory.
+  // In Write mode, a filename creates the trees directly in a new file
   GlauberTree(TreeMode mode, const string& filename = "");
   virtual ~GlauberTree();
 
   // zeros values for the event tree
   void clearEvent();
 
+  // creates the file filename (overwriting any existing file), and creates
+  // new trees in it. Baskets of filled events are written to disk as the
+  // tree grows, so memory use does not grow with the number of events. Use
+  // write() or close() at the end, to store the final tree headers
+  bool create(const string& filename);
+
+  // opens an existing file written by create() to add events to its trees.
+  // New events are appended to the event tree, which is saved following
+  // setAutoFlush & setAutoSave like a created tree
+  bool update(const string& filename);
+
+  // basket flushing & tree header saving for trees in a file, following the
+  // TTree::SetAutoFlush and TTree::SetAutoSave conventions: positive values
+  // are a number of entries, negative values a number of bytes. The tree
+  // header is saved to the file at every autosave, so the output of a job
+  // that crashes can be read up to the last autosave. Defaults are 30 MB & 300
+  // MB
+  void setAutoFlush(Long64_t val);
+  void setAutoSave(Long64_t val);
+  inline Long64_t autoFlush() const { return auto_flush_; }
+  inline Long64_t autoSave() const { return auto_save_; }
+
+  // with a non-zero queue size, fill(event) copies the event into a queue of
+  // at most queue_size events, and a background thread fills the tree,
+  // including the compression of full baskets - so the caller only waits when
+  // the queue is full. Other member functions that use the tree first wait
+  // for the queue to empty, but the inline event setters & getters must not
+  // be used while events are queued. Zero (the default) fills in the calling
+  // thread. A non-zero queue size calls ROOT::EnableThreadSafety()
+  void setAsyncWrite(unsigned queue_size);
+  inline bool asyncWrite() const { return write_queue_ != nullptr; }
+
+  // blocks until all queued events are in the tree
+  void flush() const;
+
+  // writes the trees and the file directory made by create() or update() to
+  // disk, without closing the file - the file can be read up to this point if
+  // the job is killed later
+  void save();
+
+  // writes the trees and closes the file made by create() or update()
+  void close();
+  inline shared_ptr<TFile> file() const { return file_; }
+
   // to read a Tree from file, use open(filename)
   bool open(const string& filename);
 
@@ -31,9 +110,23 @@ class GlauberTree {
   // writes current values to event tree
   void fill();
 
+  // writes an event record to the event tree - queued if asyncWrite() is on
+  void fill(const GlauberEvent& event);
+
+  // copies an event record into (or out of) the current event values
+  void setEvent(const GlauberEvent& event);
+  GlauberEvent event() const;
+
   // writes current values to header tree
   void fillHeader();
 
+  // removes all entries from the header tree, to replace the header of an
+  // updated file
+  void clearHeader();
+
+  // copies the current header values of rhs into the header values
+  void copyHeader(const GlauberTree& rhs);
+
   // write to current TFile
   void write();
 
@@ -41,8 +134,11 @@ class GlauberTree {
   bool getEntry(unsigned int idx);
   bool getHeaderEntry(unsigned int idx = 0);
 
-  // event-wise variables
+  // event-wise variables. weight is the event weight from a biased impact
+  // parameter sampling (see MCGlauber::setImpactParameterStrata) - it is one
+  // for unbiased samples, and for trees written without a weight branch
   inline void setB(double val) { b_ = val; }
+  inline void setWeight(double val) { weight_ = val; }
   inline void setNpart(unsigned val) { nPart_ = val; }
   inline void setNcoll(unsigned val) { nColl_ = val; }
   inline void setNspectators(unsigned val) { nSpec_ = val; }
@@ -87,6 +183,7 @@ class GlauberTree {
   }
 
   inline double B() const { return b_; }
+  inline double weight() const { return weight_; }
   inline unsigned nPart() const { return nPart_; }
   inline unsigned nColl() const { return nColl_; }
   inline unsigned nSpectators() const { return nSpec_; }
@@ -164,6 +261,9 @@ class GlauberTree {
   inline void setBMin(double val) { bMin_ = val; }
   inline void setNEventsAccepted(unsigned val) { eventsAccepted_ = val; }
   inline void setNEventsThrown(unsigned val) { eventsThrown_ = val; }
+  inline void setLibraryA(const string& val) { *libraryA_ = val; }
+  inline void setLibraryB(const string& val) { *libraryB_ = val; }
+  inline void setLibraryReuse(unsigned val) { libraryReuse_ = val; }
 
   inline string nameNucleusA() const { return *nameA_; }
   inline string nameNucleusB() const { return *nameB_; }
@@ -194,16 +294,37 @@ class GlauberTree {
   inline double BMin() const { return bMin_; }
   inline unsigned NEventsAccepted() const { return eventsAccepted_; }
   inline unsigned NEventsThrown() const { return eventsThrown_; }
+  // nucleus library files & reuse count - empty & 0 without libraries (see
+  // MCGlauber::setNucleusLibrary)
+  inline string libraryA() const { return *libraryA_; }
+  inline string libraryB() const { return *libraryB_; }
+  inline unsigned libraryReuse() const { return libraryReuse_; }
 
  private:
   void loadBranches();
   void createBranches();
 
+  // copy an event into the branch values, and fill the event tree, without
+  // waiting for the queue
+  void copyEvent(const GlauberEvent& event);
+  void fillTree();
+
+  // drains the queue and stops the background writer thread
+  void stopWriter();
+
   shared_ptr<TFile> file_;
+  bool file_backed_;  // trees are owned by file_, from create() or update()
   TTree* header_;
   TTree* event_;
 
+  Long64_t auto_flush_;
+  Long64_t auto_save_;
+
+  unique_ptr<BoundedQueue<GlauberEvent>> write_queue_;
+  std::thread writer_;
+
   double b_;
+  double weight_;
   unsigned nPart_;
   unsigned nColl_;
   unsigned nSpec_;
@@ -252,6 +373,9 @@ class GlauberTree {
   double bMin_;
   unsigned eventsAccepted_;
   unsigned eventsThrown_;
+  string* libraryA_;
+  string* libraryB_;
+  unsigned libraryReuse_;
 };
 }  // namespace sct
 
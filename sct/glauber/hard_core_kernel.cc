@@ -0,0 +1,201 @@
+#include "sct/glauber/hard_core_kernel.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SCT_HARD_CORE_X86 1
+#include <immintrin.h>
+#endif
+
+// the squared distance must be rounded the same way by every kernel, so that
+// all instruction sets give identical results - gcc & clang would otherwise
+// contract the multiplies and adds into FMA instructions in the AVX-512 kernel
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace sct {
+
+namespace {
+
+// tests nucleon (x, y) against nucleons [begin, end) of B - used by all
+// kernels for the elements that do not fill a full vector
+inline unsigned scalarRow(double x, double y, const double* x_b,
+                          const double* y_b, unsigned begin, unsigned end,
+                          unsigned* ncoll_b, double r2) {
+  unsigned n = 0;
+  for (unsigned j = begin; j < end; ++j) {
+    double dx = x - x_b[j];
+    double dy = y - y_b[j];
+    if (dx * dx + dy * dy <= r2) {
+      ++ncoll_b[j];
+      ++n;
+    }
+  }
+  return n;
+}
+
+unsigned scalarKernel(const double* x_a, const double* y_a, unsigned n_a,
+                      unsigned* ncoll_a, const double* x_b, const double* y_b,
+                      unsigned n_b, unsigned* ncoll_b, double r2) {
+  unsigned total = 0;
+  for (unsigned i = 0; i < n_a; ++i) {
+    unsigned n = scalarRow(x_a[i], y_a[i], x_b, y_b, 0, n_b, ncoll_b, r2);
+    ncoll_a[i] += n;
+    total += n;
+  }
+  return total;
+}
+
+#ifdef SCT_HARD_CORE_X86
+
+// collisions are rare compared to the number of tested pairs, so the vector
+// kernels only fall back to scalar code to increment ncoll_b when at least one
+// lane of the comparison mask is set
+inline unsigned applyMask(unsigned mask, unsigned j, unsigned* ncoll_b) {
+  unsigned n = 0;
+  while (mask) {
+    unsigned lane = __builtin_ctz(mask);
+    ++ncoll_b[j + lane];
+    ++n;
+    mask &= mask - 1;
+  }
+  return n;
+}
+
+__attribute__((target("sse2"))) unsigned sse2Kernel(
+    const double* x_a, const double* y_a, unsigned n_a, unsigned* ncoll_a,
+    const double* x_b, const double* y_b, unsigned n_b, unsigned* ncoll_b,
+    double r2) {
+  const unsigned width = 2;
+  unsigned n_vec = n_b - n_b % width;
+  __m128d vr2 = _mm_set1_pd(r2);
+  unsigned total = 0;
+  for (unsigned i = 0; i < n_a; ++i) {
+    __m128d xa = _mm_set1_pd(x_a[i]);
+    __m128d ya = _mm_set1_pd(y_a[i]);
+    unsigned n = 0;
+    for (unsigned j = 0; j < n_vec; j += width) {
+      __m128d dx = _mm_sub_pd(xa, _mm_loadu_pd(x_b + j));
+      __m128d dy = _mm_sub_pd(ya, _mm_loadu_pd(y_b + j));
+      __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+      unsigned mask = _mm_movemask_pd(_mm_cmple_pd(d2, vr2));
+      if (mask)
+        n += applyMask(mask, j, ncoll_b);
+    }
+    n += scalarRow(x_a[i], y_a[i], x_b, y_b, n_vec, n_b, ncoll_b, r2);
+    ncoll_a[i] += n;
+    total += n;
+  }
+  return total;
+}
+
+__attribute__((target("avx2"))) unsigned avx2Kernel(
+    const double* x_a, const double* y_a, unsigned n_a, unsigned* ncoll_a,
+    const double* x_b, const double* y_b, unsigned n_b, unsigned* ncoll_b,
+    double r2) {
+  const unsigned width = 4;
+  unsigned n_vec = n_b - n_b % width;
+  __m256d vr2 = _mm256_set1_pd(r2);
+  unsigned total = 0;
+  for (unsigned i = 0; i < n_a; ++i) {
+    __m256d xa = _mm256_set1_pd(x_a[i]);
+    __m256d ya = _mm256_set1_pd(y_a[i]);
+    unsigned n = 0;
+    for (unsigned j = 0; j < n_vec; j += width) {
+      __m256d dx = _mm256_sub_pd(xa, _mm256_loadu_pd(x_b + j));
+      __m256d dy = _mm256_sub_pd(ya, _mm256_loadu_pd(y_b + j));
+      __m256d d2 =
+          _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+      unsigned mask =
+          _mm256_movemask_pd(_mm256_cmp_pd(d2, vr2, _CMP_LE_OQ));
+      if (mask)
+        n += applyMask(mask, j, ncoll_b);
+    }
+    n += scalarRow(x_a[i], y_a[i], x_b, y_b, n_vec, n_b, ncoll_b, r2);
+    ncoll_a[i] += n;
+    total += n;
+  }
+  return total;
+}
+
+__attribute__((target("avx512f"))) unsigned avx512Kernel(
+    const double* x_a, const double* y_a, unsigned n_a, unsigned* ncoll_a,
+    const double* x_b, const double* y_b, unsigned n_b, unsigned* ncoll_b,
+    double r2) {
+  const unsigned width = 8;
+  unsigned n_vec = n_b - n_b % width;
+  __m512d vr2 = _mm512_set1_pd(r2);
+  unsigned total = 0;
+  for (unsigned i = 0; i < n_a; ++i) {
+    __m512d xa = _mm512_set1_pd(x_a[i]);
+    __m512d ya = _mm512_set1_pd(y_a[i]);
+    unsigned n = 0;
+    for (unsigned j = 0; j < n_vec; j += width) {
+      __m512d dx = _mm512_sub_pd(xa, _mm512_loadu_pd(x_b + j));
+      __m512d dy = _mm512_sub_pd(ya, _mm512_loadu_pd(y_b + j));
+      __m512d d2 =
+          _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+      unsigned mask = _mm512_cmp_pd_mask(d2, vr2, _CMP_LE_OQ);
+      if (mask)
+        n += applyMask(mask, j, ncoll_b);
+    }
+    n += scalarRow(x_a[i], y_a[i], x_b, y_b, n_vec, n_b, ncoll_b, r2);
+    ncoll_a[i] += n;
+    total += n;
+  }
+  return total;
+}
+
+#endif  // SCT_HARD_CORE_X86
+
+}  // namespace
+
+SimdLevel detectSimdLevel() {
+#ifdef SCT_HARD_CORE_X86
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+      return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+      return SimdLevel::SSE2;
+    return SimdLevel::Scalar;
+  }();
+  return level;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+unsigned hardCoreCollisions(const double* x_a, const double* y_a, unsigned n_a,
+                            unsigned* ncoll_a, const double* x_b,
+                            const double* y_b, unsigned n_b, unsigned* ncoll_b,
+                            double r2) {
+  return hardCoreCollisions(x_a, y_a, n_a, ncoll_a, x_b, y_b, n_b, ncoll_b, r2,
+                            detectSimdLevel());
+}
+
+unsigned hardCoreCollisions(const double* x_a, const double* y_a, unsigned n_a,
+                            unsigned* ncoll_a, const double* x_b,
+                            const double* y_b, unsigned n_b, unsigned* ncoll_b,
+                            double r2, SimdLevel level) {
+  if (level > detectSimdLevel())
+    level = detectSimdLevel();
+
+  switch (level) {
+#ifdef SCT_HARD_CORE_X86
+    case SimdLevel::AVX512:
+      return avx512Kernel(x_a, y_a, n_a, ncoll_a, x_b, y_b, n_b, ncoll_b, r2);
+    case SimdLevel::AVX2:
+      return avx2Kernel(x_a, y_a, n_a, ncoll_a, x_b, y_b, n_b, ncoll_b, r2);
+    case SimdLevel::SSE2:
+      return sse2Kernel(x_a, y_a, n_a, ncoll_a, x_b, y_b, n_b, ncoll_b, r2);
+#endif
+    default:
+      return scalarKernel(x_a, y_a, n_a, ncoll_a, x_b, y_b, n_b, ncoll_b, r2);
+  }
+}
+
+}  // namespace sct
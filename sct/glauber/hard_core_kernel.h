@@ -0,0 +1,42 @@
+#ifndef SCT_GLAUBER_HARD_CORE_KERNEL_H
+#define SCT_GLAUBER_HARD_CORE_KERNEL_H
+
+/* Vectorized pair test for the hard-core collision profile. Two nucleons
+ * collide if their squared distance in the transverse plane is less than or
+ * equal to r2 = NNCrossSection / pi. The kernel tests every nucleon in A
+ * against every nucleon in B, using coordinate arrays (see Nucleus::xArray()
+ * and Nucleus::yArray()).
+ *
+ * The instruction set is chosen at runtime from what the host CPU supports,
+ * so a single binary can run on machines with and without AVX2/AVX-512.
+ */
+
+namespace sct {
+
+// instruction sets the kernel is implemented for, in increasing order of
+// vector width. SSE2 is always available on x86-64, Scalar is used on other
+// architectures
+enum class SimdLevel { Scalar = 0, SSE2 = 1, AVX2 = 2, AVX512 = 3 };
+
+// the widest instruction set supported by the host CPU - detected once
+SimdLevel detectSimdLevel();
+
+// counts the colliding pairs between nucleons (x_a, y_a) and (x_b, y_b),
+// incrementing ncoll_a[i] and ncoll_b[j] for every collision between nucleon i
+// in A and nucleon j in B. Returns the total number of collisions. Uses the
+// instruction set from detectSimdLevel()
+unsigned hardCoreCollisions(const double* x_a, const double* y_a, unsigned n_a,
+                            unsigned* ncoll_a, const double* x_b,
+                            const double* y_b, unsigned n_b, unsigned* ncoll_b,
+                            double r2);
+
+// same as above, with an explicit instruction set - if level is not supported
+// by the host CPU, the widest supported level below it is used instead
+unsigned hardCoreCollisions(const double* x_a, const double* y_a, unsigned n_a,
+                            unsigned* ncoll_a, const double* x_b,
+                            const double* y_b, unsigned n_b, unsigned* ncoll_b,
+                            double r2, SimdLevel level);
+
+}  // namespace sct
+
+#endif  // SCT_GLAUBER_HARD_CORE_KERNEL_H
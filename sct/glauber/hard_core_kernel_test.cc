@@ -0,0 +1,63 @@
+#include "sct/glauber/hard_core_kernel.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// every instruction set should find exactly the same collisions as the scalar
+// kernel, including pairs sitting exactly on the interaction distance, and
+// for array sizes that don't fill a full vector
+TEST(HardCoreKernel, simdLevelsAgree) {
+  std::mt19937 generator(4321);
+  std::normal_distribution<double> position(0.0, 3.0);
+
+  for (unsigned n_a : {1, 3, 16, 63, 197}) {
+    for (unsigned n_b : {1, 2, 7, 9, 64, 238}) {
+      std::vector<double> x_a(n_a), y_a(n_a), x_b(n_b), y_b(n_b);
+      for (unsigned i = 0; i < n_a; ++i) {
+        x_a[i] = position(generator);
+        y_a[i] = position(generator);
+      }
+      for (unsigned j = 0; j < n_b; ++j) {
+        x_b[j] = position(generator);
+        y_b[j] = position(generator);
+      }
+      // place some nucleons on a grid with spacing r = 1, so that pairs sit
+      // exactly on the boundary
+      for (unsigned j = 0; j < n_b; j += 3) {
+        x_b[j] = static_cast<int>(x_b[j]);
+        y_b[j] = static_cast<int>(y_b[j]);
+      }
+      x_a[0] = 0.0;
+      y_a[0] = 0.0;
+      double r2 = 1.0;
+
+      std::vector<unsigned> ref_a(n_a, 0), ref_b(n_b, 0);
+      unsigned ref = sct::hardCoreCollisions(
+          x_a.data(), y_a.data(), n_a, ref_a.data(), x_b.data(), y_b.data(),
+          n_b, ref_b.data(), r2, sct::SimdLevel::Scalar);
+
+      // brute force check of the scalar kernel
+      unsigned expected = 0;
+      for (unsigned i = 0; i < n_a; ++i)
+        for (unsigned j = 0; j < n_b; ++j)
+          if ((x_a[i] - x_b[j]) * (x_a[i] - x_b[j]) +
+                  (y_a[i] - y_b[j]) * (y_a[i] - y_b[j]) <=
+              r2)
+            expected++;
+      EXPECT_EQ(ref, expected);
+
+      for (auto level : {sct::SimdLevel::SSE2, sct::SimdLevel::AVX2,
+                         sct::SimdLevel::AVX512}) {
+        std::vector<unsigned> ncoll_a(n_a, 0), ncoll_b(n_b, 0);
+        unsigned n = sct::hardCoreCollisions(
+            x_a.data(), y_a.data(), n_a, ncoll_a.data(), x_b.data(),
+            y_b.data(), n_b, ncoll_b.data(), r2, level);
+        EXPECT_EQ(n, ref);
+        EXPECT_EQ(ncoll_a, ref_a);
+        EXPECT_EQ(ncoll_b, ref_b);
+      }
+    }
+  }
+}
@@ -1,4 +1,5 @@
 #include "sct/glauber/mc_glauber.h"
+#include "sct/glauber/collision_scan.h"
 #include "sct/lib/assert.h"
 #include "sct/lib/logging.h"
 #include "sct/lib/math.h"
@@ -6,34 +7,99 @@
 #include "sct/utils/nucleus_info.h"
 #include "sct/utils/random.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
 namespace sct {
 
-MCGlauber::MCGlauber(GlauberSpecies species_A, GlauberSpecies species_B,
-                     CollisionEnergy energy, GlauberMod mod, bool deformation_A,
-                     bool deformation_B)
-    : events_generated_(0), events_accepted_(0), b_min_(0), b_max_(20),
-      energy_(static_cast<double>(energy)), modification_(mod) {
+// events generated for a single chunk: the accepted events, the events
+// accepted by each collision variant, and the impact parameter & weight of
+// every generated (accepted or missed) event, in order
+struct MCGlauber::EventChunk {
+  std::vector<GlauberEvent> events;
+  std::vector<std::vector<GlauberEvent>> variant_events;
+  std::vector<double> generated_b;
+  std::vector<double> generated_weight;
+};
 
-  double xsec = lookupXSec(energy);
+// a collision variant: its collision settings & energy, output tree & file,
+// and the accepted event counters & impact parameters. The generated events
+// are the generator's
+struct MCGlauber::CollisionVariant {
+  CollisionVariant(const Collision &collision, double energy,
+                   const string &output_file)
+      : collision(collision), energy(energy), output_file(output_file),
+        events_accepted(0), weight_accepted(0), weight2_accepted(0) {}
 
-  // apply any requested systematic variation of the parameters
+  Collision collision;
+  double energy;
+  string output_file;
+  unique_ptr<GlauberTree> tree;
+  unsigned events_accepted;
+  double weight_accepted;
+  double weight2_accepted;
+  unique_ptr<TH1D> accepted_ip;
+};
+
+namespace {
+// applies the systematic variation mod to collision, if it is a variation of
+// the collision settings. Returns false otherwise
+bool ModifyCollision(GlauberMod mod, Collision &collision) {
   switch (mod) {
   case GlauberMod::LargeXSec:
-    xsec += 0.1;
-    break;
+    collision.setNNCrossSection(collision.NNCrossSection() + 0.1);
+    return true;
   case GlauberMod::SmallXSec:
-    xsec -= 0.1;
-    break;
+    collision.setNNCrossSection(collision.NNCrossSection() - 0.1);
+    return true;
+  case GlauberMod::Gauss:
+    collision.setCollisionProfile(CollisionProfile::Gaussian);
+    return true;
   default:
-    break;
+    return false;
   }
+}
+
+// the library file nucleus is drawn from, empty without a library
+string LibraryFile(const Nucleus &nucleus) {
+  return nucleus.library() != nullptr ? nucleus.library()->filename() : "";
+}
+
+// the reuse count of the library of nucleus, 0 without a library
+unsigned LibraryReuse(const Nucleus &nucleus) {
+  return nucleus.library() != nullptr ? nucleus.libraryReuse() : 0;
+}
+} // namespace
+
+MCGlauber::MCGlauber(GlauberSpecies species_A, GlauberSpecies species_B,
+                     CollisionEnergy energy, GlauberMod mod, bool deformation_A,
+                     bool deformation_B)
+    : tree_output_(true), output_queue_size_(10000),
+      output_auto_flush_(-30000000), output_auto_save_(-300000000),
+      checkpoint_interval_(0), run_first_chunk_(0), run_events_(0),
+      run_chunks_done_(0), skip_entries_(0), events_generated_(0),
+      events_accepted_(0), weight_generated_(0), weight2_generated_(0),
+      weight_accepted_(0), weight2_accepted_(0), seed_(0), seed_set_(false),
+      random_engine_(RandomEngine::MT19937), chunk_size_(1000),
+      early_miss_(true), b_min_(0), b_max_(20),
+      energy_(static_cast<double>(energy)), modification_(mod) {
 
   init(species_A, species_B, mod, deformation_A, deformation_B);
 
   initOutput();
   initQA();
 
-  collision_.setNNCrossSection(xsec);
+  // apply any requested systematic variation of the collision parameters
+  collision_.setNNCrossSection(lookupXSec(energy));
+  ModifyCollision(mod, collision_);
   nucleusA_->setName(NucleusInfo::instance().name(species_A));
   nucleusB_->setName(NucleusInfo::instance().name(species_B));
 }
@@ -41,7 +107,14 @@ MCGlauber::MCGlauber(GlauberSpecies species_A, GlauberSpecies species_B,
 MCGlauber::MCGlauber(unsigned mass_number, NucleonPDF::PDF pdf,
                      parameter_list params, double inelastic_xsec,
                      double energy)
-    : events_generated_(0), events_accepted_(0), b_min_(0), b_max_(20),
+    : tree_output_(true), output_queue_size_(10000),
+      output_auto_flush_(-30000000), output_auto_save_(-300000000),
+      checkpoint_interval_(0), run_first_chunk_(0), run_events_(0),
+      run_chunks_done_(0), skip_entries_(0), events_generated_(0),
+      events_accepted_(0), weight_generated_(0), weight2_generated_(0),
+      weight_accepted_(0), weight2_accepted_(0), seed_(0), seed_set_(false),
+      random_engine_(RandomEngine::MT19937), chunk_size_(1000),
+      early_miss_(true), b_min_(0), b_max_(20),
       energy_(energy), modification_(GlauberMod::Nominal) {
 
   init(mass_number, pdf, params, mass_number, pdf, params);
@@ -58,7 +131,14 @@ MCGlauber::MCGlauber(unsigned mass_number_A, NucleonPDF::PDF pdf_A,
                      parameter_list params_A, unsigned mass_number_B,
                      NucleonPDF::PDF pdf_B, parameter_list params_B,
                      double inelastic_xsec, double energy)
-    : events_generated_(0), events_accepted_(0), b_min_(0), b_max_(20),
+    : tree_output_(true), output_queue_size_(10000),
+      output_auto_flush_(-30000000), output_auto_save_(-300000000),
+      checkpoint_interval_(0), run_first_chunk_(0), run_events_(0),
+      run_chunks_done_(0), skip_entries_(0), events_generated_(0),
+      events_accepted_(0), weight_generated_(0), weight2_generated_(0),
+      weight_accepted_(0), weight2_accepted_(0), seed_(0), seed_set_(false),
+      random_engine_(RandomEngine::MT19937), chunk_size_(1000),
+      early_miss_(true), b_min_(0), b_max_(20),
       energy_(energy), modification_(GlauberMod::Nominal) {
 
   initOutput();
@@ -71,7 +151,14 @@ MCGlauber::MCGlauber(unsigned mass_number_A, NucleonPDF::PDF pdf_A,
   nucleusB_->setName(MakeString(mass_number_B));
 }
 
-MCGlauber::~MCGlauber() {}
+MCGlauber::~MCGlauber() {
+  // stores the final tree headers, if the tree is in a file
+  if (tree_ != nullptr)
+    tree_->close();
+  for (auto &variant : variants_)
+    if (variant->tree != nullptr)
+      variant->tree->close();
+}
 
 void MCGlauber::setImpactParameterRange(double b_min, double b_max) {
   if (b_min < 0) {
@@ -85,9 +172,110 @@ void MCGlauber::setImpactParameterRange(double b_min, double b_max) {
   }
   b_min_ = b_min;
   b_max_ = b_max;
+  b_edges_.clear();
+  b_cumulative_.clear();
+  b_weights_.clear();
   initQA();
 }
 
+void MCGlauber::setImpactParameterStrata(const std::vector<double> &edges,
+                                         const std::vector<double> &fractions) {
+  bool valid = edges.size() >= 2 && fractions.size() == edges.size() - 1 &&
+               edges.front() >= 0.0;
+  for (unsigned i = 0; valid && i < fractions.size(); ++i)
+    valid = edges[i + 1] > edges[i] && fractions[i] > 0.0;
+  if (!valid) {
+    LOG(ERROR) << "Requested impact parameter strata don't make sense: "
+               << "edges must be increasing, with one non-zero fraction per "
+               << "stratum. Biased sampling not set";
+    return;
+  }
+
+  setImpactParameterRange(edges.front(), edges.back());
+
+  double total = 0.0;
+  for (auto &fraction : fractions)
+    total += fraction;
+
+  // an event in stratum i is drawn with probability fraction_i * p_i(b),
+  // where p_i(b) is dsigma / db normalized in the stratum, instead of
+  // (area_i / area) * p_i(b)
+  double area = pow(b_max_, 2) - pow(b_min_, 2);
+  double cumulative = 0.0;
+  b_edges_ = edges;
+  for (unsigned i = 0; i < fractions.size(); ++i) {
+    double fraction = fractions[i] / total;
+    double stratum_area = pow(edges[i + 1], 2) - pow(edges[i], 2);
+    cumulative += fraction;
+    b_cumulative_.push_back(cumulative);
+    b_weights_.push_back(stratum_area / area / fraction);
+  }
+  b_cumulative_.back() = 1.0;
+}
+
+void MCGlauber::setImpactParameterBias(std::function<double(double)> bias,
+                                       unsigned n_strata) {
+  if (n_strata == 0) {
+    LOG(ERROR) << "biased impact parameter sampling needs at least one "
+               << "stratum: setting to one";
+    n_strata = 1;
+  }
+
+  // each stratum is sampled in proportion to the integral of b * bias(b)
+  // over the stratum
+  const unsigned samples_per_stratum = 8;
+  double width = (b_max_ - b_min_) / n_strata;
+  double sub_width = width / samples_per_stratum;
+  std::vector<double> edges(n_strata + 1);
+  std::vector<double> fractions(n_strata, 0.0);
+  for (unsigned i = 0; i <= n_strata; ++i)
+    edges[i] = b_min_ + i * width;
+  edges.back() = b_max_;
+  for (unsigned i = 0; i < n_strata; ++i) {
+    for (unsigned j = 0; j < samples_per_stratum; ++j) {
+      double b = edges[i] + (j + 0.5) * sub_width;
+      double val = bias(b);
+      if (!(val > 0.0)) {
+        LOG(ERROR) << "impact parameter bias must be positive in the full "
+                   << "impact parameter range: bias(" << b << ") = " << val
+                   << ". Biased sampling not set";
+        return;
+      }
+      fractions[i] += b * val;
+    }
+  }
+  setImpactParameterStrata(edges, fractions);
+}
+
+void MCGlauber::setSeed(unsigned seed) {
+  seed_ = seed;
+  seed_set_ = true;
+}
+
+void MCGlauber::setOutputFile(const string &filename, unsigned queue_size,
+                              Long64_t auto_flush, Long64_t auto_save) {
+  output_file_ = filename;
+  output_queue_size_ = queue_size;
+  output_auto_flush_ = auto_flush;
+  output_auto_save_ = auto_save;
+}
+
+void MCGlauber::addEventSink(EventSink *sink) {
+  if (sink == nullptr) {
+    LOG(ERROR) << "can not add a null event sink: ignoring";
+    return;
+  }
+  sinks_.push_back(sink);
+}
+
+void MCGlauber::setChunkSize(unsigned n) {
+  if (n == 0) {
+    LOG(ERROR) << "chunk size must be at least one event: setting to one";
+    n = 1;
+  }
+  chunk_size_ = n;
+}
+
 void MCGlauber::setRepulsionDistance(double fm) {
   if (fm < 0) {
     LOG(ERROR) << "Nucleon repulsion distance set negative: no effect,"
@@ -105,10 +293,62 @@ void MCGlauber::setSmearing(NucleonSmearing smear) {
   nucleusB_->setNucleonSmearing(smear, collision_.NNCrossSection());
 }
 
+bool MCGlauber::setNucleusLibrary(const string &file_A, const string &file_B,
+                                  unsigned reuse) {
+  if (file_A.empty()) {
+    nucleusA_->setLibrary(nullptr);
+    nucleusB_->setLibrary(nullptr);
+    return true;
+  }
+
+  // the same file is only mapped once
+  auto library_A = make_shared<NucleusLibrary>();
+  if (!library_A->open(file_A))
+    return false;
+  auto library_B = library_A;
+  if (!file_B.empty() && file_B != file_A) {
+    library_B = make_shared<NucleusLibrary>();
+    if (!library_B->open(file_B))
+      return false;
+  }
+
+  for (auto &library : {library_A, library_B}) {
+    if (library->repulsionDistance() != repulsionDistance() ||
+        library->smearing() != smearing())
+      LOG(WARNING) << "nucleus library " << library->filename()
+                   << " was built with a different repulsion distance or "
+                   << "nucleon smearing than set for the generator";
+  }
+
+  // neither nucleus is changed unless both libraries fit
+  shared_ptr<const NucleusLibrary> previous_A = nucleusA_->library();
+  unsigned previous_reuse = nucleusA_->libraryReuse();
+  if (!nucleusA_->setLibrary(library_A, reuse))
+    return false;
+  if (!nucleusB_->setLibrary(library_B, reuse)) {
+    nucleusA_->setLibrary(previous_A, previous_reuse);
+    return false;
+  }
+  return true;
+}
+
+void MCGlauber::setNucleusQA(NucleusQA mode, unsigned sample_rate) {
+  nucleusA_->setQAMode(mode, sample_rate);
+  nucleusB_->setQAMode(mode, sample_rate);
+}
+
 void MCGlauber::setCollisionProfile(CollisionProfile profile) {
   collision_.setCollisionProfile(profile);
 }
 
+void MCGlauber::setGaussianCutoff(double n_sigma) {
+  collision_.setGaussianCutoff(n_sigma);
+}
+
+void MCGlauber::setCollisionSearch(CollisionSearch search) {
+  collision_.setCollisionSearch(search);
+}
+
 void MCGlauber::setMultiplicityModel(double npp, double k, double x,
                                      double pp_eff, double aa_eff,
                                      double aa_cent, double trig_eff,
@@ -117,9 +357,263 @@ void MCGlauber::setMultiplicityModel(double npp, double k, double x,
                                   const_eff);
 }
 
+void MCGlauber::addCollisionVariant(const Collision &collision,
+                                    const string &output_file) {
+  variants_.push_back(
+      make_unique<CollisionVariant>(collision, energy_, output_file));
+  variants_.back()->tree =
+      make_unique<GlauberTree>(GlauberTree::TreeMode::Write);
+}
+
+bool MCGlauber::addCollisionVariant(GlauberMod mod, const string &output_file) {
+  Collision collision(collision_);
+  if (!ModifyCollision(mod, collision)) {
+    LOG(ERROR) << "modification " << glauberModToString[mod]
+               << " changes more than the collision settings: it can not be "
+               << "a collision variant";
+    return false;
+  }
+  addCollisionVariant(collision, output_file);
+  return true;
+}
+
+void MCGlauber::addCollisionVariant(CollisionEnergy energy,
+                                    const string &output_file) {
+  Collision collision(collision_);
+  collision.setNNCrossSection(lookupXSec(energy));
+  ModifyCollision(modification_, collision);
+  variants_.push_back(make_unique<CollisionVariant>(
+      collision, static_cast<double>(energy), output_file));
+  variants_.back()->tree =
+      make_unique<GlauberTree>(GlauberTree::TreeMode::Write);
+}
+
+void MCGlauber::clearCollisionVariants() {
+  for (auto &variant : variants_)
+    variant->tree->close();
+  variants_.clear();
+}
+
+GlauberTree *MCGlauber::variantResults(unsigned i) const {
+  SCT_ASSERT(i < variants_.size(), "collision variant index out of range");
+  return variants_[i]->tree.get();
+}
+
+TH1D *MCGlauber::variantAcceptedImpactParameter(unsigned i) {
+  SCT_ASSERT(i < variants_.size(), "collision variant index out of range");
+  return variants_[i]->accepted_ip.get();
+}
+
 void MCGlauber::initOutput() {
   clear();
+  events_generated_ = 0;
+  events_accepted_ = 0;
+  weight_generated_ = 0.0;
+  weight2_generated_ = 0.0;
+  weight_accepted_ = 0.0;
+  weight2_accepted_ = 0.0;
+  run_first_chunk_ = 0;
+  run_events_ = 0;
+  run_chunks_done_ = 0;
+  skip_entries_ = 0;
+
+  createTree(tree_, output_file_);
+  for (auto &variant : variants_) {
+    variant->events_accepted = 0;
+    variant->weight_accepted = 0.0;
+    variant->weight2_accepted = 0.0;
+    variant->accepted_ip = make_unique<TH1D>(
+        MakeString("variant_accepted_ip_", Counter::instance().counter())
+            .c_str(),
+        ";impact parameter[fm]", 100, b_min_, b_max_);
+    variant->accepted_ip->SetDirectory(0);
+    createTree(variant->tree, variant->output_file);
+  }
+}
+
+void MCGlauber::createTree(unique_ptr<GlauberTree> &tree,
+                           const string &filename) {
+  // close any previous output file before it is recreated
+  if (tree != nullptr)
+    tree->close();
+  tree = make_unique<GlauberTree>(GlauberTree::TreeMode::Write);
+  if (filename.empty())
+    return;
+  tree->setAutoFlush(output_auto_flush_);
+  tree->setAutoSave(checkpoint_interval_ > 0 ? 0 : output_auto_save_);
+  SCT_ASSERT(tree->create(filename),
+             MakeString("could not create output file ", filename));
+  tree->setAsyncWrite(output_queue_size_);
+}
+
+bool MCGlauber::updateOutput() {
+  if (output_file_.empty()) {
+    LOG(ERROR) << "no output file to continue: set it with setOutputFile()";
+    return false;
+  }
+  if (!variants_.empty()) {
+    LOG(ERROR) << "runs with collision variants can not be continued";
+    return false;
+  }
+
+  clear();
+  if (tree_ != nullptr)
+    tree_->close();
   tree_ = make_unique<GlauberTree>(GlauberTree::TreeMode::Write);
+  tree_->setAutoFlush(output_auto_flush_);
+  tree_->setAutoSave(checkpoint_interval_ > 0 ? 0 : output_auto_save_);
+  if (!tree_->update(output_file_) || !readCheckpoint())
+    return false;
+
+  // the header is filled again at the end of the run
+  tree_->clearHeader();
+  tree_->setAsyncWrite(output_queue_size_);
+  return true;
+}
+
+bool MCGlauber::readCheckpoint() {
+  TDirectory *dir = tree_->file()->GetDirectory("checkpoint");
+  TTree *state = dir == nullptr ? nullptr : (TTree *)dir->Get("state");
+  if (state == nullptr) {
+    LOG(ERROR) << "no checkpoint found in " << output_file_
+               << ": was it written by MCGlauber with an output file?";
+    return false;
+  }
+
+  int engine = 0;
+  unsigned entries = 0;
+  double b_min = 0.0;
+  double b_max = 0.0;
+  string library_A;
+  string library_B;
+  string *library_A_ptr = &library_A;
+  string *library_B_ptr = &library_B;
+  unsigned library_reuse = 0;
+  state->SetBranchAddress("seed", &seed_);
+  state->SetBranchAddress("engine", &engine);
+  state->SetBranchAddress("chunksize", &chunk_size_);
+  state->SetBranchAddress("firstchunk", &run_first_chunk_);
+  state->SetBranchAddress("events", &run_events_);
+  state->SetBranchAddress("chunksdone", &run_chunks_done_);
+  state->SetBranchAddress("entries", &entries);
+  state->SetBranchAddress("eventsgenerated", &events_generated_);
+  state->SetBranchAddress("eventsaccepted", &events_accepted_);
+  state->SetBranchAddress("weightgenerated", &weight_generated_);
+  state->SetBranchAddress("weight2generated", &weight2_generated_);
+  state->SetBranchAddress("weightaccepted", &weight_accepted_);
+  state->SetBranchAddress("weight2accepted", &weight2_accepted_);
+  state->SetBranchAddress("bmin", &b_min);
+  state->SetBranchAddress("bmax", &b_max);
+  // checkpoints from runs before nucleus libraries have no library branches
+  if (state->GetBranch("libraryA") != nullptr) {
+    state->SetBranchAddress("libraryA", &library_A_ptr);
+    state->SetBranchAddress("libraryB", &library_B_ptr);
+    state->SetBranchAddress("libraryreuse", &library_reuse);
+  }
+  bool found = state->GetEntry(0) > 0;
+  delete state;
+  if (!found) {
+    LOG(ERROR) << "could not read the checkpoint in " << output_file_;
+    return false;
+  }
+  seed_set_ = true;
+  random_engine_ = static_cast<RandomEngine>(engine);
+
+  if (b_min != b_min_ || b_max != b_max_) {
+    LOG(ERROR) << "impact parameter range [" << b_min << ", " << b_max
+               << "] of the checkpoint does not match the generator: "
+               << "use the settings of the original run";
+    return false;
+  }
+
+  if (library_A != LibraryFile(*nucleusA_) ||
+      library_B != LibraryFile(*nucleusB_) ||
+      library_reuse != LibraryReuse(*nucleusA_)) {
+    LOG(ERROR) << "nucleus libraries of the checkpoint ("
+               << (library_A.empty() ? "none" : library_A) << ", "
+               << (library_B.empty() ? "none" : library_B) << ", reuse "
+               << library_reuse << ") do not match the generator: "
+               << "use the libraries of the original run";
+    return false;
+  }
+
+  // entries saved after the checkpoint are regenerated, but not filled again
+  unsigned tree_entries = tree_->getEntries();
+  if (tree_entries < entries) {
+    LOG(ERROR) << "event tree in " << output_file_ << " has fewer entries ("
+               << tree_entries << ") than its checkpoint (" << entries << ")";
+    return false;
+  }
+  skip_entries_ = tree_entries - entries;
+
+  TH1D *generated = (TH1D *)dir->Get("generated_ip");
+  TH1D *accepted = (TH1D *)dir->Get("accepted_ip");
+  if (generated == nullptr || accepted == nullptr) {
+    LOG(ERROR) << "impact parameter histograms missing from the checkpoint";
+    return false;
+  }
+  generated_ip_.reset((TH1D *)generated->Clone(
+      MakeString("generated_ip_", Counter::instance().counter()).c_str()));
+  generated_ip_->SetDirectory(0);
+  accepted_ip_.reset((TH1D *)accepted->Clone(
+      MakeString("accepted_ip_", Counter::instance().counter()).c_str()));
+  accepted_ip_->SetDirectory(0);
+  delete generated;
+  delete accepted;
+  nucleusA_->readHistograms(*dir, "A_");
+  nucleusB_->readHistograms(*dir, "B_");
+  return true;
+}
+
+void MCGlauber::writeCheckpoint() {
+  // the trees are saved first: if the job is killed before the state is
+  // written, resume() regenerates the extra entries without filling them
+  tree_->save();
+  for (auto &variant : variants_)
+    if (!variant->output_file.empty())
+      variant->tree->save();
+
+  shared_ptr<TFile> file = tree_->file();
+  TDirectory *dir = file->GetDirectory("checkpoint");
+  if (dir == nullptr)
+    dir = file->mkdir("checkpoint");
+  TDirectory::TContext context(dir);
+
+  int engine = static_cast<int>(random_engine_);
+  unsigned entries = tree_->getEntries() - skip_entries_;
+  string library_A = LibraryFile(*nucleusA_);
+  string library_B = LibraryFile(*nucleusB_);
+  string *library_A_ptr = &library_A;
+  string *library_B_ptr = &library_B;
+  unsigned library_reuse = LibraryReuse(*nucleusA_);
+  TTree state("state", "MCGlauber run state");
+  state.Branch("seed", &seed_);
+  state.Branch("engine", &engine);
+  state.Branch("chunksize", &chunk_size_);
+  state.Branch("firstchunk", &run_first_chunk_);
+  state.Branch("events", &run_events_);
+  state.Branch("chunksdone", &run_chunks_done_);
+  state.Branch("entries", &entries);
+  state.Branch("eventsgenerated", &events_generated_);
+  state.Branch("eventsaccepted", &events_accepted_);
+  state.Branch("weightgenerated", &weight_generated_);
+  state.Branch("weight2generated", &weight2_generated_);
+  state.Branch("weightaccepted", &weight_accepted_);
+  state.Branch("weight2accepted", &weight2_accepted_);
+  state.Branch("bmin", &b_min_);
+  state.Branch("bmax", &b_max_);
+  state.Branch("libraryA", &library_A_ptr);
+  state.Branch("libraryB", &library_B_ptr);
+  state.Branch("libraryreuse", &library_reuse);
+  state.Fill();
+  state.Write("", TObject::kOverwrite);
+
+  generated_ip_->Write("generated_ip", TObject::kOverwrite);
+  accepted_ip_->Write("accepted_ip", TObject::kOverwrite);
+  nucleusA_->writeHistograms("A_");
+  nucleusB_->writeHistograms("B_");
+  file->SaveSelf();
+  file->Flush();
 }
 
 void MCGlauber::initQA() {
@@ -143,57 +637,421 @@ void MCGlauber::clear() {
 }
 
 // run the glauber MC for N events
-void MCGlauber::run(unsigned N) {
+void MCGlauber::run(unsigned N, unsigned n_threads) {
+  startRun(N);
+  unique_ptr<ThreadPool> pool = runPool(n_threads);
+  generateRun(pool.get());
+}
+
+void MCGlauber::run(unsigned N, ThreadPool &pool) {
+  startRun(N);
+  generateRun(&pool);
+}
+
+bool MCGlauber::resume(unsigned n_threads) {
+  if (!startResume())
+    return false;
+  unique_ptr<ThreadPool> pool = runPool(n_threads);
+  generateRun(pool.get());
+  return true;
+}
+
+bool MCGlauber::resume(ThreadPool &pool) {
+  if (!startResume())
+    return false;
+  generateRun(&pool);
+  return true;
+}
+
+bool MCGlauber::append(unsigned N, unsigned n_threads) {
+  if (!startAppend(N))
+    return false;
+  unique_ptr<ThreadPool> pool = runPool(n_threads);
+  generateRun(pool.get());
+  return true;
+}
+
+bool MCGlauber::append(unsigned N, ThreadPool &pool) {
+  if (!startAppend(N))
+    return false;
+  generateRun(&pool);
+  return true;
+}
+
+void MCGlauber::startRun(unsigned N) {
   initOutput();
-  
+
+  if (!seed_set_)
+    seed_ = Random::instance().uniformInt();
+
+  run_events_ = N;
+}
+
+bool MCGlauber::startResume() {
+  if (!updateOutput())
+    return false;
+  VLOG(1) << "resuming run at chunk " << run_chunks_done_ << " with "
+          << events_accepted_ << " accepted events";
+  return true;
+}
+
+bool MCGlauber::startAppend(unsigned N) {
+  if (!updateOutput())
+    return false;
+  if (run_chunks_done_ * chunk_size_ < run_events_) {
+    LOG(ERROR) << "the run in " << output_file_ << " is not finished: "
+               << "use resume() to finish it first";
+    return false;
+  }
+
+  // the new events continue the chunk indices of the previous run
+  run_first_chunk_ += run_chunks_done_;
+  run_events_ = N;
+  run_chunks_done_ = 0;
+  return true;
+}
+
+unique_ptr<ThreadPool> MCGlauber::runPool(unsigned n_threads) const {
+  unsigned n_chunks = (run_events_ + chunk_size_ - 1) / chunk_size_;
+  n_threads = std::min(n_threads, n_chunks - run_chunks_done_);
+  if (n_threads <= 1)
+    return nullptr;
+  return make_unique<ThreadPool>(n_threads);
+}
+
+void MCGlauber::generateRun(ThreadPool *pool) {
+  for (auto sink : sinks_)
+    sink->begin();
+
+  // without checkpoints, all chunks are generated in one go
+  bool checkpoints = checkpoint_interval_ > 0 && !output_file_.empty();
+  unsigned n_chunks = (run_events_ + chunk_size_ - 1) / chunk_size_;
+  while (run_chunks_done_ < n_chunks) {
+    unsigned last = n_chunks;
+    if (checkpoints && n_chunks - run_chunks_done_ > checkpoint_interval_)
+      last = run_chunks_done_ + checkpoint_interval_;
+    generateChunks(run_chunks_done_, last, pool);
+    if (checkpoints && run_chunks_done_ < n_chunks)
+      writeCheckpoint();
+  }
+
+  for (auto sink : sinks_)
+    sink->end();
+  writeHeader();
+
+  // the final state allows more events to be appended
+  if (!output_file_.empty())
+    writeCheckpoint();
+}
+
+void MCGlauber::generateChunks(unsigned first, unsigned last,
+                               ThreadPool *pool) {
+  auto chunkEvents = [&](unsigned idx) {
+    return std::min(chunk_size_, run_events_ - idx * chunk_size_);
+  };
+
+  // single threaded runs are generated in place, with the generator's own
+  // nuclei
+  if (pool == nullptr || pool->size() == 1 || last - first <= 1) {
+    std::vector<Collision *> variants;
+    for (auto &variant : variants_)
+      variants.push_back(&variant->collision);
+    for (unsigned idx = first; idx < last; ++idx) {
+      EventChunk chunk;
+      generateChunk(run_first_chunk_ + idx, chunkEvents(idx), *nucleusA_,
+                    *nucleusB_, collision_, variants, chunk);
+      mergeChunk(chunk);
+    }
+    return;
+  }
+
+  // the workers use ROOT objects (histograms, TF1s) alongside this thread
+  ROOT::EnableThreadSafety();
+
+  // at most one task per pool worker runs at a time, and each running task
+  // takes its own copy of the generator state from the free list. The copies
+  // are made here, since ROOT object creation is not guaranteed to be thread
+  // safe
+  unsigned n_chunks = last - first;
+  unsigned n_copies = std::min(pool->size(), n_chunks);
+  std::vector<unique_ptr<Nucleus>> worker_A;
+  std::vector<unique_ptr<Nucleus>> worker_B;
+  std::vector<unique_ptr<Collision>> worker_collision;
+  std::vector<unique_ptr<Collision>> worker_variant_collisions;
+  std::vector<std::vector<Collision *>> worker_variants(n_copies);
+  std::vector<unsigned> free_copies;
+  for (unsigned i = 0; i < n_copies; ++i) {
+    worker_A.push_back(make_unique<Nucleus>(*nucleusA_));
+    worker_B.push_back(make_unique<Nucleus>(*nucleusB_));
+    worker_A.back()->allocateHistograms();
+    worker_B.back()->allocateHistograms();
+    worker_collision.push_back(make_unique<Collision>(collision_));
+    for (auto &variant : variants_) {
+      worker_variant_collisions.push_back(
+          make_unique<Collision>(variant->collision));
+      worker_variants[i].push_back(worker_variant_collisions.back().get());
+    }
+    free_copies.push_back(i);
+  }
+
+  // finished chunks are handed to this thread, which merges them in order
+  std::vector<unique_ptr<EventChunk>> chunks(n_chunks);
+  std::vector<std::exception_ptr> errors(n_chunks);
+  std::vector<bool> finished(n_chunks, false);
+  unsigned n_finished = 0;
+  std::atomic<bool> stop(false);
+  std::mutex lock;
+  std::condition_variable chunk_finished;
+
+  auto task = [&](unsigned idx) {
+    unique_ptr<EventChunk> chunk = make_unique<EventChunk>();
+    std::exception_ptr error;
+    if (!stop) {
+      unsigned copy;
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        copy = free_copies.back();
+        free_copies.pop_back();
+      }
+      try {
+        generateChunk(run_first_chunk_ + first + idx, chunkEvents(first + idx),
+                      *worker_A[copy], *worker_B[copy],
+                      *worker_collision[copy], worker_variants[copy], *chunk);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> guard(lock);
+      free_copies.push_back(copy);
+    }
+
+    // notified under the lock, since the waiting thread may return as soon as
+    // the last task is finished
+    std::lock_guard<std::mutex> guard(lock);
+    chunks[idx] = std::move(chunk);
+    errors[idx] = error;
+    finished[idx] = true;
+    n_finished++;
+    chunk_finished.notify_all();
+  };
+
+  // chunk idx + window is only submitted once chunk idx is merged, so that at
+  // most window finished chunks wait for the merge when it is slower than the
+  // generation
+  unsigned window = std::min(2 * n_copies, n_chunks);
+  unsigned n_submitted = 0;
+  auto submit = [&]() {
+    unsigned idx = n_submitted++;
+    pool->submit([&task, idx]() { task(idx); });
+  };
+  while (n_submitted < window)
+    submit();
+
+  // errors of the merge (a throwing event sink, or a failed tree fill) stop
+  // the run like errors of the tasks
+  std::exception_ptr error;
+  for (unsigned idx = 0; idx < n_chunks; ++idx) {
+    unique_ptr<EventChunk> chunk;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      chunk_finished.wait(guard, [&]() { return finished[idx]; });
+      chunk = std::move(chunks[idx]);
+      error = errors[idx];
+    }
+    if (!error) {
+      try {
+        mergeChunk(*chunk);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    if (error) {
+      stop = true;
+      break;
+    }
+    if (n_submitted < n_chunks)
+      submit();
+  }
+
+  // the tasks use the state of this call, so all of them have to finish
+  // before it returns or throws - after an error, the remaining tasks return
+  // without generating
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    chunk_finished.wait(guard, [&]() { return n_finished == n_submitted; });
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+
+  // collect the nucleus QA from all copies
+  for (unsigned i = 0; i < n_copies; ++i) {
+    nucleusA_->mergeHistograms(*worker_A[i]);
+    nucleusB_->mergeHistograms(*worker_B[i]);
+    nucleusA_->mergeRepulsionStatistics(*worker_A[i]);
+    nucleusB_->mergeRepulsionStatistics(*worker_B[i]);
+  }
+}
+
+void MCGlauber::generateChunk(unsigned idx, unsigned n_events,
+                              Nucleus &nucleus_A, Nucleus &nucleus_B,
+                              Collision &collision,
+                              const std::vector<Collision *> &variants,
+                              EventChunk &chunk) {
+  // every chunk has its own random stream - the stream of the calling thread
+  // is restored afterwards
+  ScopedRandomStream stream(random_engine_, seed_, idx);
+
+  // library configurations are not carried over from the last chunk
+  nucleus_A.restartLibrary();
+  nucleus_B.restartLibrary();
+
+  chunk.events.reserve(n_events);
+  chunk.variant_events.resize(variants.size());
+
+  // the nuclei are only skipped if none of the collisions can reach
+  double d_max = collision.maxInteractionDistance();
+  for (auto variant : variants)
+    d_max = std::max(d_max, variant->maxInteractionDistance());
+
+  // with variants, HardCore collisions share the pair distances of a scan
+  std::vector<Collision *> collisions{&collision};
+  collisions.insert(collisions.end(), variants.begin(), variants.end());
+  unique_ptr<CollisionScan> scan;
+  if (!variants.empty() && CollisionScan::supported(collisions))
+    scan = make_unique<CollisionScan>(collisions);
+
   int errors = 0;
   int max_errors = 10;
-  while (events_accepted_ < N) {
-    EventStatus status = generate();
-  
+  unsigned long long attempt = 0;
+  for (; chunk.events.size() < n_events; ++attempt) {
+    // with Philox, every event attempt has its own sequence in the stream
+    if (random_engine_ == RandomEngine::Philox)
+      Random::instance().setEvent(attempt);
+
+    // sampled QA is keyed on the event index, not on the worker's nuclei
+    unsigned long long qa_index =
+        static_cast<unsigned long long>(idx) * chunk_size_ + attempt;
+    nucleus_A.setQAIndex(qa_index);
+    nucleus_B.setQAIndex(qa_index);
+
+    double b = 0.0;
+    double weight = 1.0;
+    EventStatus status =
+        generateNuclei(nucleus_A, nucleus_B, d_max, b, weight);
+
     if (status == EventStatus::Error) {
       SCT_ASSERT(++errors < max_errors,
                  "Repeated errors generating nuclei - aborting");
       continue;
     }
 
-    events_generated_++;
-    if (status == EventStatus::Hit) {
-      events_accepted_++;
-      accepted_ip_->Fill(tree_->B());
-      if (events_accepted_ % 100 == 0) {
-        VLOG(1) << "MCGlauber::run::event = " << events_accepted_;
-        VLOG(1) << "(accepted/generated, Npart, Ncoll, b) = "
-                << MakeString("(", (double)events_accepted_ / events_generated_,
-                              ", ", tree_->nPart(), ", ", tree_->nColl(), ", ",
-                              tree_->B(), ")");
+    chunk.generated_b.push_back(b);
+    chunk.generated_weight.push_back(weight);
+    if (status == EventStatus::Miss)
+      continue;
+
+    // the generator's own collision goes first, so with the Philox engine its
+    // events do not depend on the variants
+    GlauberEvent event;
+    if (scan != nullptr) {
+      scan->collide(nucleus_A, nucleus_B);
+      for (unsigned i = 0; i < collisions.size(); ++i) {
+        if (collisions[i]->nColl() == 0)
+          continue;
+        fillEvent(nucleus_A, nucleus_B, *collisions[i], b, weight, event);
+        if (i == 0)
+          chunk.events.push_back(event);
+        else
+          chunk.variant_events[i - 1].push_back(event);
       }
+      continue;
     }
+
+    if (collide(nucleus_A, nucleus_B, collision, b, weight, event))
+      chunk.events.push_back(event);
+    for (unsigned i = 0; i < variants.size(); ++i)
+      if (collide(nucleus_A, nucleus_B, *variants[i], b, weight, event))
+        chunk.variant_events[i].push_back(event);
   }
-  writeHeader();
+}
+
+void MCGlauber::mergeChunk(const EventChunk &chunk) {
+  for (unsigned i = 0; i < chunk.generated_b.size(); ++i) {
+    double weight = chunk.generated_weight[i];
+    generated_ip_->Fill(chunk.generated_b[i], weight);
+    weight_generated_ += weight;
+    weight2_generated_ += weight * weight;
+  }
+  events_generated_ += chunk.generated_b.size();
+
+  for (auto &event : chunk.events) {
+    if (tree_output_ && skip_entries_ > 0)
+      --skip_entries_;
+    else if (tree_output_)
+      tree_->fill(event);
+    for (auto sink : sinks_)
+      sink->event(event);
+    events_accepted_++;
+    weight_accepted_ += event.weight;
+    weight2_accepted_ += event.weight * event.weight;
+    accepted_ip_->Fill(event.b, event.weight);
+    if (events_accepted_ % 100 == 0) {
+      VLOG(1) << "MCGlauber::run::event = " << events_accepted_;
+      VLOG(1) << "(Npart, Ncoll, b) = "
+              << MakeString("(", event.n_part, ", ", event.n_coll, ", ",
+                            event.b, ")");
+    }
+  }
+
+  for (unsigned i = 0; i < variants_.size(); ++i) {
+    CollisionVariant &variant = *variants_[i];
+    for (auto &event : chunk.variant_events[i]) {
+      if (tree_output_)
+        variant.tree->fill(event);
+      variant.events_accepted++;
+      variant.weight_accepted += event.weight;
+      variant.weight2_accepted += event.weight * event.weight;
+      variant.accepted_ip->Fill(event.b, event.weight);
+    }
+  }
+  run_chunks_done_++;
 }
 
 void MCGlauber::writeHeader() {
+  writeHeader(*tree_, collision_, energy_, events_accepted_,
+              weight_accepted_, weight2_accepted_);
+  for (auto &variant : variants_)
+    writeHeader(*variant->tree, variant->collision, variant->energy,
+                variant->events_accepted, variant->weight_accepted,
+                variant->weight2_accepted);
+}
+
+void MCGlauber::writeHeader(GlauberTree &tree, const Collision &collision,
+                            double energy, unsigned events_accepted,
+                            double weight_accepted, double weight2_accepted) {
   // fill header
-  tree_->setNameNucleusA(nucleusA_->name());
-  tree_->setNameNucleusB(nucleusB_->name());
-  tree_->setMassNumberA(nucleusA_->massNumber());
-  tree_->setMassNumberB(nucleusB_->massNumber());
-  tree_->setSigmaNN(collision_.NNCrossSection());
-  tree_->setSqrtSNN(energy_);
-  tree_->setRepulsionD(nucleusA_->repulsionDistance());
-  tree_->setSmearHardCore(nucleusA_->nucleonSmearing() ==
-                          NucleonSmearing::HardCore);
-  tree_->setSmearGaussian(nucleusA_->nucleonSmearing() ==
-                          NucleonSmearing::Gaussian);
-  tree_->setCollisionHardCore(collision_.collisionProfile() ==
-                              CollisionProfile::HardCore);
-  tree_->setCollisionGaussian(collision_.collisionProfile() ==
-                              CollisionProfile::Gaussian);
-  tree_->setBMax(b_max_);
-  tree_->setBMin(b_min_);
-  tree_->setNEventsAccepted(events_accepted_);
-  tree_->setNEventsThrown(events_generated_);
+  tree.setNameNucleusA(nucleusA_->name());
+  tree.setNameNucleusB(nucleusB_->name());
+  tree.setMassNumberA(nucleusA_->massNumber());
+  tree.setMassNumberB(nucleusB_->massNumber());
+  tree.setSigmaNN(collision.NNCrossSection());
+  tree.setSqrtSNN(energy);
+  tree.setRepulsionD(nucleusA_->repulsionDistance());
+  tree.setSmearHardCore(nucleusA_->nucleonSmearing() ==
+                        NucleonSmearing::HardCore);
+  tree.setSmearGaussian(nucleusA_->nucleonSmearing() ==
+                        NucleonSmearing::Gaussian);
+  tree.setCollisionHardCore(collision.collisionProfile() ==
+                            CollisionProfile::HardCore);
+  tree.setCollisionGaussian(collision.collisionProfile() ==
+                            CollisionProfile::Gaussian);
+  tree.setBMax(b_max_);
+  tree.setBMin(b_min_);
+  tree.setNEventsAccepted(events_accepted);
+  tree.setNEventsThrown(events_generated_);
+  tree.setLibraryA(LibraryFile(*nucleusA_));
+  tree.setLibraryB(LibraryFile(*nucleusB_));
+  tree.setLibraryReuse(LibraryReuse(*nucleusA_));
 
   // these parameters are all possible parameters depending on the form of the
   // NucleonPDF
@@ -204,17 +1062,17 @@ void MCGlauber::writeHeader() {
     string par_name = par.first;
     double par_val = par.second;
     if (par_name == "radius") {
-      tree_->setRadiusA(par_val);
+      tree.setRadiusA(par_val);
     } else if (par_name == "skin_depth") {
-      tree_->setSkinDepthA(par_val);
+      tree.setSkinDepthA(par_val);
     } else if (par_name == "beta2") {
-      tree_->setBeta2A(par_val);
+      tree.setBeta2A(par_val);
     } else if (par_name == "beta4") {
-      tree_->setBeta4A(par_val);
+      tree.setBeta4A(par_val);
     } else if (par_name == "a") {
-      tree_->setHulthenAA(par_val);
+      tree.setHulthenAA(par_val);
     } else if (par_name == "b") {
-      tree_->setHulthenBA(par_val);
+      tree.setHulthenBA(par_val);
     } else {
       LOG(ERROR) << "MCGlauber/GlauberTree not aware of PDF parameter: "
                  << par_name << ", it will not be written to file";
@@ -225,85 +1083,180 @@ void MCGlauber::writeHeader() {
     string par_name = par.first;
     double par_val = par.second;
     if (par_name == "radius") {
-      tree_->setRadiusB(par_val);
+      tree.setRadiusB(par_val);
     } else if (par_name == "skin_depth") {
-      tree_->setSkinDepthB(par_val);
+      tree.setSkinDepthB(par_val);
     } else if (par_name == "beta2") {
-      tree_->setBeta2B(par_val);
+      tree.setBeta2B(par_val);
     } else if (par_name == "beta4") {
-      tree_->setBeta4B(par_val);
+      tree.setBeta4B(par_val);
     } else if (par_name == "a") {
-      tree_->setHulthenAB(par_val);
+      tree.setHulthenAB(par_val);
     } else if (par_name == "b") {
-      tree_->setHulthenBB(par_val);
+      tree.setHulthenBB(par_val);
     } else {
       LOG(ERROR) << "MCGlauber/GlauberTree not aware of PDF parameter: "
                  << par_name << ", it will not be written to file";
     }
   }
 
-  // calculate total cross section
-  double x_min =
-      events_accepted_ * pow(b_min_, 2) * pi * 10 / events_generated_;
-  double x_max =
-      events_accepted_ * pow(b_max_, 2) * pi * 10 / events_generated_;
-  double x_total = x_max - x_min;
+  // calculate total cross section - the accepted fraction of the sampled area
+  // is the ratio of the summed event weights, which reduces to
+  // accepted / generated for unbiased sampling
+  double area = (pow(b_max_, 2) - pow(b_min_, 2)) * pi * 10;
+  double x_total = area * weight_accepted / weight_generated_;
   double xErr =
-      (x_max - x_min) * sqrt(1.0 / events_accepted_ + 1.0 / events_generated_);
-  tree_->setTotalXsec(x_total);
-  tree_->setTotalXsecError(xErr);
+      x_total * sqrt(weight2_accepted / pow(weight_accepted, 2) +
+                     weight2_generated_ / pow(weight_generated_, 2));
+  tree.setTotalXsec(x_total);
+  tree.setTotalXsecError(xErr);
 
   // write header, and write tree to file
-  tree_->fillHeader();
+  tree.fillHeader();
 }
 
 EventStatus MCGlauber::generate() {
   tree_->clearEvent();
-  clear();
+
+  double b = 0.0;
+  double weight = 1.0;
+  GlauberEvent event;
+  EventStatus status =
+      generate(*nucleusA_, *nucleusB_, collision_, b, weight, event);
+
+  if (status != EventStatus::Error)
+    generated_ip_->Fill(b, weight);
+
+  if (status != EventStatus::Hit)
+    return status;
+
+  // fill the event record in the tree
+  tree_->setEvent(event);
+  tree_->fill();
+  return EventStatus::Hit;
+}
+
+EventStatus MCGlauber::generate(Nucleus &nucleus_A, Nucleus &nucleus_B,
+                                Collision &collision, double &b,
+                                double &weight, GlauberEvent &event) {
+  event.clear();
+  EventStatus status = generateNuclei(
+      nucleus_A, nucleus_B, collision.maxInteractionDistance(), b, weight);
+  if (status != EventStatus::Hit)
+    return status;
+
+  if (!collide(nucleus_A, nucleus_B, collision, b, weight, event))
+    return EventStatus::Miss;
+  return EventStatus::Hit;
+}
+
+EventStatus MCGlauber::generateNuclei(Nucleus &nucleus_A, Nucleus &nucleus_B,
+                                      double d_max, double &b,
+                                      double &weight) {
+  nucleus_A.clear();
+  nucleus_B.clear();
 
   // generate impact parameter
-  double b = b_min_ + Random::instance().linear() * (b_max_ - b_min_);
-  generated_ip_->Fill(b);
-  
-  // generate two new nuclei
-  bool status_1 = nucleusA_->generate(b / 2.0);
-  bool status_2 = nucleusB_->generate(-b / 2.0);
-
-  if (!status_1 || !status_2)
+  b = sampleImpactParameter(weight);
+
+  // if the nucleons of the two nuclei can not reach each other, the event is a
+  // miss, and the nuclei do not have to be built. Only the radii are sampled
+  if (!early_miss_)
+    d_max = -1.0;
+  double reach_A = 0.0;
+  double reach_B = 0.0;
+  bool bounded_A = d_max >= 0.0 && nucleus_A.presampleRadii(reach_A);
+  bool bounded_B = d_max >= 0.0 && nucleus_B.presampleRadii(reach_B);
+  if (bounded_A && bounded_B && b > reach_A + reach_B + d_max) {
+    nucleus_A.clear();
+    nucleus_B.clear();
+    return EventStatus::Miss;
+  }
+
+  // generate nucleus A (centered at x = b / 2). Nucleus B (centered at
+  // x = -b / 2) is only built if its nucleons can reach the nucleon of A with
+  // the smallest x
+  if (!nucleus_A.generate(b / 2.0))
+    return EventStatus::Error;
+
+  if (bounded_B && nucleus_A.size() > 0) {
+    const std::vector<double> &x_A = nucleus_A.xArray();
+    double x_min = *std::min_element(x_A.begin(), x_A.end());
+    if (x_min > reach_B - b / 2.0 + d_max) {
+      nucleus_B.clear();
+      return EventStatus::Miss;
+    }
+  }
+
+  if (!nucleus_B.generate(-b / 2.0))
     return EventStatus::Error;
+  return EventStatus::Hit;
+}
+
+bool MCGlauber::collide(Nucleus &nucleus_A, Nucleus &nucleus_B,
+                        Collision &collision, double b, double weight,
+                        GlauberEvent &event) {
+  // the nuclei may have been collided before, with other settings
+  nucleus_A.clearCollisions();
+  nucleus_B.clearCollisions();
+  event.clear();
 
   // collide the nuclei: if there are no collisions, we are done
-  if (!collision_.collide(*nucleusA_.get(), *nucleusB_.get()))
-    return EventStatus::Miss;
+  if (!collision.collide(nucleus_A, nucleus_B))
+    return false;
+  fillEvent(nucleus_A, nucleus_B, collision, b, weight, event);
+  return true;
+}
 
-  // fill the event record in the tree
-  tree_->setB(b);
-  tree_->setNpart(collision_.nPart());
-  tree_->setNcoll(collision_.nColl());
-  tree_->setNspectators(collision_.spectators());
-  tree_->setTheta(0, nucleusA_->nucleusTheta());
-  tree_->setTheta(0, nucleusA_->nucleusPhi());
-  tree_->setTheta(1, nucleusB_->nucleusTheta());
-  tree_->setTheta(1, nucleusB_->nucleusPhi());
+void MCGlauber::fillEvent(const Nucleus &nucleus_A, const Nucleus &nucleus_B,
+                          Collision &collision, double b, double weight,
+                          GlauberEvent &event) {
+  event.clear();
+
+  // fill the event record
+  event.b = b;
+  event.weight = weight;
+  event.n_part = collision.nPart();
+  event.n_coll = collision.nColl();
+  event.n_spec = collision.spectators();
+  event.multiplicity = collision.multiplicity();
+  event.theta[0] = nucleus_A.nucleusTheta();
+  event.phi[0] = nucleus_A.nucleusPhi();
+  event.theta[1] = nucleus_B.nucleusTheta();
+  event.phi[1] = nucleus_B.nucleusPhi();
 
   for (auto &weight : glauberWeightSet) {
     int index = static_cast<int>(weight);
-    tree_->setSumX(weight, collision_.averageX()[index]);
-    tree_->setSumY(weight, collision_.averageY()[index]);
-    tree_->setSumX2(weight, collision_.averageX2()[index]);
-    tree_->setSumY2(weight, collision_.averageY2()[index]);
-    tree_->setSumXY(weight, collision_.averageXY()[index]);
-    tree_->setRP2Ecc(weight, collision_.reactionPlane2Ecc()[index]);
-    tree_->setPP2Ecc(weight, collision_.partPlane2Ecc()[index]);
-    tree_->setPP3Ecc(weight, collision_.partPlane3Ecc()[index]);
-    tree_->setPP4Ecc(weight, collision_.partPlane4Ecc()[index]);
-    tree_->setPP2(weight, collision_.partPlane2()[index]);
-    tree_->setPP3(weight, collision_.partPlane3()[index]);
-    tree_->setPP4(weight, collision_.partPlane4()[index]);
+    event.sum_x[index] = collision.averageX()[index];
+    event.sum_y[index] = collision.averageY()[index];
+    event.sum_x2[index] = collision.averageX2()[index];
+    event.sum_y2[index] = collision.averageY2()[index];
+    event.sum_xy[index] = collision.averageXY()[index];
+    event.rp2ecc[index] = collision.reactionPlane2Ecc()[index];
+    event.pp2ecc[index] = collision.partPlane2Ecc()[index];
+    event.pp3ecc[index] = collision.partPlane3Ecc()[index];
+    event.pp4ecc[index] = collision.partPlane4Ecc()[index];
+    event.pp2[index] = collision.partPlane2()[index];
+    event.pp3[index] = collision.partPlane3()[index];
+    event.pp4[index] = collision.partPlane4()[index];
   }
+}
 
-  tree_->fill();
-  return EventStatus::Hit;
+double MCGlauber::sampleImpactParameter(double &weight) const {
+  if (b_edges_.empty()) {
+    weight = 1.0;
+    return b_min_ + Random::instance().linear() * (b_max_ - b_min_);
+  }
+
+  // choose the stratum, then draw b ~ b within it
+  double u = Random::instance().uniform();
+  unsigned stratum =
+      std::upper_bound(b_cumulative_.begin(), b_cumulative_.end() - 1, u) -
+      b_cumulative_.begin();
+  double b2_low = pow(b_edges_[stratum], 2);
+  double b2_high = pow(b_edges_[stratum + 1], 2);
+  weight = b_weights_[stratum];
+  return sqrt(b2_low + Random::instance().uniform() * (b2_high - b2_low));
 }
 
 double MCGlauber::lookupXSec(CollisionEnergy energy) {
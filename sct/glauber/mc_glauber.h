@@ -9,13 +9,71 @@
  * dsigma / dB = const * B
  * impact parameter range can be set using setMinB() & setMaxB()
  *
+ * To oversample part of the range (for instance, central events), the impact
+ * parameter can instead be drawn from a biased distribution, in strata of b
+ * (setImpactParameterStrata()) or following a user density
+ * (setImpactParameterBias()). Every event then carries the weight
+ * (dsigma / db) / (sampled density), stored in the "weight" branch of the
+ * GlauberTree, and weighted distributions reproduce the unbiased ones. The
+ * total cross section in the header is calculated from the weights.
+ *
+ * run(N, n_threads) splits the N accepted events into chunks of chunkSize()
+ * events. Each chunk is generated by one of n_threads worker threads, using
+ * the worker's own copy of the nuclei & collision, and a random stream that
+ * is derived from seed() and the chunk index only. Chunks are merged into the
+ * output in order, so for a given seed the output does not depend on the
+ * number of threads.
+ *
+ * Instead of its own worker threads, run() can use a ThreadPool that is
+ * shared between several generators, each driven from its own thread - the
+ * chunks of all generators are then balanced over the pool, and each
+ * generator still merges its own chunks in order.
+ *
+ * With the Philox random engine (setRandomEngine()), every event attempt in a
+ * chunk also starts from its own position in the chunk's stream, so each
+ * event is defined by (seed, chunk, attempt) alone.
+ *
+ * Since the chunks are deterministic, a run with an output file can be
+ * continued: the run state is stored in the file at every checkpoint
+ * (setCheckpointInterval()) and at the end of the run, resume() finishes an
+ * interrupted run from its last checkpoint, and append() adds events to a
+ * finished run:
+ *
+ * generator.setOutputFile("glauber.root");
+ * generator.setCheckpointInterval(100);
+ * generator.resume(8); // or generator.run(1e7, 8) for a new run
+ *
+ * Systematic variations that only change the collision settings (the NN cross
+ * section or the collision profile) do not need nuclei of their own: collision
+ * variants (addCollisionVariant()) collide every pair of nuclei generated by
+ * run() again with their own settings, and write their events to their own
+ * output. The variants share the impact parameters & nuclei of the generator,
+ * so their differences to the nominal output are correlated, and have much
+ * smaller statistical fluctuations than those of independent runs. If all
+ * collisions use the HardCore profile, they are collided together by a
+ * CollisionScan, which calculates the nucleon pair distances only once - so
+ * for instance a beam energy scan, with one variant per collision energy, is
+ * generated in a single pass.
+ *
+ * For heavy nuclei with a repulsion distance or nucleon smearing, building the
+ * nuclei dominates the run time. The nuclei can instead be drawn from
+ * libraries of precomputed configurations (setNucleusLibrary()), written once
+ * with BuildNucleusLibrary() or the build_nucleus_library tool, or produced
+ * externally.
  */
 
 #include "sct/glauber/collision.h"
+#include "sct/glauber/event_sink.h"
 #include "sct/glauber/glauber_tree.h"
 #include "sct/glauber/nucleon.h"
 #include "sct/glauber/nucleus.h"
+#include "sct/glauber/nucleus_library.h"
 #include "sct/lib/enumerations.h"
+#include "sct/utils/random.h"
+#include "sct/utils/thread_pool.h"
+
+#include <functional>
+#include <vector>
 
 #include "TH1D.h"
 
@@ -64,6 +122,22 @@ public:
   inline double minB() const { return b_min_; }
   inline double maxB() const { return b_max_; }
 
+  // biased impact parameter sampling (default is off, all event weights are
+  // one). edges are the stratum boundaries {b_0, ..., b_n} - they replace the
+  // impact parameter range - and fractions are the relative number of events
+  // to generate in each of the n strata, which must all be non-zero. Within a
+  // stratum, b is drawn from dsigma / db ~ b. Calling setImpactParameterRange()
+  // turns the biased sampling off again
+  void setImpactParameterStrata(const std::vector<double> &edges,
+                                const std::vector<double> &fractions);
+
+  // biased sampling with the density ~ b * bias(b) over the current impact
+  // parameter range, approximated in n_strata equal strata. bias(b) must be
+  // positive in the whole range
+  void setImpactParameterBias(std::function<double(double)> bias,
+                              unsigned n_strata = 100);
+  inline bool weightedImpactParameter() const { return !b_edges_.empty(); }
+
   // add repulsion distance to nucleons (default is 0 fm)
   // forces generated nucleons to be at least repulsionDistance() away from
   // each other inside a generated nucleus
@@ -79,6 +153,26 @@ public:
   void setSmearing(NucleonSmearing smear);
   NucleonSmearing smearing() const { return nucleusA_->nucleonSmearing(); }
 
+  // draws the nuclei from precomputed configuration libraries instead of
+  // building them (see nucleus_library.h): nucleus A from file_A, and nucleus
+  // B from file_B, or from file_A as well if file_B is empty. Each
+  // configuration gets a new random rotation every time it is used, and is
+  // used for reuse consecutive events, each with its own impact parameter.
+  // The libraries replace the nucleon PDF, repulsion & smearing settings of
+  // the nuclei, so they should be built with the same settings. An empty
+  // file_A turns the libraries off. Returns false, and leaves the nuclei
+  // unchanged, if a library can not be used. The library files & reuse are
+  // recorded in the output header & checkpoints: resumed & appended runs must
+  // set the same files (by the same path) & reuse as the original run
+  bool setNucleusLibrary(const string &file_A, const string &file_B = "",
+                         unsigned reuse = 1);
+  inline const NucleusLibrary *nucleusLibraryA() const {
+    return nucleusA_->library().get();
+  }
+  inline const NucleusLibrary *nucleusLibraryB() const {
+    return nucleusB_->library().get();
+  }
+
   // collision profile (default is CollisionProfile::HardCore)
   // using a HardCore profile, if the nucleons overlap (radius defined with the
   // nucleon-nucleon cross section), then a collision is counted. Using a
@@ -90,6 +184,39 @@ public:
     return collision_.collisionProfile();
   }
 
+  // distance in units of sigma beyond which the Gaussian profile gives no
+  // collisions (default is 5). See Collision::setGaussianCutoff
+  void setGaussianCutoff(double n_sigma);
+  double gaussianCutoff() const { return collision_.gaussianCutoff(); }
+
+  // collision search (default is CollisionSearch::BruteForce)
+  // the cell list search gives identical results for the HardCore profile, and
+  // is faster for heavy nuclei. See Collision::setCollisionSearch
+  void setCollisionSearch(CollisionSearch search);
+  CollisionSearch collisionSearch() const {
+    return collision_.collisionSearch();
+  }
+
+  // QA histograms recorded by both nuclei (default is NucleusQA::Full). With
+  // NucleusQA::Sampled, the nuclei of one in every sample_rate event attempts
+  // are recorded, chosen by the event index so that the QA does not depend on
+  // the number of threads. See Nucleus::setQAMode
+  void setNucleusQA(NucleusQA mode, unsigned sample_rate = 100);
+  NucleusQA nucleusQA() const { return nucleusA_->QAMode(); }
+
+  // rejection of events that can not have a collision before the nuclei are
+  // fully built (default is on). The radii of both nuclei are drawn first, and
+  // nucleus B is only built if it can reach nucleus A. Accepted events follow
+  // the same distribution, but the random numbers are drawn in a different
+  // order, so a given seed gives different events with & without it. The
+  // nucleus QA histograms are biased when it is on (the default): they only
+  // include nuclei that are built, which favours large nuclei at large b -
+  // turn it off for unbiased nucleus QA. Only used for spherical nuclei
+  // without a repulsion distance (see Nucleus::presampleRadii). See
+  // Collision::maxInteractionDistance
+  void setEarlyMissRejection(bool flag) { early_miss_ = flag; }
+  inline bool earlyMissRejection() const { return early_miss_; }
+
   // if one already has parameters for the two-part multiplicity model, either
   // from fits or some other source, they can be used to generate multiplicity
   // estimates in the glauber trees. This also allows observables like
@@ -98,8 +225,117 @@ public:
                             double aa_eff, double aa_cent,
                             double trig_eff = 1.0, bool const_eff = false);
 
-  // run the glauber MC for N events
-  void run(unsigned N = 1000);
+  // the collision settings of the generator
+  inline const Collision &collision() const { return collision_; }
+
+  // adds a collision variant to run(): each pair of nuclei that is built in
+  // run() is also collided with a copy of collision, and the hits are written
+  // to a GlauberTree of their own, in output_file (using the queue & flush
+  // settings of setOutputFile()), or in memory if output_file is empty. The
+  // generated events - and so the number of events thrown - are shared with
+  // the generator, which still stops at N accepted events of its own, so a
+  // variant accepts a different number of events. Variants are only filled by
+  // run(), are not passed to the event sinks, and are not part of the
+  // checkpoints: resume() and append() refuse runs with variants
+  void addCollisionVariant(const Collision &collision,
+                           const string &output_file = "");
+
+  // adds the variation mod of the current collision settings as a collision
+  // variant. Only the variations of the collision settings (LargeXSec,
+  // SmallXSec and Gauss) can be added: returns false for any other mod
+  bool addCollisionVariant(GlauberMod mod, const string &output_file = "");
+
+  // adds the current collision settings at another collision energy as a
+  // collision variant: the NN cross section is taken from lookupXSec(energy),
+  // with the variation of the generator's GlauberMod, and the header records
+  // energy. The nuclei do not depend on the energy, unless nucleon smearing is
+  // used - its width follows the generator's own cross section
+  void addCollisionVariant(CollisionEnergy energy,
+                           const string &output_file = "");
+
+  void clearCollisionVariants();
+  inline unsigned nCollisionVariants() const { return variants_.size(); }
+
+  // run the glauber MC for N accepted events, using n_threads worker threads.
+  // Threaded runs, and runs with asynchronous output, call
+  // ROOT::EnableThreadSafety()
+  void run(unsigned N = 1000, unsigned n_threads = 1);
+
+  // run the glauber MC for N accepted events, generating the chunks as tasks
+  // on pool. Blocks until the run is finished, and merges the chunks in this
+  // thread - so several generators can share a pool from different threads
+  void run(unsigned N, ThreadPool &pool);
+
+  // seed used to derive the random stream of every chunk of events in run().
+  // If no seed is set by the user, a new seed is drawn from the calling
+  // thread's sct::Random at the start of each run
+  void setSeed(unsigned seed);
+  inline unsigned seed() const { return seed_; }
+
+  // random engine used by run() (default is RandomEngine::MT19937)
+  void setRandomEngine(RandomEngine engine) { random_engine_ = engine; }
+  inline RandomEngine randomEngine() const { return random_engine_; }
+
+  // writes the GlauberTree of each run() directly to filename (overwriting
+  // any existing file), instead of keeping it in memory. Events are handed to
+  // a background thread through a queue of at most queue_size events, which
+  // fills & compresses the tree, and the tree is flushed to disk following
+  // auto_flush & auto_save (see GlauberTree::setAutoFlush). The file is left
+  // open after run(), to add other objects - call results()->close() when
+  // done. An empty filename goes back to trees in memory
+  void setOutputFile(const string &filename, unsigned queue_size = 10000,
+                     Long64_t auto_flush = -30000000,
+                     Long64_t auto_save = -300000000);
+  inline const string &outputFile() const { return output_file_; }
+
+  // writes a checkpoint of run() every n_chunks merged chunks, if there is an
+  // output file (default is 0, no checkpoints). At a checkpoint, the trees
+  // are saved to the file, and the run state - seed, random engine, chunk
+  // size, chunks done, event counters, weight sums and QA histograms - is
+  // written to its "checkpoint" directory. The state is also written at the
+  // end of every run with an output file. Checkpoints replace the automatic
+  // tree saves of the output file. With worker threads, the workers are
+  // restarted after each checkpoint, so n_chunks should be several times the
+  // number of threads
+  void setCheckpointInterval(unsigned n_chunks) {
+    checkpoint_interval_ = n_chunks;
+  }
+  inline unsigned checkpointInterval() const { return checkpoint_interval_; }
+
+  // continues the run in outputFile() from its last checkpoint, and finishes
+  // it - the output is the same as for an uninterrupted run. The seed, random
+  // engine and chunk size are taken from the checkpoint, all other settings
+  // must be the same as for the original run. Event sinks only receive the
+  // events generated after the checkpoint. Returns false if the file has no
+  // checkpoint
+  bool resume(unsigned n_threads = 1);
+  bool resume(ThreadPool &pool);
+
+  // generates N more accepted events for the finished run in outputFile(),
+  // and appends them to its event tree, continuing the chunks of the run. The
+  // header totals & QA histograms include all events. If the events of the
+  // first run are a multiple of chunkSize(), the output is the same as for a
+  // single run of all events. Returns false if the file has no run state, or
+  // its run is not finished (see resume())
+  bool append(unsigned N, unsigned n_threads = 1);
+  bool append(unsigned N, ThreadPool &pool);
+
+  // event sinks receive every accepted event of run(), in order, from the
+  // thread that called run() (see event_sink.h). Sinks are not owned by the
+  // generator, and must outlive the runs they are registered for
+  void addEventSink(EventSink *sink);
+  void clearEventSinks() { sinks_.clear(); }
+
+  // filling of the event tree in results() (default is on). The header is
+  // always filled. Turning it off skips all tree I/O for the events, when the
+  // event sinks give everything that is needed
+  void setTreeOutput(bool flag) { tree_output_ = flag; }
+  inline bool treeOutput() const { return tree_output_; }
+
+  // number of accepted events per chunk in run(). The output of a run depends
+  // on the chunk size, so it has to be kept fixed to reproduce a result
+  void setChunkSize(unsigned n);
+  inline unsigned chunkSize() const { return chunk_size_; }
 
   // lookup table for known NN cross sections (as a function of energy)
   double lookupXSec(CollisionEnergy energy);
@@ -114,14 +350,19 @@ public:
 
   // gives access to tree and individual nuclei
   GlauberTree *results() const { return tree_.get(); }
+  GlauberTree *variantResults(unsigned i) const;
   Nucleus *nucleusA() const { return nucleusA_.get(); }
   Nucleus *nucleusB() const { return nucleusB_.get(); }
 
-  // gives access to generated parameters
+  // gives access to generated parameters - the nuclear PDFs are only recorded
+  // with NucleusQA::Full, and are nullptr otherwise
   TH2D *nuclearPDFA() { return nucleusA_->generatedRCosTheta(); }
   TH2D *nuclearPDFB() { return nucleusB_->generatedRCosTheta(); }
   TH1D *generatedImpactParameter() { return generated_ip_.get(); }
   TH1D *acceptedImpactParameter() { return accepted_ip_.get(); }
+  // accepted impact parameters of collision variant i in the last run, or
+  // nullptr before the first run
+  TH1D *variantAcceptedImpactParameter(unsigned i);
 
   // clears current tree entry & nuclei
   void clear();
@@ -136,23 +377,146 @@ private:
   void initOutput();
   void initQA();
 
-  // output tree
+  // creates a new output tree for a run in tree, written to filename if it is
+  // not empty
+  void createTree(unique_ptr<GlauberTree> &tree, const string &filename);
+
+  // opens outputFile() to continue the run stored in it, and restores the run
+  // state from its checkpoint
+  bool updateOutput();
+  bool readCheckpoint();
+
+  // saves the trees, and writes the run state to the output file
+  void writeCheckpoint();
+
+  // starts a new run of N events in a new output tree
+  void startRun(unsigned N);
+
+  // prepares an output file to continue its run - for append(), with N new
+  // events
+  bool startResume();
+  bool startAppend(unsigned N);
+
+  // a pool of n_threads workers for the remaining chunks of the current run,
+  // or nullptr if they are generated in this thread
+  unique_ptr<ThreadPool> runPool(unsigned n_threads) const;
+
+  // generates & merges the remaining chunks of the current run on pool (in
+  // this thread if pool is nullptr), with checkpoints, and writes the header
+  void generateRun(ThreadPool *pool);
+
+  // generates & merges chunks [first, last) of the current run
+  void generateChunks(unsigned first, unsigned last, ThreadPool *pool);
+
+  // events generated for a single chunk of run()
+  struct EventChunk;
+
+  // a collision variant of run(), with its output
+  struct CollisionVariant;
+
+  // generates chunk number idx (n_events accepted events) with the given
+  // nuclei & collision, colliding every built pair of nuclei with each of the
+  // variant collisions as well
+  void generateChunk(unsigned idx, unsigned n_events, Nucleus &nucleus_A,
+                     Nucleus &nucleus_B, Collision &collision,
+                     const std::vector<Collision *> &variants,
+                     EventChunk &chunk);
+
+  // merges a finished chunk into the output tree & QA histograms, and counts
+  // it as done
+  void mergeChunk(const EventChunk &chunk);
+
+  // generates a single event with the given nuclei & collision, storing the
+  // sampled impact parameter & its weight in b & weight, and the event record
+  // in event
+  EventStatus generate(Nucleus &nucleus_A, Nucleus &nucleus_B,
+                       Collision &collision, double &b, double &weight,
+                       GlauberEvent &event);
+
+  // draws the impact parameter of an event (stored in b & weight) and builds
+  // its nuclei. d_max is the largest distance at which two nucleons can
+  // collide, for early miss rejection. Returns Hit if both nuclei are built,
+  // and Miss if they can not collide
+  EventStatus generateNuclei(Nucleus &nucleus_A, Nucleus &nucleus_B,
+                             double d_max, double &b, double &weight);
+
+  // collides the built nuclei with collision, and fills event for a hit.
+  // Returns false if there is no binary collision
+  bool collide(Nucleus &nucleus_A, Nucleus &nucleus_B, Collision &collision,
+               double b, double weight, GlauberEvent &event);
+
+  // fills event from the results of collision, after a hit
+  void fillEvent(const Nucleus &nucleus_A, const Nucleus &nucleus_B,
+                 Collision &collision, double b, double weight,
+                 GlauberEvent &event);
+
+  // fills the header of tree for the events accepted with collision, at the
+  // collision energy energy
+  void writeHeader(GlauberTree &tree, const Collision &collision,
+                   double energy, unsigned events_accepted,
+                   double weight_accepted, double weight2_accepted);
+
+  // draws an impact parameter, and returns its event weight in weight
+  double sampleImpactParameter(double &weight) const;
+
+  // output tree, and the settings for writing it to a file
   unique_ptr<GlauberTree> tree_;
+  bool tree_output_;
+  string output_file_;
+  unsigned output_queue_size_;
+  Long64_t output_auto_flush_;
+  Long64_t output_auto_save_;
+
+  // checkpoints, and the current run: the index of its first chunk, its
+  // number of accepted events, and the number of its chunks that are merged
+  unsigned checkpoint_interval_;
+  unsigned run_first_chunk_;
+  unsigned run_events_;
+  unsigned run_chunks_done_;
+
+  // entries of the output tree that were saved after the last checkpoint of a
+  // resumed run - they are generated again, but not filled
+  unsigned skip_entries_;
+
+  // additional event receivers for run()
+  std::vector<EventSink *> sinks_;
 
   // containers for nucleus A & B
   unique_ptr<Nucleus> nucleusA_;
   unique_ptr<Nucleus> nucleusB_;
 
   Collision collision_;
+  std::vector<unique_ptr<CollisionVariant>> variants_;
 
   // counters
   unsigned events_generated_;
   unsigned events_accepted_;
 
+  // sums of the event weights (and squared weights) of the generated and the
+  // accepted events, for the cross section
+  double weight_generated_;
+  double weight2_generated_;
+  double weight_accepted_;
+  double weight2_accepted_;
+
+  // random seed & chunking for run()
+  unsigned seed_;
+  bool seed_set_;
+  RandomEngine random_engine_;
+  unsigned chunk_size_;
+  bool early_miss_;
+
   // impact parameter
   double b_min_;
   double b_max_;
 
+  // strata for biased impact parameter sampling: the stratum edges, the
+  // cumulative fraction of events up to each stratum, and the weight of events
+  // in each stratum - all empty for unbiased sampling
+  std::vector<double> b_edges_;
+  std::vector<double> b_cumulative_;
+  std::vector<double> b_weights_;
+
   // collision parameters
   double energy_;           // center of mass energy
   GlauberMod modification_; // Used for systematics: define a chance in the
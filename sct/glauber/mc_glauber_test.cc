@@ -3,12 +3,32 @@
 #include "sct/lib/logging.h"
 #include "sct/lib/string/string_utils.h"
 #include "sct/utils/nucleus_info.h"
+#include "sct/utils/random.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+#include <unistd.h>
 
 #include "gtest/gtest.h"
 
 #include "TH2.h"
 #include "TProfile.h"
 
+namespace {
+
+// a temporary file name unique to the test and the process, so concurrent test
+// runs do not write over each other's output
+std::string UniqueTempFile(const std::string& suffix) {
+  const testing::TestInfo* info =
+      testing::UnitTest::GetInstance()->current_test_info();
+  return testing::TempDir() + "mc_glauber_" + info->name() + "_" +
+         std::to_string(getpid()) + suffix;
+}
+
+} // namespace
+
 TEST(MCGlauber, eventCounter) {
   int nEvents = 5;
 
@@ -19,6 +39,18 @@ TEST(MCGlauber, eventCounter) {
   EXPECT_EQ(tree->getEntries(), nEvents);
 }
 
+// a run does not change the random sequence of the calling thread
+TEST(MCGlauber, callerRandomState) {
+  sct::MCGlauber generator;
+  generator.setSeed(1234);
+
+  sct::Random::instance().seed(42);
+  double expected = sct::Random::instance().uniform();
+  sct::Random::instance().seed(42);
+  generator.run(5);
+  EXPECT_EQ(sct::Random::instance().uniform(), expected);
+}
+
 TEST(MCGlauber, defaultHeader) {
   int nEvents = 1;
 
@@ -170,3 +202,562 @@ TEST(MCGlauber, nonDefaultSymmetricHeader) {
   EXPECT_NEAR(tree->BMax(), bMax, 1e-8);
   EXPECT_NEAR(tree->BMin(), bMin, 1e-8);
 }
+
+TEST(MCGlauber, threadIndependence) {
+  int nEvents = 50;
+
+  sct::MCGlauber generator_serial;
+  generator_serial.setSeed(1234);
+  generator_serial.setChunkSize(7);
+  generator_serial.run(nEvents, 1);
+
+  sct::MCGlauber generator_parallel;
+  generator_parallel.setSeed(1234);
+  generator_parallel.setChunkSize(7);
+  generator_parallel.run(nEvents, 4);
+
+  sct::GlauberTree* serial = generator_serial.results();
+  sct::GlauberTree* parallel = generator_parallel.results();
+
+  ASSERT_EQ(serial->getEntries(), nEvents);
+  ASSERT_EQ(parallel->getEntries(), nEvents);
+
+  for (int i = 0; i < nEvents; ++i) {
+    serial->getEntry(i);
+    parallel->getEntry(i);
+    EXPECT_EQ(serial->B(), parallel->B());
+    EXPECT_EQ(serial->nPart(), parallel->nPart());
+    EXPECT_EQ(serial->nColl(), parallel->nColl());
+    EXPECT_EQ(serial->PP2Ecc(sct::GlauberWeight::NPart),
+              parallel->PP2Ecc(sct::GlauberWeight::NPart));
+  }
+
+  serial->getHeaderEntry(0);
+  parallel->getHeaderEntry(0);
+  EXPECT_EQ(serial->NEventsThrown(), parallel->NEventsThrown());
+  EXPECT_EQ(serial->totalXsec(), parallel->totalXsec());
+
+  TH1D* serial_ip = generator_serial.generatedImpactParameter();
+  TH1D* parallel_ip = generator_parallel.generatedImpactParameter();
+  for (int i = 1; i <= serial_ip->GetNbinsX(); ++i)
+    EXPECT_EQ(serial_ip->GetBinContent(i), parallel_ip->GetBinContent(i));
+}
+
+// the full nucleus QA is recorded by default, and the sampled QA does not
+// depend on the number of threads
+TEST(MCGlauber, sampledQAThreadIndependence) {
+  sct::MCGlauber generator_default;
+  EXPECT_EQ(generator_default.nucleusQA(), sct::NucleusQA::Full);
+  generator_default.run(5);
+  EXPECT_NE(generator_default.nuclearPDFA(), nullptr);
+
+  std::vector<double> entries;
+  for (unsigned n_threads : {1, 4}) {
+    sct::MCGlauber generator;
+    generator.setSeed(1234);
+    generator.setChunkSize(7);
+    generator.setNucleusQA(sct::NucleusQA::Sampled, 10);
+    generator.run(100, n_threads);
+    ASSERT_NE(generator.nucleusA()->generatedR(), nullptr);
+    entries.push_back(generator.nucleusA()->generatedR()->GetEntries());
+    entries.push_back(generator.nucleusA()->generatedR()->GetMean());
+  }
+  EXPECT_EQ(entries[0], entries[2]);
+  EXPECT_NEAR(entries[1], entries[3], 1e-9);
+}
+
+// generators that share a thread pool from different threads give the same
+// output as serial runs
+TEST(MCGlauber, sharedThreadPool) {
+  int nEvents = 50;
+  std::vector<unsigned> seeds{1234, 5678};
+
+  std::vector<sct::MCGlauber> serial(seeds.size());
+  std::vector<sct::MCGlauber> shared(seeds.size());
+  for (unsigned i = 0; i < seeds.size(); ++i) {
+    serial[i].setSeed(seeds[i]);
+    serial[i].setChunkSize(7);
+    serial[i].run(nEvents, 1);
+    shared[i].setSeed(seeds[i]);
+    shared[i].setChunkSize(7);
+  }
+
+  sct::ThreadPool pool(4);
+  std::vector<std::thread> drivers;
+  for (unsigned i = 0; i < seeds.size(); ++i)
+    drivers.push_back(
+        std::thread([&, i]() { shared[i].run(nEvents, pool); }));
+  for (auto& thread : drivers)
+    thread.join();
+
+  for (unsigned i = 0; i < seeds.size(); ++i) {
+    sct::GlauberTree* expected = serial[i].results();
+    sct::GlauberTree* result = shared[i].results();
+    ASSERT_EQ(result->getEntries(), nEvents);
+    for (int j = 0; j < nEvents; ++j) {
+      expected->getEntry(j);
+      result->getEntry(j);
+      EXPECT_EQ(expected->B(), result->B());
+      EXPECT_EQ(expected->nPart(), result->nPart());
+      EXPECT_EQ(expected->nColl(), result->nColl());
+    }
+    expected->getHeaderEntry(0);
+    result->getHeaderEntry(0);
+    EXPECT_EQ(expected->NEventsThrown(), result->NEventsThrown());
+  }
+}
+
+// an event sink that throws stops a threaded run: the exception reaches the
+// caller once all chunk tasks are finished, and the pool can be used again
+TEST(MCGlauber, throwingSinkThreaded) {
+  sct::ThreadPool pool(4);
+  int count = 0;
+  sct::CallbackEventSink sink([&](const sct::GlauberEvent&) {
+    if (++count > 15)
+      throw std::runtime_error("sink failed");
+  });
+
+  sct::MCGlauber generator;
+  generator.setSeed(1234);
+  generator.setChunkSize(5);
+  generator.addEventSink(&sink);
+  EXPECT_THROW(generator.run(200, pool), std::runtime_error);
+
+  sct::MCGlauber next;
+  next.setSeed(1234);
+  next.setChunkSize(5);
+  next.run(20, pool);
+  EXPECT_EQ(next.results()->getEntries(), 20);
+}
+
+TEST(MCGlauber, philoxThreadIndependence) {
+  int nEvents = 50;
+
+  sct::MCGlauber generator_serial;
+  generator_serial.setSeed(1234);
+  generator_serial.setChunkSize(7);
+  generator_serial.setRandomEngine(sct::RandomEngine::Philox);
+  generator_serial.run(nEvents, 1);
+
+  sct::MCGlauber generator_parallel;
+  generator_parallel.setSeed(1234);
+  generator_parallel.setChunkSize(7);
+  generator_parallel.setRandomEngine(sct::RandomEngine::Philox);
+  generator_parallel.run(nEvents, 3);
+
+  sct::GlauberTree* serial = generator_serial.results();
+  sct::GlauberTree* parallel = generator_parallel.results();
+
+  ASSERT_EQ(serial->getEntries(), nEvents);
+  ASSERT_EQ(parallel->getEntries(), nEvents);
+
+  for (int i = 0; i < nEvents; ++i) {
+    serial->getEntry(i);
+    parallel->getEntry(i);
+    EXPECT_EQ(serial->B(), parallel->B());
+    EXPECT_EQ(serial->nPart(), parallel->nPart());
+    EXPECT_EQ(serial->nColl(), parallel->nColl());
+  }
+}
+
+// collision variants collide the nuclei of the generator again: a variant with
+// the generator's own settings reproduces its events, a larger cross section
+// hits every pair of nuclei that the generator hits, and with the Philox engine
+// the generator's events do not change
+TEST(MCGlauber, collisionVariants) {
+  int nEvents = 50;
+
+  sct::MCGlauber reference;
+  reference.setSeed(1234);
+  reference.setChunkSize(7);
+  reference.setRandomEngine(sct::RandomEngine::Philox);
+  reference.run(nEvents);
+
+  sct::MCGlauber generator;
+  generator.setSeed(1234);
+  generator.setChunkSize(7);
+  generator.setRandomEngine(sct::RandomEngine::Philox);
+  generator.addCollisionVariant(generator.collision());
+  ASSERT_TRUE(generator.addCollisionVariant(sct::GlauberMod::LargeXSec));
+  EXPECT_FALSE(generator.addCollisionVariant(sct::GlauberMod::Large));
+  ASSERT_EQ(generator.nCollisionVariants(), 2);
+  generator.run(nEvents, 3);
+
+  sct::GlauberTree* expected = reference.results();
+  sct::GlauberTree* nominal = generator.results();
+  sct::GlauberTree* same = generator.variantResults(0);
+  sct::GlauberTree* large = generator.variantResults(1);
+  ASSERT_EQ(nominal->getEntries(), nEvents);
+  ASSERT_EQ(same->getEntries(), nEvents);
+  ASSERT_GE(large->getEntries(), nEvents);
+
+  unsigned large_entry = 0;
+  for (int i = 0; i < nEvents; ++i) {
+    expected->getEntry(i);
+    nominal->getEntry(i);
+    same->getEntry(i);
+    EXPECT_EQ(expected->B(), nominal->B());
+    EXPECT_EQ(expected->nPart(), nominal->nPart());
+    EXPECT_EQ(expected->nColl(), nominal->nColl());
+    EXPECT_EQ(same->B(), nominal->B());
+    EXPECT_EQ(same->nPart(), nominal->nPart());
+    EXPECT_EQ(same->nColl(), nominal->nColl());
+
+    do {
+      ASSERT_LT(large_entry, large->getEntries());
+      large->getEntry(large_entry++);
+    } while (large->B() != nominal->B());
+    EXPECT_GE(large->nPart(), nominal->nPart());
+    EXPECT_GE(large->nColl(), nominal->nColl());
+  }
+
+  nominal->getHeaderEntry(0);
+  same->getHeaderEntry(0);
+  large->getHeaderEntry(0);
+  EXPECT_EQ(same->NEventsThrown(), nominal->NEventsThrown());
+  EXPECT_EQ(large->NEventsThrown(), nominal->NEventsThrown());
+  EXPECT_EQ(same->totalXsec(), nominal->totalXsec());
+  EXPECT_NEAR(large->sigmaNN(), nominal->sigmaNN() + 0.1, 1e-9);
+  EXPECT_GT(large->totalXsec(), nominal->totalXsec());
+}
+
+// HardCore variants at other collision energies are collided together in a
+// scan, which gives the same events as colliding each variant on its own - a
+// Gaussian variant turns the scan off
+TEST(MCGlauber, energyScanVariants) {
+  int nEvents = 50;
+
+  sct::MCGlauber scanned;
+  scanned.setSeed(1234);
+  scanned.setChunkSize(7);
+  scanned.setRandomEngine(sct::RandomEngine::Philox);
+  scanned.addCollisionVariant(sct::CollisionEnergy::E62);
+  scanned.addCollisionVariant(sct::CollisionEnergy::E2760);
+  scanned.run(nEvents);
+
+  sct::MCGlauber single;
+  single.setSeed(1234);
+  single.setChunkSize(7);
+  single.setRandomEngine(sct::RandomEngine::Philox);
+  single.addCollisionVariant(sct::CollisionEnergy::E62);
+  single.addCollisionVariant(sct::CollisionEnergy::E2760);
+  ASSERT_TRUE(single.addCollisionVariant(sct::GlauberMod::Gauss));
+  single.run(nEvents);
+
+  for (unsigned i = 0; i < 2; ++i) {
+    sct::GlauberTree* expected = single.variantResults(i);
+    sct::GlauberTree* result = scanned.variantResults(i);
+    ASSERT_EQ(result->getEntries(), expected->getEntries());
+    for (unsigned j = 0; j < result->getEntries(); ++j) {
+      expected->getEntry(j);
+      result->getEntry(j);
+      EXPECT_EQ(expected->B(), result->B());
+      EXPECT_EQ(expected->nPart(), result->nPart());
+      EXPECT_EQ(expected->nColl(), result->nColl());
+      EXPECT_EQ(expected->PP2Ecc(sct::GlauberWeight::NPart),
+                result->PP2Ecc(sct::GlauberWeight::NPart));
+    }
+  }
+
+  sct::GlauberTree* low = scanned.variantResults(0);
+  sct::GlauberTree* high = scanned.variantResults(1);
+  low->getHeaderEntry(0);
+  high->getHeaderEntry(0);
+  EXPECT_EQ(low->sqrtSNN(), 62);
+  EXPECT_EQ(low->sigmaNN(), scanned.lookupXSec(sct::CollisionEnergy::E62));
+  EXPECT_EQ(high->sqrtSNN(), 2760);
+  EXPECT_EQ(high->sigmaNN(),
+            scanned.lookupXSec(sct::CollisionEnergy::E2760));
+}
+
+// nuclei drawn from a library do not depend on the number of threads, and the
+// configurations can be reused for several impact parameters
+TEST(MCGlauber, nucleusLibrary) {
+  int nEvents = 50;
+  std::string filename = testing::TempDir() + "mc_glauber_library_test.bin";
+  sct::Nucleus gold(sct::GlauberSpecies::Au197);
+  ASSERT_TRUE(sct::BuildNucleusLibrary(gold, 20, filename));
+
+  sct::MCGlauber generator_serial;
+  EXPECT_FALSE(generator_serial.setNucleusLibrary(filename + ".missing"));
+  ASSERT_TRUE(generator_serial.setNucleusLibrary(filename, "", 4));
+  EXPECT_EQ(generator_serial.nucleusLibraryA(),
+            generator_serial.nucleusLibraryB());
+  generator_serial.setSeed(1234);
+  generator_serial.setChunkSize(7);
+  generator_serial.run(nEvents, 1);
+
+  sct::MCGlauber generator_parallel;
+  ASSERT_TRUE(generator_parallel.setNucleusLibrary(filename, filename, 4));
+  generator_parallel.setSeed(1234);
+  generator_parallel.setChunkSize(7);
+  generator_parallel.run(nEvents, 4);
+
+  sct::GlauberTree* serial = generator_serial.results();
+  sct::GlauberTree* parallel = generator_parallel.results();
+  ASSERT_EQ(serial->getEntries(), nEvents);
+  ASSERT_EQ(parallel->getEntries(), nEvents);
+  for (int i = 0; i < nEvents; ++i) {
+    serial->getEntry(i);
+    parallel->getEntry(i);
+    EXPECT_EQ(serial->B(), parallel->B());
+    EXPECT_EQ(serial->nPart(), parallel->nPart());
+    EXPECT_EQ(serial->nColl(), parallel->nColl());
+  }
+
+  sct::MCGlauber copper(sct::GlauberSpecies::Cu63, sct::GlauberSpecies::Cu63);
+  EXPECT_FALSE(copper.setNucleusLibrary(filename));
+  EXPECT_EQ(copper.nucleusLibraryA(), nullptr);
+  std::remove(filename.c_str());
+}
+
+// rejecting misses before the nuclei are built must not change the fraction of
+// accepted events
+TEST(MCGlauber, earlyMissRejection) {
+  int nEvents = 2000;
+  double b_min = 12.0;
+  double b_max = 20.0;
+
+  sct::MCGlauber generator_early;
+  generator_early.setSeed(1);
+  generator_early.setImpactParameterRange(b_min, b_max);
+  generator_early.run(nEvents);
+
+  sct::MCGlauber generator_full;
+  generator_full.setSeed(2);
+  generator_full.setImpactParameterRange(b_min, b_max);
+  generator_full.setEarlyMissRejection(false);
+  generator_full.run(nEvents);
+
+  sct::GlauberTree* early = generator_early.results();
+  sct::GlauberTree* full = generator_full.results();
+  early->getHeaderEntry(0);
+  full->getHeaderEntry(0);
+
+  double f_early = (double)nEvents / early->NEventsThrown();
+  double f_full = (double)nEvents / full->NEventsThrown();
+  double error = sqrt(f_early * (1.0 - f_early) / early->NEventsThrown() +
+                      f_full * (1.0 - f_full) / full->NEventsThrown());
+  EXPECT_NEAR(f_early, f_full, 4.0 * error);
+}
+
+// oversampling central events must not change the weighted cross section
+TEST(MCGlauber, impactParameterStrata) {
+  int nEvents = 2000;
+
+  sct::MCGlauber generator_strata;
+  generator_strata.setSeed(1);
+  generator_strata.setImpactParameterStrata({0.0, 5.0, 20.0}, {1.0, 1.0});
+  generator_strata.run(nEvents);
+
+  sct::MCGlauber generator_flat;
+  generator_flat.setSeed(2);
+  generator_flat.run(nEvents);
+
+  sct::GlauberTree* strata = generator_strata.results();
+  sct::GlauberTree* flat = generator_flat.results();
+
+  // half of the generated events are in [0, 5] fm, which is 1/16 of the area
+  unsigned central = 0;
+  for (int i = 0; i < nEvents; ++i) {
+    strata->getEntry(i);
+    double weight = strata->B() < 5.0 ? 0.125 : 1.875;
+    EXPECT_NEAR(strata->weight(), weight, 1e-8);
+    if (strata->B() < 5.0)
+      ++central;
+  }
+  EXPECT_GT(central, nEvents / 3);
+
+  strata->getHeaderEntry(0);
+  flat->getHeaderEntry(0);
+  double error = sqrt(pow(strata->totalXsecError(), 2) +
+                      pow(flat->totalXsecError(), 2));
+  EXPECT_NEAR(strata->totalXsec(), flat->totalXsec(), 4.0 * error);
+}
+
+// events streamed to a file by the background writer must be the same as the
+// events of a run in memory
+TEST(MCGlauber, outputFile) {
+  int nEvents = 50;
+  std::string filename = UniqueTempFile(".root");
+
+  sct::MCGlauber generator_memory;
+  generator_memory.setSeed(1234);
+  generator_memory.run(nEvents);
+
+  sct::MCGlauber generator_file;
+  generator_file.setSeed(1234);
+  generator_file.setOutputFile(filename, 4, 10, 20);
+  generator_file.run(nEvents);
+  generator_file.results()->close();
+
+  sct::GlauberTree* memory = generator_memory.results();
+  sct::GlauberTree file(sct::GlauberTree::TreeMode::Read, filename);
+
+  ASSERT_EQ(file.getEntries(), nEvents);
+  memory->getHeaderEntry(0);
+  file.getHeaderEntry(0);
+  EXPECT_EQ(file.NEventsThrown(), memory->NEventsThrown());
+  EXPECT_EQ(file.totalXsec(), memory->totalXsec());
+
+  for (int i = 0; i < nEvents; ++i) {
+    memory->getEntry(i);
+    file.getEntry(i);
+    EXPECT_EQ(file.B(), memory->B());
+    EXPECT_EQ(file.nPart(), memory->nPart());
+    EXPECT_EQ(file.nColl(), memory->nColl());
+  }
+
+  std::remove(filename.c_str());
+}
+
+// a run that is interrupted after a checkpoint is finished by resume(), with
+// the same output as an uninterrupted run
+TEST(MCGlauber, resume) {
+  int nEvents = 100;
+  std::string filename = UniqueTempFile(".root");
+
+  sct::MCGlauber generator_memory;
+  generator_memory.setSeed(1234);
+  generator_memory.setChunkSize(10);
+  generator_memory.run(nEvents);
+
+  // the interrupted run stops in the middle of the chunk after the second
+  // checkpoint, and its tree is saved with events beyond the checkpoint
+  {
+    int count = 0;
+    sct::CallbackEventSink stop([&](const sct::GlauberEvent&) {
+      if (++count > 45)
+        throw std::runtime_error("job killed");
+    });
+    sct::MCGlauber generator;
+    generator.setSeed(1234);
+    generator.setChunkSize(10);
+    generator.setOutputFile(filename);
+    generator.setCheckpointInterval(2);
+    generator.addEventSink(&stop);
+    EXPECT_THROW(generator.run(nEvents), std::runtime_error);
+  }
+
+  sct::MCGlauber generator_resumed;
+  generator_resumed.setOutputFile(filename);
+  generator_resumed.setCheckpointInterval(2);
+  ASSERT_TRUE(generator_resumed.resume(2));
+  EXPECT_EQ(generator_resumed.seed(), 1234);
+  EXPECT_EQ(generator_resumed.chunkSize(), 10);
+  generator_resumed.results()->close();
+
+  sct::GlauberTree* memory = generator_memory.results();
+  sct::GlauberTree file(sct::GlauberTree::TreeMode::Read, filename);
+
+  ASSERT_EQ(file.getEntries(), nEvents);
+  memory->getHeaderEntry(0);
+  file.getHeaderEntry(0);
+  EXPECT_EQ(file.NEventsAccepted(), memory->NEventsAccepted());
+  EXPECT_EQ(file.NEventsThrown(), memory->NEventsThrown());
+  EXPECT_DOUBLE_EQ(file.totalXsec(), memory->totalXsec());
+  EXPECT_DOUBLE_EQ(generator_resumed.generatedImpactParameter()->Integral(),
+                   generator_memory.generatedImpactParameter()->Integral());
+
+  for (int i = 0; i < nEvents; ++i) {
+    memory->getEntry(i);
+    file.getEntry(i);
+    EXPECT_EQ(file.B(), memory->B());
+    EXPECT_EQ(file.nPart(), memory->nPart());
+    EXPECT_EQ(file.nColl(), memory->nColl());
+  }
+
+  std::remove(filename.c_str());
+}
+
+// appending to a run of whole chunks gives the same output as a single run,
+// with the header totals of all events
+TEST(MCGlauber, append) {
+  int nEvents = 50;
+  int nAppended = 30;
+  std::string filename = UniqueTempFile(".root");
+
+  sct::MCGlauber generator_memory;
+  generator_memory.setSeed(1234);
+  generator_memory.setChunkSize(10);
+  generator_memory.run(nEvents + nAppended);
+
+  {
+    sct::MCGlauber generator;
+    generator.setSeed(1234);
+    generator.setChunkSize(10);
+    generator.setOutputFile(filename);
+    generator.run(nEvents);
+  }
+
+  sct::MCGlauber generator_appended;
+  generator_appended.setOutputFile(filename);
+  ASSERT_TRUE(generator_appended.append(nAppended, 2));
+  generator_appended.results()->close();
+
+  sct::GlauberTree* memory = generator_memory.results();
+  sct::GlauberTree file(sct::GlauberTree::TreeMode::Read, filename);
+
+  ASSERT_EQ(file.getEntries(), nEvents + nAppended);
+  memory->getHeaderEntry(0);
+  file.getHeaderEntry(0);
+  EXPECT_EQ(file.NEventsAccepted(), nEvents + nAppended);
+  EXPECT_EQ(file.NEventsThrown(), memory->NEventsThrown());
+  EXPECT_DOUBLE_EQ(file.totalXsec(), memory->totalXsec());
+
+  for (int i = 0; i < nEvents + nAppended; ++i) {
+    memory->getEntry(i);
+    file.getEntry(i);
+    EXPECT_EQ(file.B(), memory->B());
+    EXPECT_EQ(file.nPart(), memory->nPart());
+  }
+
+  std::remove(filename.c_str());
+}
+
+// the nucleus libraries are recorded in the header, and runs are only
+// appended to with the same libraries
+TEST(MCGlauber, appendNucleusLibrary) {
+  std::string library = testing::TempDir() + "mc_glauber_append_library.bin";
+  std::string filename =
+      testing::TempDir() + "mc_glauber_append_library_test.root";
+  sct::Nucleus gold(sct::GlauberSpecies::Au197);
+  ASSERT_TRUE(sct::BuildNucleusLibrary(gold, 10, library));
+
+  {
+    sct::MCGlauber generator;
+    ASSERT_TRUE(generator.setNucleusLibrary(library, "", 2));
+    generator.setSeed(1234);
+    generator.setChunkSize(10);
+    generator.setOutputFile(filename);
+    generator.run(20);
+  }
+
+  {
+    sct::MCGlauber generator;
+    generator.setOutputFile(filename);
+    EXPECT_FALSE(generator.append(10));
+  }
+  {
+    sct::MCGlauber generator;
+    ASSERT_TRUE(generator.setNucleusLibrary(library, "", 3));
+    generator.setOutputFile(filename);
+    EXPECT_FALSE(generator.append(10));
+  }
+
+  sct::MCGlauber generator_appended;
+  ASSERT_TRUE(generator_appended.setNucleusLibrary(library, "", 2));
+  generator_appended.setOutputFile(filename);
+  ASSERT_TRUE(generator_appended.append(10));
+  generator_appended.results()->close();
+
+  sct::GlauberTree file(sct::GlauberTree::TreeMode::Read, filename);
+  ASSERT_EQ(file.getEntries(), 30);
+  file.getHeaderEntry(0);
+  EXPECT_EQ(file.libraryA(), library);
+  EXPECT_EQ(file.libraryB(), library);
+  EXPECT_EQ(file.libraryReuse(), 2);
+
+  std::remove(filename.c_str());
+  std::remove(library.c_str());
+}
@@ -6,6 +6,10 @@ namespace sct {
 
 Nucleon::Nucleon() : position_(0, 0, 0), n_coll_(0), multiplicity_(0.0) {}
 
+Nucleon::Nucleon(double x, double y, double z, unsigned n_coll,
+                 unsigned multiplicity)
+    : position_(x, y, z), n_coll_(n_coll), multiplicity_(multiplicity) {}
+
 Nucleon::Nucleon(const Nucleon& rhs)
     : position_(rhs.position()),
       n_coll_(rhs.nColl()),
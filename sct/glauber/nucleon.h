@@ -7,6 +7,8 @@ namespace sct {
 class Nucleon {
 public:
   Nucleon();
+  Nucleon(double x, double y, double z, unsigned n_coll = 0,
+          unsigned multiplicity = 0);
   Nucleon(const Nucleon &rhs);
   virtual ~Nucleon();
 
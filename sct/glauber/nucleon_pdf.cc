@@ -9,7 +9,19 @@
 
 namespace sct {
 
-NucleonPDF::NucleonPDF() : pdf_1d_(nullptr), pdf_2d_(nullptr) {}
+NucleonPDF::NucleonPDF()
+    : pdf_1d_(nullptr), pdf_2d_(nullptr), pdf_form_(PDF::Undetermined) {}
+
+NucleonPDF::NucleonPDF(const NucleonPDF &rhs) : NucleonPDF() {
+  if (rhs.pdf_form_ == PDF::Undetermined)
+    return;
+
+  // recreate the ROOT functions, but share the (immutable) sampling tables
+  parameter_list params = rhs.parameters_;
+  initFunction(rhs.pdf_form_, params);
+  radial_table_ = rhs.radial_table_;
+  table_2d_ = rhs.table_2d_;
+}
 
 NucleonPDF::~NucleonPDF() {}
 
@@ -17,6 +29,8 @@ void NucleonPDF::clear() {
   pdf_form_ = NucleonPDF::PDF::Undetermined;
   pdf_1d_.reset();
   pdf_2d_.reset();
+  radial_table_.reset();
+  table_2d_.reset();
   parameters_.clear();
 }
 
@@ -42,34 +56,31 @@ bool NucleonPDF::init(GlauberSpecies species, GlauberMod mod, bool deformed) {
   double hulthen_a = NucleusInfo::instance().hulthenA(species);
   double hulthen_b = NucleusInfo::instance().hulthenB(species);
 
+  PDF pdf;
   parameter_list params;
   switch (species) {
   case GlauberSpecies::p1:
-    pdf_form_ = PDF::StepFunction1D;
+    pdf = PDF::StepFunction1D;
     params = {{"radius", radius}};
-    initStepFunction(params);
     break;
   case GlauberSpecies::d2:
-    pdf_form_ = PDF::Hulthen;
+    pdf = PDF::Hulthen;
     params = {{"a", hulthen_a}, {"b", hulthen_b}};
-    initHulthen(params);
     break;
   default:
     if (deformed) {
-      pdf_form_ = PDF::WoodsSaxon2D;
+      pdf = PDF::WoodsSaxon2D;
       params = {{"radius", radius},
                 {"skin_depth", skin_depth},
                 {"beta2", beta2},
                 {"beta4", beta4}};
-      initWS2D(params);
     } else {
-      pdf_form_ = PDF::WoodsSaxon1D;
+      pdf = PDF::WoodsSaxon1D;
       params = {{"radius", radius}, {"skin_depth", skin_depth}};
-      initWS1D(params);
     }
     break;
   }
-  return true;
+  return init(pdf, params);
 }
 
 bool NucleonPDF::init(PDF pdf, parameter_list parameters) {
@@ -78,6 +89,13 @@ bool NucleonPDF::init(PDF pdf, parameter_list parameters) {
   if (pdf == PDF::Undetermined) {
     SCT_THROW("Can not select Undetermined for initializing the PDF");
   }
+
+  initFunction(pdf, parameters);
+  initTables();
+  return true;
+}
+
+void NucleonPDF::initFunction(PDF pdf, parameter_list &parameters) {
   pdf_form_ = pdf;
 
   switch (pdf) {
@@ -96,12 +114,9 @@ bool NucleonPDF::init(PDF pdf, parameter_list parameters) {
   default:
     SCT_THROW("Should not be here: this is an error in the SCT implementation");
   }
-
-  return true;
 }
 
 bool NucleonPDF::sample(double &r, double &theta, double &phi) {
-  
   if (pdf_2d_.get() != nullptr) {
     return sample_2d(r, theta, phi);
   } else if (pdf_1d_.get() != nullptr) {
@@ -112,14 +127,26 @@ bool NucleonPDF::sample(double &r, double &theta, double &phi) {
 }
 
 void NucleonPDF::setParameter(string par_name, double val) {
-  if (parameters_.count(par_name) > 0) {
+  setParameters({{par_name, val}});
+}
+
+void NucleonPDF::setParameters(const parameter_list &parameters) {
+  bool changed = false;
+  for (auto &par : parameters) {
+    if (parameters_.count(par.first) == 0)
+      continue;
     if (deformed()) {
-      pdf_2d_->SetParameter(par_name.c_str(), val);
+      pdf_2d_->SetParameter(par.first.c_str(), par.second);
     } else {
-      pdf_1d_->SetParameter(par_name.c_str(), val);
+      pdf_1d_->SetParameter(par.first.c_str(), par.second);
     }
-    parameters_[par_name] = val;
+    parameters_[par.first] = par.second;
+    changed = true;
   }
+
+  // the tables are rebuilt once for all parameters
+  if (changed)
+    initTables();
 }
 
 bool NucleonPDF::initWS1D(parameter_list &params) {
@@ -159,8 +186,30 @@ bool NucleonPDF::initHulthen(parameter_list &params) {
   return true;
 }
 
+void NucleonPDF::initTables() {
+  radial_table_.reset();
+  table_2d_.reset();
+  if (pdf_2d_ != nullptr) {
+    TF2 *f = pdf_2d_.get();
+    table_2d_ = std::make_shared<const CDFTable2D>(
+        [f](double r, double cos_theta) { return f->Eval(r, cos_theta); },
+        f->GetXmin(), f->GetXmax(), f->GetYmin(), f->GetYmax());
+  } else if (pdf_1d_ != nullptr) {
+    TF1 *f = pdf_1d_.get();
+    radial_table_ = std::make_shared<const CDFTable>(
+        [f](double r) { return f->Eval(r); }, f->GetXmin(), f->GetXmax());
+  }
+}
+
+double NucleonPDF::sampleRadius() {
+  if (radial_table_ == nullptr)
+    SCT_THROW("NucleonPDF is not initialized as a spherical PDF, can not "
+              "sample the radius alone");
+  return radial_table_->sample();
+}
+
 bool NucleonPDF::sample_1d(double &r, double &theta, double &phi) {
-  r = pdf_1d_->GetRandom();
+  r = radial_table_->sample();
   theta = acos(Random::instance().centeredUniform());
   phi = Random::instance().zeroToPi() * 2.0 - pi;
   return true;
@@ -168,7 +217,7 @@ bool NucleonPDF::sample_1d(double &r, double &theta, double &phi) {
 
 bool NucleonPDF::sample_2d(double &r, double &theta, double &phi) {
   double cos_theta = 0.0;
-  pdf_2d_.get()->GetRandom2(r, cos_theta);
+  table_2d_->sample(r, cos_theta);
   theta = acos(cos_theta);
   phi = Random::instance().zeroToPi() * 2.0 - pi;
   return true;
@@ -40,14 +40,23 @@
  * parameters:
  * a - controls the first exponential width
  * b - controls the second exponential width
+ *
+ * The 1D forms (Woods Saxon 1D, step function and Hulthen) are sampled from a
+ * tabulated inverse CDF, and Woods Saxon 2D from a table of conditional CDFs in
+ * r for slices in cos(theta) (see sct/utils/cdf_table.h), rather than through
+ * TF1::GetRandom and TF2::GetRandom2. The tables are built when the PDF is
+ * initialized or its parameters are changed, and are shared read-only between
+ * copies of the PDF.
  */
 
 #include "sct/lib/enumerations.h"
 #include "sct/lib/map.h"
 #include "sct/lib/memory.h"
 #include "sct/lib/string/string.h"
+#include "sct/utils/cdf_table.h"
 #include "sct/utils/functions.h"
 
+#include <memory>
 #include <vector>
 
 #include "TF1.h"
@@ -70,6 +79,8 @@ public:
   // By default the nucleon pdf is uninitialized - user must call Init() before
   // sample() can be called
   NucleonPDF();
+  // copies share the sampling tables of rhs, which are immutable
+  NucleonPDF(const NucleonPDF &rhs);
   ~NucleonPDF();
 
   // clears any stored distributions
@@ -81,16 +92,28 @@ public:
 
   bool sample(double &r, double &theta, double &phi);
 
+  // samples only r, for the spherical forms (deformed() == false), where the
+  // angles are independent of r and can be sampled separately
+  double sampleRadius();
+
   // returns true if the theta distribution is non-uniform
   bool deformed() { return pdf_form_ == PDF::WoodsSaxon2D; }
 
   PDF PDFForm() const { return pdf_form_; }
 
+  // change parameters of the PDF, and rebuild the sampling tables - unknown
+  // parameter names are ignored. setParameters() rebuilds the tables once for
+  // all parameters, which is much faster than repeated setParameter() calls
+  // for Woods Saxon 2D
   void setParameter(string par_name, double val);
+  void setParameters(const parameter_list &parameters);
 
   sct_map<string, double> parameters() const { return parameters_; }
 
 private:
+  // creates the ROOT function for the requested PDF
+  void initFunction(PDF pdf, parameter_list &parameters);
+
   bool initWS1D(parameter_list &params);
   bool initWS2D(parameter_list &params);
   bool initStepFunction(parameter_list &params);
@@ -99,12 +122,19 @@ private:
   bool initParameters(parameter_list &params,
                       const parameter_template &par_template, TF1 *f);
 
+  // (re)builds the sampling tables from pdf_1d_ or pdf_2d_
+  void initTables();
+
   bool sample_1d(double &r, double &theta, double &phi);
   bool sample_2d(double &r, double &theta, double &phi);
 
   unique_ptr<TF1> pdf_1d_;
   unique_ptr<TF2> pdf_2d_;
 
+  // immutable sampling tables, for the 1D forms and Woods Saxon 2D
+  std::shared_ptr<const CDFTable> radial_table_;
+  std::shared_ptr<const CDFTable2D> table_2d_;
+
   PDF pdf_form_;
   parameter_list parameters_;
 };
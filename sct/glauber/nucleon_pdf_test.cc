@@ -145,4 +145,35 @@ TEST(nucleonpdf, deuteron_default) {
   for (auto &par : params) {
     EXPECT_NEAR(par.second, expected[par.first], 1e-5);
   }
-}
\ No newline at end of file
+}
+
+// the sampling tables follow parameter changes, set one at a time or
+// together
+TEST(nucleonpdf, set_parameter) {
+  for (bool deformed : {false, true}) {
+    sct::NucleonPDF pdf;
+    pdf.init(sct::GlauberSpecies::Au197, sct::GlauberMod::Nominal, deformed);
+    pdf.setParameter("radius", 3.0);
+    pdf.setParameter("skin_depth", 0.3);
+    sct::NucleonPDF together;
+    together.init(sct::GlauberSpecies::Au197, sct::GlauberMod::Nominal,
+                  deformed);
+    together.setParameters({{"radius", 3.0}, {"skin_depth", 0.3}});
+    EXPECT_EQ(together.parameters()["skin_depth"], 0.3);
+    EXPECT_EQ(pdf.parameters()["radius"], 3.0);
+
+    for (auto nucleon_pdf : {&pdf, &together}) {
+      int n = 10000;
+      double sum = 0.0;
+      for (int i = 0; i < n; ++i) {
+        double r = 0.0;
+        double theta = 0.0;
+        double phi = 0.0;
+        nucleon_pdf->sample(r, theta, phi);
+        sum += r;
+      }
+      // the mean radius of the gold PDF is ~5.3 fm
+      EXPECT_LT(sum / n, 3.0);
+    }
+  }
+}
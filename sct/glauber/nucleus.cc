@@ -1,29 +1,75 @@
 #include "sct/glauber/nucleus.h"
+#include "sct/glauber/nucleus_library.h"
 #include "sct/lib/assert.h"
 #include "sct/lib/logging.h"
 #include "sct/lib/math.h"
 #include "sct/lib/string/string_utils.h"
-#include "sct/utils/functions.h"
 #include "sct/utils/nucleus_info.h"
 #include "sct/utils/random.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "TF2.h"
 
 namespace sct {
 
+namespace {
+// adds src to dst - if dst has not been allocated, it becomes a copy of src
+template <typename H> void mergeHistogram(unique_ptr<H> &dst, const TH1 *src) {
+  if (src == nullptr)
+    return;
+  if (dst == nullptr) {
+    dst.reset((H *)src->Clone(
+        MakeString(src->GetName(), "_", Counter::instance().counter())
+            .c_str()));
+    dst->SetDirectory(0);
+    return;
+  }
+  dst->Add(src);
+}
+
+template <typename H>
+void writeHistogram(const unique_ptr<H> &src, const string &name) {
+  if (src != nullptr)
+    src->Write(name.c_str(), TObject::kOverwrite);
+}
+
+template <typename H>
+void readHistogram(unique_ptr<H> &dst, TDirectory &dir, const string &name) {
+  dst.reset();
+  TH1 *src = (TH1 *)dir.Get(name.c_str());
+  mergeHistogram(dst, src);
+  delete src;
+}
+} // namespace
+
 Nucleus::Nucleus()
     : name_(""), mass_number_(0), smear_(NucleonSmearing::None),
-      repulsion_distance_(0.0), random_orientation_(true), nucleus_theta_(0.0),
-      nucleus_phi_(0.0), b_(0.0), generated_rcos_theta_(nullptr),
-      generated_position_(nullptr), generated_smear_(nullptr),
-      smeared_position_(nullptr) {}
+      smear_area_(0.0), repulsion_distance_(0.0), grid_inv_cell_(0.0),
+      grid_mask_(0), repulsion_candidates_(0), repulsion_rejections_(0),
+      repulsion_failures_(0), random_orientation_(true),
+      nucleus_theta_(0.0), nucleus_phi_(0.0), b_(0.0),
+      qa_mode_(NucleusQA::Full), qa_sample_rate_(100), qa_counter_(0),
+      qa_fill_(false), next_direction_(0),
+      next_radius_(0), presampled_(false), library_reuse_(1),
+      library_uses_(0), library_index_(0), smear_radius_(0.0),
+      smear_sigma_(0.0), smear_max_(0.0), next_smear_(0) {
+  setOrientation(0.0, 0.0);
+}
 
 Nucleus::Nucleus(GlauberSpecies species, GlauberMod mod, bool deformed)
     : name_(""), mass_number_(0), smear_(NucleonSmearing::None),
-      repulsion_distance_(0.0), random_orientation_(true), nucleus_theta_(0.0),
-      nucleus_phi_(0.0), b_(0.0), generated_rcos_theta_(nullptr),
-      generated_position_(nullptr), generated_smear_(nullptr),
-      smeared_position_(nullptr) {
+      smear_area_(0.0), repulsion_distance_(0.0), grid_inv_cell_(0.0),
+      grid_mask_(0), repulsion_candidates_(0), repulsion_rejections_(0),
+      repulsion_failures_(0), random_orientation_(true),
+      nucleus_theta_(0.0), nucleus_phi_(0.0), b_(0.0),
+      qa_mode_(NucleusQA::Full), qa_sample_rate_(100), qa_counter_(0),
+      qa_fill_(false), next_direction_(0),
+      next_radius_(0), presampled_(false), library_reuse_(1),
+      library_uses_(0), library_index_(0), smear_radius_(0.0),
+      smear_sigma_(0.0), smear_max_(0.0), next_smear_(0) {
+  setOrientation(0.0, 0.0);
   name_ = NucleusInfo::instance().name(species);
   setParameters(species, mod, deformed);
 }
@@ -31,43 +77,68 @@ Nucleus::Nucleus(GlauberSpecies species, GlauberMod mod, bool deformed)
 Nucleus::Nucleus(unsigned mass_number, parameter_list params,
                  NucleonPDF::PDF pdf)
     : name_(""), mass_number_(mass_number), smear_(NucleonSmearing::None),
-      repulsion_distance_(0.0), random_orientation_(true), nucleus_theta_(0.0),
-      nucleus_phi_(0.0), b_(0.0) {
+      smear_area_(0.0), repulsion_distance_(0.0), grid_inv_cell_(0.0),
+      grid_mask_(0), repulsion_candidates_(0), repulsion_rejections_(0),
+      repulsion_failures_(0), random_orientation_(true),
+      nucleus_theta_(0.0), nucleus_phi_(0.0), b_(0.0),
+      qa_mode_(NucleusQA::Full), qa_sample_rate_(100), qa_counter_(0),
+      qa_fill_(false), next_direction_(0),
+      next_radius_(0), presampled_(false), library_reuse_(1),
+      library_uses_(0), library_index_(0), smear_radius_(0.0),
+      smear_sigma_(0.0), smear_max_(0.0), next_smear_(0) {
+  setOrientation(0.0, 0.0);
   setParameters(mass_number, params, pdf);
 }
 
 Nucleus::Nucleus(const Nucleus &rhs)
     : name_(rhs.name()), mass_number_(rhs.massNumber()),
-      smear_(rhs.nucleonSmearing()),
-      repulsion_distance_(rhs.repulsionDistance()),
-      random_orientation_(rhs.randomOrientation()),
+      smear_(rhs.nucleonSmearing()), smear_area_(rhs.nucleonSmearingArea()),
+      repulsion_distance_(rhs.repulsionDistance()), grid_inv_cell_(0.0),
+      grid_mask_(0), repulsion_candidates_(0), repulsion_rejections_(0),
+      repulsion_failures_(0), random_orientation_(rhs.randomOrientation()),
       nucleus_theta_(rhs.nucleusTheta()), nucleus_phi_(rhs.nucleusPhi()),
-      b_(rhs.impactParameter()) {
-  // reserve space for the correct number of nucleons
-  nucleons_.reserve(mass_number_);
-  for (int i = 0; i < rhs.size(); ++i)
-    nucleons_.push_back(rhs[i]);
-
-  nucleon_pdf_.init(rhs.nucleon_pdf_.PDFForm(), rhs.nucleon_pdf_.parameters());
-  initHistograms();
+      b_(rhs.impactParameter()), nucleon_pdf_(rhs.nucleon_pdf_),
+      qa_mode_(rhs.QAMode()), qa_sample_rate_(rhs.QASampleRate()),
+      qa_counter_(0), qa_fill_(false), next_direction_(0),
+      next_radius_(0), presampled_(false), library_(rhs.library_),
+      library_reuse_(rhs.library_reuse_), library_uses_(0),
+      library_index_(0), smear_radius_(0.0), smear_sigma_(0.0),
+      smear_max_(0.0), next_smear_(0) {
+  setOrientation(nucleus_theta_, nucleus_phi_);
+  x_ = rhs.x_;
+  y_ = rhs.y_;
+  z_ = rhs.z_;
+  n_coll_ = rhs.n_coll_;
+  multiplicity_ = rhs.multiplicity_;
+
+  setNucleonSmearing(smear_, smear_area_);
 }
 
 Nucleus::~Nucleus() {}
 
 void Nucleus::clear() {
-  nucleons_.clear();
-  nucleus_theta_ = 0.0;
-  nucleus_phi_ = 0.0;
+  presampled_ = false;
+  x_.clear();
+  y_.clear();
+  z_.clear();
+  n_coll_.clear();
+  multiplicity_.clear();
+  setOrientation(0.0, 0.0);
   b_ = 0.0;
 }
 
+void Nucleus::clearCollisions() {
+  std::fill(n_coll_.begin(), n_coll_.end(), 0);
+  std::fill(multiplicity_.begin(), multiplicity_.end(), 0);
+}
+
 bool Nucleus::setParameters(GlauberSpecies species, GlauberMod mod,
                             bool deformed) {
   // reserve space for correct number of nucleons
-  nucleons_.reserve(NucleusInfo::instance().massNumber(species));
   mass_number_ = NucleusInfo::instance().massNumber(species);
+  reserve(mass_number_);
 
-  initHistograms();
+  clearHistograms();
 
   // initialize the pdf
   return nucleon_pdf_.init(species, mod, deformed);
@@ -81,32 +152,55 @@ bool Nucleus::setParameters(unsigned mass_number, parameter_list params,
   }
 
   clear();
-  nucleons_.reserve(mass_number);
   mass_number_ = mass_number;
+  reserve(mass_number_);
 
-  initHistograms();
+  clearHistograms();
 
   // reset the nuclear PDF
   return nucleon_pdf_.init(pdf, params);
 }
 
 bool Nucleus::generate(double b) {
-  // clear the last results
+  // clear the last results - radii drawn by presampleRadii() are kept
+  bool presampled = presampled_;
   clear();
+  if (!presampled)
+    radii_.clear();
+  next_radius_ = 0;
 
   // set the impact parameter
   b_ = b;
 
+  if (library_ != nullptr)
+    return generateFromLibrary();
+
+  // decide if this nucleus is recorded in the QA histograms
+  qa_fill_ = qa_mode_ == NucleusQA::Full ||
+             (qa_mode_ == NucleusQA::Sampled &&
+              qa_counter_ % qa_sample_rate_ == 0);
+  ++qa_counter_;
+  if (qa_fill_)
+    allocateHistograms();
+
   // get an orientation for the nucleus (theta & phi), if it is deformed,
   // else, keep at zero
   if (nucleon_pdf_.deformed() && random_orientation_) {
-    nucleus_theta_ = acos(Random::instance().centeredUniform());
-    nucleus_phi_ = Random::instance().zeroToPi() * 2.0 - pi;
+    double theta = acos(Random::instance().centeredUniform());
+    double phi = Random::instance().zeroToPi() * 2.0 - pi;
+    setOrientation(theta, phi);
   } else {
-    nucleus_theta_ = 0.0;
-    nucleus_phi_ = 0.0;
+    setOrientation(0.0, 0.0);
   }
 
+  // directions left over from the last nucleus are discarded, so the random
+  // sequence of each nucleus only depends on the state of the engine when
+  // generate() is called
+  if (!nucleon_pdf_.deformed())
+    fillDirections(mass_number_);
+  if (smear_ != NucleonSmearing::None)
+    fillSmearing(mass_number_);
+
   // special case for deuteron - we need to place the nuclei opposite to each
   // other, so we do not randomly sample each nucleon. Instead, we sample a
   // single nucleon and place the other opposite
@@ -120,41 +214,91 @@ bool Nucleus::generate(double b) {
   return generateNucleus();
 }
 
+bool Nucleus::presampleRadii(double &reach) {
+  if (nucleon_pdf_.deformed() || repulsion_distance_ > 0.0 ||
+      mass_number_ == 0 || library_ != nullptr)
+    return false;
+
+  radii_.resize(mass_number_);
+  for (auto &r : radii_)
+    r = nucleon_pdf_.sampleRadius();
+  presampled_ = true;
+
+  // the HardCore smearing is within a ball, the Gaussian smearing within a
+  // cube of half-width smear_max_
+  reach = *std::max_element(radii_.begin(), radii_.end());
+  if (smear_ == NucleonSmearing::HardCore)
+    reach += smear_max_;
+  else if (smear_ == NucleonSmearing::Gaussian)
+    reach += sqrt(2.0) * smear_max_;
+  return true;
+}
+
+bool Nucleus::setLibrary(shared_ptr<const NucleusLibrary> library,
+                         unsigned reuse) {
+  if (library != nullptr && !library->isOpen()) {
+    LOG(ERROR) << "nucleus library is not open";
+    return false;
+  }
+  if (library != nullptr &&
+      (library->massNumber() != mass_number_ || library->size() == 0)) {
+    LOG(ERROR) << "nucleus library " << library->filename() << " holds "
+               << library->size() << " configurations of "
+               << library->massNumber() << " nucleons, can not be used for "
+               << "a nucleus of " << mass_number_ << " nucleons";
+    return false;
+  }
+  if (reuse == 0) {
+    LOG(ERROR) << "nucleus library configurations must be used at least once";
+    return false;
+  }
+  library_ = library;
+  library_reuse_ = reuse;
+  library_uses_ = 0;
+  library_index_ = 0;
+  return true;
+}
+
 void Nucleus::setNucleonSmearing(NucleonSmearing smear, double smear_area) {
+  smear_radius_ = 0.0;
+  smear_sigma_ = 0.0;
+  smear_max_ = 0.0;
   if (smear_area < 0) {
     LOG(ERROR) << "Nucleon smearing requested with negative inelastic"
                << " cross section, setting to zero";
-    smearing_profile_.reset(nullptr);
     smear_ = NucleonSmearing::None;
+    smear_area_ = 0.0;
     return;
   }
 
   smear_ = smear;
+  smear_area_ = smear_area;
 
   switch (smear) {
-  case NucleonSmearing::HardCore: {
-    double rMax = sqrt(smear_area / pi);
-    smearing_profile_ = make_unique<TF3>(
-        MakeString("hardCoreSmear_", Counter::instance().counter()).c_str(),
-        StepFunction, -rMax, rMax, -rMax, rMax, -rMax, rMax, 1);
-    smearing_profile_->SetParameter(0, smear_area);
+  case NucleonSmearing::HardCore:
+    smear_radius_ = sqrt(smear_area / pi);
+    smear_max_ = smear_radius_;
     break;
-  }
-  case NucleonSmearing::Gaussian: {
-    double sigma = 0.79 / sqrt(3.0);
-    double rMax = sigma * 5.0;
-    smearing_profile_ = make_unique<TF3>(
-        MakeString("gaussianSmear_", Counter::instance().counter()).c_str(),
-        Gaussian, -rMax, rMax, -rMax, rMax, -rMax, rMax, 1);
-    smearing_profile_->SetParameter(0, sigma);
+  case NucleonSmearing::Gaussian:
+    smear_sigma_ = 0.79 / sqrt(3.0);
+    smear_max_ = smear_sigma_ * 5.0;
     break;
-  }
   default:
-    smearing_profile_.reset(nullptr);
+    smear_ = NucleonSmearing::None;
     break;
   }
 }
 
+void Nucleus::setQAMode(NucleusQA mode, unsigned sample_rate) {
+  if (sample_rate == 0) {
+    LOG(ERROR) << "QA sample rate must be at least one: setting to one";
+    sample_rate = 1;
+  }
+  qa_mode_ = mode;
+  qa_sample_rate_ = sample_rate;
+  qa_counter_ = 0;
+}
+
 void Nucleus::setRepulsionDistance(double fm) {
   if (fm >= 0)
     repulsion_distance_ = fm;
@@ -165,24 +309,102 @@ void Nucleus::setRepulsionDistance(double fm) {
   }
 }
 
+void Nucleus::resetRepulsionStatistics() {
+  repulsion_candidates_ = 0;
+  repulsion_rejections_ = 0;
+  repulsion_failures_ = 0;
+}
+
+void Nucleus::mergeHistograms(const Nucleus &rhs) {
+  mergeHistogram(generated_r_, rhs.generatedR());
+  mergeHistogram(generated_cos_theta_, rhs.generatedCosTheta());
+  mergeHistogram(generated_phi_, rhs.generatedPhi());
+  mergeHistogram(generated_rcos_theta_, rhs.generatedRCosTheta());
+  mergeHistogram(generated_position_, rhs.generatedPosition());
+  mergeHistogram(generated_smear_, rhs.generatedSmear());
+  mergeHistogram(smeared_position_, rhs.smearedPosition());
+}
+
+void Nucleus::writeHistograms(const string &prefix) const {
+  writeHistogram(generated_r_, prefix + "r");
+  writeHistogram(generated_cos_theta_, prefix + "cos_theta");
+  writeHistogram(generated_phi_, prefix + "phi");
+  writeHistogram(generated_rcos_theta_, prefix + "r_cos_theta");
+  writeHistogram(generated_position_, prefix + "position");
+  writeHistogram(generated_smear_, prefix + "smear");
+  writeHistogram(smeared_position_, prefix + "smeared_position");
+}
+
+void Nucleus::readHistograms(TDirectory &dir, const string &prefix) {
+  readHistogram(generated_r_, dir, prefix + "r");
+  readHistogram(generated_cos_theta_, dir, prefix + "cos_theta");
+  readHistogram(generated_phi_, dir, prefix + "phi");
+  readHistogram(generated_rcos_theta_, dir, prefix + "r_cos_theta");
+  readHistogram(generated_position_, dir, prefix + "position");
+  readHistogram(generated_smear_, dir, prefix + "smear");
+  readHistogram(smeared_position_, dir, prefix + "smeared_position");
+}
+
+void Nucleus::mergeRepulsionStatistics(const Nucleus &rhs) {
+  repulsion_candidates_ += rhs.repulsionCandidates();
+  repulsion_rejections_ += rhs.repulsionRejections();
+  repulsion_failures_ += rhs.repulsionFailures();
+}
+
 void Nucleus::rotateAndOffset(Nucleon &n) {
-  TVector3 pos = n.position();
+  double x = n.x();
+  double y = n.y();
+  double z = n.z();
+  rotateAndOffset(x, y, z);
+  n.set(TVector3(x, y, z));
+}
 
+void Nucleus::setOrientation(double theta, double phi) {
+  nucleus_theta_ = theta;
+  nucleus_phi_ = phi;
+
+  // R = Rz(phi) * Ry(theta), equivalent to TVector3::RotateY(theta) followed
+  // by TVector3::RotateZ(phi)
+  double cos_theta = cos(theta);
+  double sin_theta = sin(theta);
+  double cos_phi = cos(phi);
+  double sin_phi = sin(phi);
+  rotation_ = {cos_phi * cos_theta, -sin_phi, cos_phi * sin_theta,
+               sin_phi * cos_theta, cos_phi,  sin_phi * sin_theta,
+               -sin_theta,          0.0,      cos_theta};
+}
+
+void Nucleus::rotateAndOffset(double &x, double &y, double &z) const {
   // rotate in the frame of the nucleus
-  pos.RotateY(nucleusTheta());
-  pos.RotateZ(nucleusPhi());
+  double rx = rotation_[0] * x + rotation_[1] * y + rotation_[2] * z;
+  double ry = rotation_[3] * x + rotation_[4] * y + rotation_[5] * z;
+  double rz = rotation_[6] * x + rotation_[7] * y + rotation_[8] * z;
 
   // translate by impact parameter along the x axis - moves the nucleon into the
   // collision CM frame
-  pos.SetX(pos.X() + b_);
+  x = rx + b_;
+  y = ry;
+  z = rz;
+}
 
-  n.set(pos);
+void Nucleus::reserve(unsigned n) {
+  x_.reserve(n);
+  y_.reserve(n);
+  z_.reserve(n);
+  n_coll_.reserve(n);
+  multiplicity_.reserve(n);
+}
+
+void Nucleus::pushNucleon(double x, double y, double z) {
+  x_.push_back(x);
+  y_.push_back(y);
+  z_.push_back(z);
+  n_coll_.push_back(0);
+  multiplicity_.push_back(0);
 }
 
 void Nucleus::addNucleon(double b) {
   // attempt to add one nucleon to the nucleus
-  Nucleon nucleon;
-
   // now try to add the nucleon to the nucleus - "try" because if there
   // is a repulsion it can fail, so try 5 times, and fail out if it doesn't
   // "fit"
@@ -200,98 +422,227 @@ void Nucleus::addNucleon(double b) {
     // the nominal position is the addition of raw position + smearing
     TVector3 smeared_position = position + smearing;
 
-    // create the nucleon
-    nucleon.set(smeared_position);
-
     // rotate by the nucleus orientation and then offset by the impact parameter
-    rotateAndOffset(nucleon);
-
-    // if a minimum repulsion distance is set, we have to check each existing
-    // nucleon for overlap - else, we can skip that relatively inefficient step
-    bool collision = false;
-    if (repulsion_distance_ > 0.0) {
-      for (auto nucleon2 : nucleons_) {
-        if (nucleon.deltaR(nucleon2) <= repulsion_distance_)
-          collision = true;
-      }
-    }
+    double x = smeared_position.X();
+    double y = smeared_position.Y();
+    double z = smeared_position.Z();
+    rotateAndOffset(x, y, z);
+
+    // if a minimum repulsion distance is set, we have to check the nearby
+    // nucleons for overlap - else, we can skip that step
+    ++repulsion_candidates_;
+    bool collision = repulsion_distance_ > 0.0 && repulsionOverlap(x, y, z);
 
     if (collision == false) {
       // if there was no overlap, add the nucleon
-      nucleons_.push_back(nucleon);
+      pushNucleon(x, y, z);
+      if (repulsion_distance_ > 0.0)
+        insertRepulsionGrid(size() - 1);
 
       // record QA data
-      generated_position_->Fill(position.X(), position.Y(), position.Z());
-      generated_smear_->Fill(smearing.X(), smearing.Y(), smearing.Z());
-      smeared_position_->Fill(smeared_position.X(), smeared_position.Y(),
-                              smeared_position.Z());
+      if (qa_fill_ && qa_mode_ == NucleusQA::Full) {
+        generated_position_->Fill(position.X(), position.Y(), position.Z());
+        generated_smear_->Fill(smearing.X(), smearing.Y(), smearing.Z());
+        smeared_position_->Fill(smeared_position.X(), smeared_position.Y(),
+                                smeared_position.Z());
+      }
       break;
     }
+    ++repulsion_rejections_;
+  }
+}
+
+void Nucleus::resetRepulsionGrid() {
+  // nucleons are placed in cubic cells of side repulsion_distance_, so any
+  // nucleon within the repulsion distance of a candidate is in one of the 27
+  // cells around it. Larger cells are still correct, so very small distances
+  // are clamped to keep cell indices in range
+  double cell_size = std::max(repulsion_distance_, 1e-3);
+  grid_inv_cell_ = 1.0 / cell_size;
+
+  // the cells are hashed into a power of two number of buckets, at least
+  // twice the number of nucleons, so that buckets are mostly empty
+  unsigned n_buckets = 64;
+  while (n_buckets < 2 * mass_number_)
+    n_buckets *= 2;
+  grid_mask_ = n_buckets - 1;
+  grid_head_.assign(n_buckets, -1);
+  grid_next_.clear();
+  grid_next_.reserve(mass_number_);
+}
+
+unsigned Nucleus::repulsionBucket(long ix, long iy, long iz) const {
+  unsigned long hash = static_cast<unsigned long>(ix) * 73856093ul ^
+                       static_cast<unsigned long>(iy) * 19349663ul ^
+                       static_cast<unsigned long>(iz) * 83492791ul;
+  return hash & grid_mask_;
+}
+
+bool Nucleus::repulsionOverlap(double x, double y, double z) const {
+  double repulsion2 = repulsion_distance_ * repulsion_distance_;
+  long ix = static_cast<long>(std::floor(x * grid_inv_cell_));
+  long iy = static_cast<long>(std::floor(y * grid_inv_cell_));
+  long iz = static_cast<long>(std::floor(z * grid_inv_cell_));
+
+  // distinct cells can share a bucket, so every nucleon in a bucket is
+  // checked by distance, which is correct regardless of the cell it is in
+  for (long cx = ix - 1; cx <= ix + 1; ++cx) {
+    for (long cy = iy - 1; cy <= iy + 1; ++cy) {
+      for (long cz = iz - 1; cz <= iz + 1; ++cz) {
+        for (int i = grid_head_[repulsionBucket(cx, cy, cz)]; i >= 0;
+             i = grid_next_[i]) {
+          double dx = x - x_[i];
+          double dy = y - y_[i];
+          double dz = z - z_[i];
+          if (dx * dx + dy * dy + dz * dz <= repulsion2)
+            return true;
+        }
+      }
+    }
   }
+  return false;
 }
 
-void Nucleus::initHistograms() {
+void Nucleus::insertRepulsionGrid(unsigned idx) {
+  long ix = static_cast<long>(std::floor(x_[idx] * grid_inv_cell_));
+  long iy = static_cast<long>(std::floor(y_[idx] * grid_inv_cell_));
+  long iz = static_cast<long>(std::floor(z_[idx] * grid_inv_cell_));
+  unsigned bucket = repulsionBucket(ix, iy, iz);
+  grid_next_.push_back(grid_head_[bucket]);
+  grid_head_[bucket] = idx;
+}
+
+void Nucleus::allocateHistograms() {
+  if (qa_mode_ == NucleusQA::Off)
+    return;
+
+  if (generated_r_ == nullptr) {
+    generated_r_ = make_unique<TH1D>(
+        MakeString("r_", Counter::instance().counter()).c_str(), ";R", 400, 0,
+        20);
+    generated_r_->SetDirectory(0);
+    generated_cos_theta_ = make_unique<TH1D>(
+        MakeString("cos_theta_", Counter::instance().counter()).c_str(),
+        ";cos(#theta)", 100, -1.0, 1.0);
+    generated_cos_theta_->SetDirectory(0);
+    generated_phi_ = make_unique<TH1D>(
+        MakeString("phi_", Counter::instance().counter()).c_str(), ";#phi",
+        100, -pi, pi);
+    generated_phi_->SetDirectory(0);
+  }
+
+  if (qa_mode_ == NucleusQA::Full && generated_rcos_theta_ == nullptr) {
+    generated_rcos_theta_ = make_unique<TH2D>(
+        MakeString("r_cos_theta_", Counter::instance().counter()).c_str(),
+        ";R;cos(#theta)", 400, 0, 20, 100, -1.0, 1.0);
+    generated_rcos_theta_->SetDirectory(0);
+    generated_position_ = make_unique<TH3D>(
+        MakeString("nucleonpos_", Counter::instance().counter()).c_str(),
+        ";dx;dy;dz", 100, -20.0, 20.0, 100, -20.0, 20.0, 100, -20.0, 20.0);
+    generated_position_->SetDirectory(0);
+    generated_smear_ = make_unique<TH3D>(
+        MakeString("nucleonsmear_", Counter::instance().counter()).c_str(),
+        ";dx;dy;dz", 100, -20.0, 20.0, 100, -20.0, 20.0, 100, -20.0, 20.0);
+    generated_smear_->SetDirectory(0);
+    smeared_position_ = make_unique<TH3D>(
+        MakeString("nucleonsmearedpos_", Counter::instance().counter()).c_str(),
+        ";dx;dy;dz", 100, -20.0, 20.0, 100, -20.0, 20.0, 100, -20.0, 20.0);
+    smeared_position_->SetDirectory(0);
+  }
+}
 
-  // initialize QA histograms
-  generated_rcos_theta_ = make_unique<TH2D>(
-      MakeString("r_cos_theta_", Counter::instance().counter()).c_str(),
-      ";R;cos(#theta)", 400, 0, 20, 100, -1.0, 1.0);
-  generated_rcos_theta_->SetDirectory(0);
-  generated_position_ = make_unique<TH3D>(
-      MakeString("nucleonpos_", Counter::instance().counter()).c_str(),
-      ";dx;dy;dz", 100, -20.0, 20.0, 100, -20.0, 20.0, 100, -20.0, 20.0);
-  generated_position_->SetDirectory(0);
-  generated_smear_ = make_unique<TH3D>(
-      MakeString("nucleonsmear_", Counter::instance().counter()).c_str(),
-      ";dx;dy;dz", 100, -20.0, 20.0, 100, -20.0, 20.0, 100, -20.0, 20.0);
-  generated_smear_->SetDirectory(0);
-  smeared_position_ = make_unique<TH3D>(
-      MakeString("nucleonsmearedpos_", Counter::instance().counter()).c_str(),
-      ";dx;dy;dz", 100, -20.0, 20.0, 100, -20.0, 20.0, 100, -20.0, 20.0);
-  smeared_position_->SetDirectory(0);
+void Nucleus::clearHistograms() {
+  generated_r_.reset();
+  generated_cos_theta_.reset();
+  generated_phi_.reset();
+  generated_rcos_theta_.reset();
+  generated_position_.reset();
+  generated_smear_.reset();
+  smeared_position_.reset();
 }
 
 TVector3 Nucleus::generateNucleonPosition() {
-  double r, theta, phi;
+  double r, cos_theta, phi;
 
-  nucleon_pdf_.sample(r, theta, phi);
+  if (nucleon_pdf_.deformed()) {
+    double theta;
+    nucleon_pdf_.sample(r, theta, phi);
+    cos_theta = cos(theta);
+  } else {
+    // spherical PDFs: only r is sampled per nucleon, the direction comes from
+    // the batch drawn at the start of the nucleus
+    if (next_radius_ < radii_.size())
+      r = radii_[next_radius_++];
+    else
+      r = nucleon_pdf_.sampleRadius();
+    if (next_direction_ == cos_theta_.size())
+      fillDirections(mass_number_);
+    cos_theta = cos_theta_[next_direction_];
+    phi = phi_[next_direction_];
+    ++next_direction_;
+  }
 
   // record the generated R & cos theta for QA
-  generated_rcos_theta_->Fill(r, cos(theta), 1.0 / pow(r, 2.0));
+  if (qa_fill_) {
+    double weight = 1.0 / (r * r);
+    generated_r_->Fill(r, weight);
+    generated_cos_theta_->Fill(cos_theta);
+    generated_phi_->Fill(phi);
+    if (qa_mode_ == NucleusQA::Full)
+      generated_rcos_theta_->Fill(r, cos_theta, weight);
+  }
 
-  TVector3 ret;
-  ret.SetMagThetaPhi(r, theta, phi);
+  double r_sin_theta = r * sqrt(1.0 - cos_theta * cos_theta);
+  return TVector3(r_sin_theta * cos(phi), r_sin_theta * sin(phi),
+                  r * cos_theta);
+}
 
-  return ret;
+void Nucleus::fillDirections(unsigned n) {
+  n = std::max(n, 1u);
+  cos_theta_.resize(n);
+  phi_.resize(n);
+  Random::instance().isotropic(cos_theta_.data(), phi_.data(), n);
+  next_direction_ = 0;
 }
 
-TVector3 Nucleus::smear() {
-  // if smearing is turned on, then we will smear the nucleon position
-  // in r, theta, phi
-  double dx = 0.0;
-  double dy = 0.0;
-  double dz = 0.0;
-  if (smearing_profile_ != nullptr) {
-    smearing_profile_->GetRandom3(dx, dy, dz);
+void Nucleus::fillSmearing(unsigned n) {
+  n = std::max(n, 1u);
+  smear_x_.resize(n);
+  smear_y_.resize(n);
+  smear_z_.resize(n);
+  next_smear_ = 0;
+  if (smear_ == NucleonSmearing::HardCore) {
+    Random::instance().uniformBall(smear_x_.data(), smear_y_.data(),
+                                   smear_z_.data(), n, smear_radius_);
+    return;
   }
-  return TVector3(dx, dy, dz);
-}
 
-const Nucleon &Nucleus::operator[](unsigned idx) const {
-  SCT_ASSERT(idx < nucleons_.size(), "Out of bounds access");
-  return nucleons_[idx];
+  // the Gaussian is truncated in each coordinate - values outside are
+  // redrawn, which happens for about one in 10^6 nucleons
+  for (auto coordinate : {&smear_x_, &smear_y_, &smear_z_}) {
+    Random::instance().normal(coordinate->data(), n, 0.0, smear_sigma_);
+    for (auto &value : *coordinate)
+      while (std::abs(value) > smear_max_)
+        Random::instance().normal(&value, 1, 0.0, smear_sigma_);
+  }
 }
 
-Nucleon &Nucleus::operator[](unsigned idx) {
-  SCT_ASSERT(idx < nucleons_.size(), "Out of bounds access");
-  return nucleons_[idx];
+TVector3 Nucleus::smear() {
+  // if smearing is turned on, then we will smear the nucleon position
+  // in x, y, z
+  if (smear_ == NucleonSmearing::None)
+    return TVector3(0.0, 0.0, 0.0);
+  if (next_smear_ == smear_x_.size())
+    fillSmearing(mass_number_);
+  TVector3 smearing(smear_x_[next_smear_], smear_y_[next_smear_],
+                    smear_z_[next_smear_]);
+  ++next_smear_;
+  return smearing;
 }
 
 bool Nucleus::generateDeuteron() {
   int tries = 0;
   while (tries < 5) {
-    Nucleon nucleon_a;
-    Nucleon nucleon_b;
     // generate a random position
     TVector3 position_a = generateNucleonPosition();
     // smear, if nucleon position smearing is turned on
@@ -301,18 +652,18 @@ bool Nucleus::generateDeuteron() {
     TVector3 smeared_position_a = position_a + smearing_a;
     TVector3 smeared_position_b = -smeared_position_a;
 
-    // create the nucleon
-    nucleon_a.set(smeared_position_a);
-    nucleon_b.set(smeared_position_b);
-
     if (repulsion_distance_ > 0.0 &&
-        nucleon_a.deltaR(nucleon_b) >= repulsion_distance_) {
+        (smeared_position_a - smeared_position_b).Mag() >=
+            repulsion_distance_) {
       // rotate by the nucleus orientation and then offset by the impact
       // parameter
-      rotateAndOffset(nucleon_a);
-      rotateAndOffset(nucleon_b);
-      nucleons_.push_back(nucleon_a);
-      nucleons_.push_back(nucleon_b);
+      for (auto &position : {smeared_position_a, smeared_position_b}) {
+        double x = position.X();
+        double y = position.Y();
+        double z = position.Z();
+        rotateAndOffset(x, y, z);
+        pushNucleon(x, y, z);
+      }
       return true;
     }
   }
@@ -326,12 +677,16 @@ bool Nucleus::generateDeuteron() {
 bool Nucleus::generateNucleus() {
   int tries = 0;
 
-  while (nucleons_.size() < mass_number_) {
+  if (repulsion_distance_ > 0.0)
+    resetRepulsionGrid();
+
+  while (size() < mass_number_) {
     if (tries > mass_number_ * 10) {
       LOG(ERROR) << "Repeated failure to create nucleus "
                  << " with " << mass_number_
                  << " nucleons, with a nucleon repulsion "
                  << "distance of " << repulsion_distance_;
+      ++repulsion_failures_;
       clear();
       return false;
     }
@@ -342,4 +697,34 @@ bool Nucleus::generateNucleus() {
   return true;
 }
 
+bool Nucleus::generateFromLibrary() {
+  if (library_uses_ == 0) {
+    library_index_ = std::min<unsigned long>(
+        Random::instance().uniform() * library_->size(), library_->size() - 1);
+  }
+  library_uses_ = (library_uses_ + 1) % library_reuse_;
+
+  // a uniformly random rotation: a rotation about z by psi, followed by the
+  // orientation (theta, phi) of the z axis. The orientation is kept, so that
+  // nucleusTheta() & nucleusPhi() describe the drawn nucleus
+  double psi = Random::instance().zeroToPi() * 2.0 - pi;
+  double theta = acos(Random::instance().centeredUniform());
+  double phi = Random::instance().zeroToPi() * 2.0 - pi;
+  setOrientation(theta, phi);
+  double cos_psi = cos(psi);
+  double sin_psi = sin(psi);
+
+  const float *nucleons = library_->configuration(library_index_);
+  for (unsigned i = 0; i < mass_number_; ++i) {
+    double x0 = nucleons[3 * i];
+    double y0 = nucleons[3 * i + 1];
+    double x = cos_psi * x0 - sin_psi * y0;
+    double y = sin_psi * x0 + cos_psi * y0;
+    double z = nucleons[3 * i + 2];
+    rotateAndOffset(x, y, z);
+    pushNucleon(x, y, z);
+  }
+  return true;
+}
+
 } // namespace sct
@@ -22,23 +22,54 @@
  * Nucleus::setParameters(GlauberSpecies...), which will lookup the proper PDF
  * and default values for its parameters for that species.
  *
+ * Nucleons are stored as a structure of arrays (x, y, z, ncoll, multiplicity),
+ * so that loops over the nucleons touch contiguous memory. Nucleus::operator[]
+ * returns a NucleonView, a lightweight reference into the arrays that behaves
+ * like a Nucleon, for compatibility with code written for
+ * std::vector<Nucleon>.
+ *
+ * When a repulsion distance d is set, each candidate nucleon is only compared
+ * to the accepted nucleons in the 27 neighbouring cells of a spatial hash grid
+ * with cell size d, instead of to every accepted nucleon. The number of
+ * candidates drawn and rejected is recorded, and can be used to tune d.
+ *
+ * QA histograms of the generated nucleons are controlled by setQAMode(). By
+ * default (NucleusQA::Full) every nucleus is recorded. NucleusQA::Sampled only
+ * records the 1D distributions in r, cos(theta) and phi, for one in every
+ * sample_rate nuclei - the dense r-cos(theta) and 3D position histograms are
+ * only recorded with NucleusQA::Full. Histograms are allocated the first time
+ * they are filled, so a nucleus that is never generated allocates none.
+ *
+ * With a NucleusLibrary set (see nucleus_library.h), generate() does not
+ * sample nucleons: it draws a precomputed configuration from the library, and
+ * rotates it to a new uniformly random orientation. Each configuration can be
+ * reused for several nuclei in a row, each with its own rotation. No QA
+ * histograms are recorded for library nuclei.
+ *
  */
 
 #include "sct/glauber/nucleon.h"
 #include "sct/glauber/nucleon_pdf.h"
+#include "sct/lib/assert.h"
 #include "sct/lib/enumerations.h"
 #include "sct/lib/memory.h"
+#include "sct/lib/string/string_utils.h"
 
+#include <array>
 #include <string>
 #include <vector>
 
+#include "TDirectory.h"
 #include "TF1.h"
-#include "TF3.h"
 #include "TH2.h"
 #include "TH3.h"
 #include "TVector3.h"
 
 namespace sct {
+
+template <typename NucleusType> class NucleonView;
+class NucleusLibrary;
+
 class Nucleus {
 public:
   // default constructor initializes to an invalid state,
@@ -66,6 +97,10 @@ public:
   // clears the current set of generated nucleons
   void clear();
 
+  // resets the collision counts & multiplicities of the nucleons, so the
+  // same nucleus can be collided again
+  void clearCollisions();
+
   // allows the user to (re)set the parameters after construction, if resetting,
   // will delete any currently generated event and clear histograms
   bool setParameters(GlauberSpecies species,
@@ -84,6 +119,33 @@ public:
   // center will sit at (b, 0, 0)
   bool generate(double b = 0.0);
 
+  // draws the radii of the nucleons of the next call to generate() in advance,
+  // and sets reach to the maximum distance of any nucleon from the nucleus
+  // center in the transverse plane (including smearing). This allows events
+  // that can not have a collision to be rejected before the nuclei are built.
+  // Returns false, and draws nothing, if the radii can not be drawn
+  // independently of the rest of the nucleus - for deformed nuclei, or when a
+  // repulsion distance is set (rejected nucleons are redrawn). The next call
+  // to clear() discards the radii
+  bool presampleRadii(double &reach);
+
+  // draws the nuclei of generate() from library, instead of sampling the
+  // nucleon PDF - each configuration is used for reuse consecutive nuclei, with
+  // a new random rotation each time. The library must hold configurations of
+  // massNumber() nucleons. Returns false, and keeps the current library, if it
+  // does not. A null library turns the library off
+  bool setLibrary(shared_ptr<const NucleusLibrary> library,
+                  unsigned reuse = 1);
+  inline const shared_ptr<const NucleusLibrary> &library() const {
+    return library_;
+  }
+  inline unsigned libraryReuse() const { return library_reuse_; }
+
+  // makes the next nucleus draw a new configuration from the library, instead
+  // of reusing the current one - used so that the nuclei drawn only depend on
+  // the random numbers, and not on earlier calls to generate()
+  inline void restartLibrary() { library_uses_ = 0; }
+
   // turn on nucleon smearing away from the Woods-Saxon profile, using either
   // a hard core (flat probability with area smear_area)  or gaussian profile
   // (with sigma of 0.79/sqrt(3), and max of sigmaNN * 5)
@@ -92,6 +154,40 @@ public:
   // sets a minimum distance between generated nucleons
   void setRepulsionDistance(double fm);
 
+  // statistics for the repulsion check, accumulated over all calls to
+  // generate() since construction or the last call to
+  // resetRepulsionStatistics(). Candidates counts every nucleon position
+  // drawn, rejections counts candidates that were closer than the repulsion
+  // distance to an accepted nucleon, and failures counts nuclei that could not
+  // be generated
+  inline unsigned long repulsionCandidates() const {
+    return repulsion_candidates_;
+  }
+  inline unsigned long repulsionRejections() const {
+    return repulsion_rejections_;
+  }
+  inline unsigned long repulsionFailures() const {
+    return repulsion_failures_;
+  }
+  void resetRepulsionStatistics();
+
+  // sets the QA histograms that are recorded (default is NucleusQA::Full).
+  // With NucleusQA::Sampled, one in every sample_rate nuclei is recorded
+  void setQAMode(NucleusQA mode, unsigned sample_rate = 100);
+  inline NucleusQA QAMode() const { return qa_mode_; }
+  inline unsigned QASampleRate() const { return qa_sample_rate_; }
+
+  // sets the index of the next nucleus, which decides if it is recorded with
+  // NucleusQA::Sampled - by default, nuclei are counted from setQAMode() or
+  // the copy. MCGlauber sets it from the event index, so that the sampled
+  // nuclei do not depend on the number of threads
+  inline void setQAIndex(unsigned long long index) { qa_counter_ = index; }
+
+  // allocates the histograms for the current QA mode now, instead of the first
+  // time they are filled - used to create the histograms before the nucleus is
+  // handed to a thread, since ROOT object creation is not thread safe
+  void allocateHistograms();
+
   // set string identifier for nucleus
   void setName(string name) { name_ = name; }
   string name() const { return name_; }
@@ -104,19 +200,40 @@ public:
   void setRandomOrientation(bool flag) { random_orientation_ = flag; }
   inline bool randomOrientation() const { return random_orientation_; }
 
-  // access to nucleons
-  const Nucleon &operator[](unsigned idx) const;
-  Nucleon &operator[](unsigned idx);
+  // access to nucleons - returns a reference to the nucleon stored at idx,
+  // which can be converted to a Nucleon
+  NucleonView<const Nucleus> operator[](unsigned idx) const;
+  NucleonView<Nucleus> operator[](unsigned idx);
+
+  // direct access to the nucleon arrays
+  inline const std::vector<double> &xArray() const { return x_; }
+  inline const std::vector<double> &yArray() const { return y_; }
+  inline const std::vector<double> &zArray() const { return z_; }
+  inline const std::vector<unsigned> &nCollArray() const { return n_coll_; }
+  inline std::vector<unsigned> &nCollArray() { return n_coll_; }
+  inline const std::vector<unsigned> &multiplicityArray() const {
+    return multiplicity_;
+  }
+  inline std::vector<unsigned> &multiplicityArray() { return multiplicity_; }
 
   // access to parameters
   inline unsigned massNumber() const { return mass_number_; }
-  inline unsigned size() const { return nucleons_.size(); }
+  inline unsigned size() const { return x_.size(); }
   inline NucleonSmearing nucleonSmearing() const { return smear_; }
+  inline double nucleonSmearingArea() const { return smear_area_; }
   inline double repulsionDistance() const { return repulsion_distance_; }
   inline double nucleusTheta() const { return nucleus_theta_; }
   inline double nucleusPhi() const { return nucleus_phi_; }
   inline double impactParameter() const { return b_; }
 
+  // QA histograms - each returns nullptr if the histogram has not been filled
+  // (or allocated with allocateHistograms()). generatedR() is weighted by
+  // 1/r^2, so it follows the nucleon density
+  inline TH1D *generatedR() const { return (TH1D *)generated_r_.get(); }
+  inline TH1D *generatedCosTheta() const {
+    return (TH1D *)generated_cos_theta_.get();
+  }
+  inline TH1D *generatedPhi() const { return (TH1D *)generated_phi_.get(); }
   inline TH2D *generatedRCosTheta() const {
     return (TH2D *)generated_rcos_theta_.get();
   }
@@ -128,22 +245,70 @@ public:
     return (TH3D *)smeared_position_.get();
   }
 
+  // adds the QA histograms of rhs to the histograms of this nucleus - used to
+  // combine the QA of per-thread copies of a nucleus
+  void mergeHistograms(const Nucleus &rhs);
+
+  // writes the QA histograms to the current directory, named prefix + "r",
+  // prefix + "cos_theta" etc, replacing objects of the same name - and reads
+  // them back from dir, replacing the current histograms. Used to checkpoint
+  // the QA of long runs
+  void writeHistograms(const string &prefix) const;
+  void readHistograms(TDirectory &dir, const string &prefix);
+
+  // adds the repulsion statistics of rhs to the statistics of this nucleus
+  void mergeRepulsionStatistics(const Nucleus &rhs);
+
   // rotates a nucleon by nucleusTheta & nucleusPhi, and translates the nucleon
   // along the x axis by b - this takes a nucleon generated in the frame
   // centered on the nucleus, and translates it into the collision CM frame
   void rotateAndOffset(Nucleon &n);
 
 private:
+  // sets the nucleus orientation, and the rotation matrix used in
+  // rotateAndOffset
+  void setOrientation(double theta, double phi);
+
+  // rotates (x, y, z) by the nucleus orientation, and offsets x by the impact
+  // parameter
+  void rotateAndOffset(double &x, double &y, double &z) const;
+
+  // reserves space in the nucleon arrays for n nucleons
+  void reserve(unsigned n);
+
+  // appends a nucleon at (x, y, z) with no collisions
+  void pushNucleon(double x, double y, double z);
+
   // generates one random nucleon and rotates it wrt the nucleus orientation, if
   // applicable
   void addNucleon(double b);
 
-  // (re)creates QA histograms
-  void initHistograms();
+  // empties the repulsion grid, and sizes it for the current repulsion
+  // distance and mass number
+  void resetRepulsionGrid();
+
+  // returns the bucket of the repulsion grid holding cell (ix, iy, iz)
+  unsigned repulsionBucket(long ix, long iy, long iz) const;
+
+  // returns true if (x, y, z) is within the repulsion distance of an accepted
+  // nucleon
+  bool repulsionOverlap(double x, double y, double z) const;
+
+  // adds nucleon idx to the repulsion grid
+  void insertRepulsionGrid(unsigned idx);
+
+  // deletes all QA histograms - they are recreated on the next fill
+  void clearHistograms();
 
   // functions to generate a random nucleon position, and to generate a smearing
   // factor
   TVector3 generateNucleonPosition();
+
+  // draws the directions for the spherical PDFs, n at a time
+  void fillDirections(unsigned n);
+
+  // draws the smearing offsets, n at a time, and returns the next one
+  void fillSmearing(unsigned n);
   TVector3 smear();
 
   // special function to generate a deuteron nucleus - places the nucleons
@@ -153,29 +318,89 @@ private:
   // generator for any non-deuteron nucleus
   bool generateNucleus();
 
-  std::vector<Nucleon> nucleons_; // container for nucleons
+  // draws the nucleus from the library, with a random rotation
+  bool generateFromLibrary();
+
+  // nucleon positions in the collision frame, number of binary collisions,
+  // and multiplicity, stored as a structure of arrays
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> z_;
+  std::vector<unsigned> n_coll_;
+  std::vector<unsigned> multiplicity_;
 
   string name_; // string identifier
 
   unsigned mass_number_; // nuclear mass number
 
   NucleonSmearing smear_; // flag for nucleon position smearing
+  double smear_area_;     // area used to define the smearing profile
 
   double repulsion_distance_; // force nucleons to be minimum
                               // repulsionDistance_ away from each other
 
+  // spatial hash grid of accepted nucleons used for the repulsion check - the
+  // buckets are singly linked lists of nucleon indices
+  double grid_inv_cell_;          // inverse of the grid cell size
+  unsigned grid_mask_;            // number of buckets - 1 (power of two)
+  std::vector<int> grid_head_;    // first nucleon in each bucket, or -1
+  std::vector<int> grid_next_;    // next nucleon in the same bucket, or -1
+
+  unsigned long repulsion_candidates_; // repulsion statistics
+  unsigned long repulsion_rejections_;
+  unsigned long repulsion_failures_;
+
   bool random_orientation_; // if set to true, the nucleus will be oriented in
                             // a random direction (only useful if beta2 or
                             // beta4 are non-zero)
   double nucleus_theta_; // for deformed nuclei, specifies the polar & azimuthal
   double nucleus_phi_;   // angles in the collision frame for a specific event
+  std::array<double, 9> rotation_; // row-major rotation matrix, RotateY(theta)
+                                   // followed by RotateZ(phi)
 
   double b_; // impact parameter for a specific event
 
   NucleonPDF nucleon_pdf_; // density profile for nucleons
 
-  unique_ptr<TF3>
-      smearing_profile_; // Used to smear nucleon position if requested
+  // directions drawn in a batch for spherical PDFs - the next nucleon uses
+  // element next_direction_
+  std::vector<double> cos_theta_;
+  std::vector<double> phi_;
+  unsigned next_direction_;
+
+  // radii drawn by presampleRadii(), used in order by generate()
+  std::vector<double> radii_;
+  unsigned next_radius_;
+  bool presampled_;
+
+  // precomputed configurations used instead of the nucleon PDF, the number of
+  // nuclei each configuration is used for, the number of nuclei the current
+  // configuration has been used for, and its index in the library
+  shared_ptr<const NucleusLibrary> library_;
+  unsigned library_reuse_;
+  unsigned library_uses_;
+  unsigned long library_index_;
+
+  // nucleon smearing profile: the radius of the HardCore ball, or the sigma of
+  // the Gaussian, which is truncated at smear_max_ in each coordinate
+  double smear_radius_;
+  double smear_sigma_;
+  double smear_max_;
+
+  // smearing offsets drawn in a batch, used like the directions
+  std::vector<double> smear_x_;
+  std::vector<double> smear_y_;
+  std::vector<double> smear_z_;
+  unsigned next_smear_;
+
+  NucleusQA qa_mode_;             // QA histograms to record
+  unsigned qa_sample_rate_;       // record one in qa_sample_rate_ nuclei
+  unsigned long long qa_counter_; // index of the next nucleus, for sampling
+  bool qa_fill_;             // true if the current nucleus is recorded
+
+  unique_ptr<TH1> generated_r_;         // sampled r (weighted by 1/r^2)
+  unique_ptr<TH1> generated_cos_theta_; // sampled cos(theta)
+  unique_ptr<TH1> generated_phi_;       // sampled phi
 
   unique_ptr<TH2> generated_rcos_theta_; // histogram recording sampled r/theta
                                          // from woods-saxon
@@ -186,6 +411,74 @@ private:
   unique_ptr<TH3>
       smeared_position_; // histogram recording the final smeared position
 };
+
+// reference to a single nucleon stored in a Nucleus, with the same interface
+// as Nucleon. NucleusType is either Nucleus, or const Nucleus for a read-only
+// view
+template <typename NucleusType> class NucleonView {
+public:
+  NucleonView(NucleusType &nucleus, unsigned idx)
+      : nucleus_(nucleus), idx_(idx) {}
+
+  // copies the nucleon out of the nucleus
+  operator Nucleon() const {
+    return Nucleon(x(), y(), z(), nColl(), multiplicity());
+  }
+
+  inline TVector3 position() const { return TVector3(x(), y(), z()); }
+  inline double phi() const { return position().Phi(); }
+  inline double theta() const { return position().Theta(); }
+  inline double r() const { return sqrt(x() * x() + y() * y() + z() * z()); }
+
+  inline double x() const { return nucleus_.xArray()[idx_]; }
+  inline double y() const { return nucleus_.yArray()[idx_]; }
+  inline double z() const { return nucleus_.zArray()[idx_]; }
+  inline double x2() const { return x() * x(); }
+  inline double y2() const { return y() * y(); }
+  inline double z2() const { return z() * z(); }
+  inline double xy() const { return x() * y(); }
+  inline double yz() const { return y() * z(); }
+  inline double zx() const { return z() * x(); }
+
+  inline double deltaR(const Nucleon &rhs) const {
+    double dX = x() - rhs.x();
+    double dY = y() - rhs.y();
+    double dZ = z() - rhs.z();
+    return sqrt(dX * dX + dY * dY + dZ * dZ);
+  }
+  inline double deltaXY(const Nucleon &rhs) const {
+    double dX = x() - rhs.x();
+    double dY = y() - rhs.y();
+    return sqrt(dX * dX + dY * dY);
+  }
+
+  inline bool participant() const { return nColl() ? true : false; }
+  inline unsigned nColl() const { return nucleus_.nCollArray()[idx_]; }
+  inline double multiplicity() const {
+    return nucleus_.multiplicityArray()[idx_];
+  }
+
+  // only available for non-const nuclei
+  inline void incrementNColl() { ++nucleus_.nCollArray()[idx_]; }
+  inline void setMultiplicity(double mult) {
+    nucleus_.multiplicityArray()[idx_] = mult;
+  }
+
+private:
+  NucleusType &nucleus_;
+  unsigned idx_;
+};
+
+inline NucleonView<const Nucleus> Nucleus::operator[](unsigned idx) const {
+  SCT_ASSERT(idx < size(), "Out of bounds access");
+  return NucleonView<const Nucleus>(*this, idx);
+}
+
+inline NucleonView<Nucleus> Nucleus::operator[](unsigned idx) {
+  SCT_ASSERT(idx < size(), "Out of bounds access");
+  return NucleonView<Nucleus>(*this, idx);
+}
+
 } // namespace sct
 
 #endif // SCT_GLAUBER_NUCLEUS_H
\ No newline at end of file
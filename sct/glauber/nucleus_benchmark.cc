@@ -20,6 +20,34 @@ static void BM_NucleusGeneration(benchmark::State &state) {
   }
 }
 
+// QA mode: 0 = off, 1 = sampled, 2 = full
+static void BM_NucleusGenerationQA(benchmark::State &state) {
+  sct::Nucleus nucleus;
+  sct::parameter_list params;
+  params["radius"] = 6.0;
+  params["skin_depth"] = 0.5;
+  nucleus.setParameters(197, params, sct::NucleonPDF::PDF::WoodsSaxon1D);
+  nucleus.setQAMode(static_cast<sct::NucleusQA>(state.range(0)));
+  for (auto _ : state) {
+    nucleus.generate();
+  }
+}
+
+// deformed nuclei sample (r, cos(theta)) from the 2D Woods Saxon
+static void BM_DeformedNucleusGeneration(benchmark::State &state) {
+  sct::Nucleus nucleus;
+  sct::parameter_list params;
+  params["radius"] = 6.38;
+  params["skin_depth"] = 0.535;
+  params["beta2"] = 0.28;
+  params["beta4"] = 0.093;
+  nucleus.setParameters(state.range(0), params,
+                        sct::NucleonPDF::PDF::WoodsSaxon2D);
+  for (auto _ : state) {
+    nucleus.generate();
+  }
+}
+
 static void BM_NucleonRepulsion(benchmark::State &state) {
   sct::Nucleus nucleus;
   sct::parameter_list params;
@@ -48,6 +76,8 @@ static void BM_NucleusGenerationRepulsion(benchmark::State &state) {
 
 BENCHMARK(BM_NucleusCreation);
 BENCHMARK(BM_NucleusGeneration)->Range(10, 1000);
+BENCHMARK(BM_NucleusGenerationQA)->DenseRange(0, 2);
+BENCHMARK(BM_DeformedNucleusGeneration)->Range(10, 1000);
 BENCHMARK(BM_NucleonRepulsion)->Range(10, 1000);
 BENCHMARK(BM_NucleusGenerationRepulsion)->Ranges({{10, 1000}, {1, 500}});
 
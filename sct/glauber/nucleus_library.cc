@@ -0,0 +1,250 @@
+#include "sct/glauber/nucleus_library.h"
+
+#include "sct/glauber/nucleus.h"
+#include "sct/lib/logging.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sct {
+
+namespace {
+const char library_magic[8] = {'S', 'C', 'T', 'N', 'U', 'C', 'L', '1'};
+constexpr unsigned parameter_name_size = 24;
+
+// the fixed part of the file header
+struct LibraryHeader {
+  char magic[8];
+  uint32_t mass_number;
+  uint32_t n_parameters;
+  uint64_t size;
+  int32_t smearing;
+  uint32_t unused;
+  double repulsion_distance;
+};
+static_assert(sizeof(LibraryHeader) == 40, "unexpected library header size");
+
+// a PDF parameter in the file header
+struct LibraryParameter {
+  char name[parameter_name_size];
+  double value;
+};
+static_assert(sizeof(LibraryParameter) == 32,
+              "unexpected library parameter size");
+} // namespace
+
+NucleusLibrary::NucleusLibrary()
+    : mass_number_(0), size_(0), smearing_(NucleonSmearing::None),
+      repulsion_distance_(0.0), data_(nullptr), mapped_size_(0),
+      configurations_(nullptr) {}
+
+NucleusLibrary::~NucleusLibrary() { close(); }
+
+bool NucleusLibrary::open(const string &filename) {
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "could not open nucleus library " << filename;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(LibraryHeader)) {
+    LOG(ERROR) << filename << " is too small to be a nucleus library";
+    ::close(fd);
+    return false;
+  }
+
+  // the mapping stays valid after the file is closed
+  size_t file_size = info.st_size;
+  void *data = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "could not map nucleus library " << filename;
+    return false;
+  }
+
+  const char *bytes = static_cast<const char *>(data);
+  LibraryHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  size_t offset = sizeof(header) + header.n_parameters *
+                                       sizeof(LibraryParameter);
+  bool valid =
+      std::memcmp(header.magic, library_magic, sizeof(library_magic)) == 0 &&
+      header.mass_number > 0 && header.smearing >= 0 &&
+      header.smearing <= static_cast<int32_t>(NucleonSmearing::Gaussian) &&
+      offset <= file_size &&
+      header.size <= (file_size - offset) / (3 * sizeof(float)) /
+                         header.mass_number;
+  if (!valid) {
+    LOG(ERROR) << filename << " is not a valid nucleus library";
+    munmap(data, file_size);
+    return false;
+  }
+
+  for (unsigned i = 0; i < header.n_parameters; ++i) {
+    LibraryParameter parameter;
+    std::memcpy(&parameter, bytes + sizeof(header) + i * sizeof(parameter),
+                sizeof(parameter));
+    parameters_[string(parameter.name,
+                       strnlen(parameter.name, parameter_name_size))] =
+        parameter.value;
+  }
+
+  filename_ = filename;
+  mass_number_ = header.mass_number;
+  size_ = header.size;
+  smearing_ = static_cast<NucleonSmearing>(header.smearing);
+  repulsion_distance_ = header.repulsion_distance;
+  data_ = data;
+  mapped_size_ = file_size;
+  configurations_ = reinterpret_cast<const float *>(bytes + offset);
+  return true;
+}
+
+void NucleusLibrary::close() {
+  if (data_ != nullptr)
+    munmap(data_, mapped_size_);
+  data_ = nullptr;
+  mapped_size_ = 0;
+  configurations_ = nullptr;
+  filename_.clear();
+  mass_number_ = 0;
+  size_ = 0;
+  smearing_ = NucleonSmearing::None;
+  repulsion_distance_ = 0.0;
+  parameters_.clear();
+}
+
+NucleusLibraryWriter::NucleusLibraryWriter()
+    : file_(nullptr), mass_number_(0), size_(0), good_(false) {}
+
+NucleusLibraryWriter::~NucleusLibraryWriter() { close(); }
+
+bool NucleusLibraryWriter::create(const string &filename,
+                                  unsigned mass_number,
+                                  const parameter_list &parameters,
+                                  double repulsion_distance,
+                                  NucleonSmearing smearing) {
+  close();
+  if (mass_number == 0) {
+    LOG(ERROR) << "nucleus library needs a non-zero mass number";
+    return false;
+  }
+  file_ = fopen(filename.c_str(), "wb");
+  if (file_ == nullptr) {
+    LOG(ERROR) << "could not create nucleus library " << filename;
+    return false;
+  }
+
+  // the number of configurations is filled in by close()
+  LibraryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, library_magic, sizeof(library_magic));
+  header.mass_number = mass_number;
+  header.n_parameters = parameters.size();
+  header.smearing = static_cast<int32_t>(smearing);
+  header.repulsion_distance = repulsion_distance;
+  good_ = fwrite(&header, sizeof(header), 1, file_) == 1;
+
+  for (auto &entry : parameters) {
+    if (entry.first.size() >= parameter_name_size) {
+      LOG(ERROR) << "PDF parameter name " << entry.first
+                 << " is too long for a nucleus library";
+      good_ = false;
+    }
+    LibraryParameter parameter;
+    std::memset(&parameter, 0, sizeof(parameter));
+    std::strncpy(parameter.name, entry.first.c_str(),
+                 parameter_name_size - 1);
+    parameter.value = entry.second;
+    good_ = good_ && fwrite(&parameter, sizeof(parameter), 1, file_) == 1;
+  }
+
+  filename_ = filename;
+  mass_number_ = mass_number;
+  size_ = 0;
+  buffer_.resize(3 * mass_number);
+  return good_;
+}
+
+bool NucleusLibraryWriter::add(const double *x, const double *y,
+                               const double *z) {
+  if (file_ == nullptr)
+    return false;
+  for (unsigned i = 0; i < mass_number_; ++i) {
+    buffer_[3 * i] = x[i];
+    buffer_[3 * i + 1] = y[i];
+    buffer_[3 * i + 2] = z[i];
+  }
+  good_ = good_ && fwrite(buffer_.data(), sizeof(float), buffer_.size(),
+                          file_) == buffer_.size();
+  size_++;
+  return good_;
+}
+
+bool NucleusLibraryWriter::add(const Nucleus &nucleus) {
+  if (nucleus.size() != mass_number_) {
+    LOG(ERROR) << "nucleus with " << nucleus.size() << " nucleons can not be "
+               << "added to a library of " << mass_number_ << " nucleons";
+    return false;
+  }
+  return add(nucleus.xArray().data(), nucleus.yArray().data(),
+             nucleus.zArray().data());
+}
+
+bool NucleusLibraryWriter::close() {
+  if (file_ == nullptr)
+    return false;
+  good_ = good_ && fseek(file_, offsetof(LibraryHeader, size), SEEK_SET) == 0 &&
+          fwrite(&size_, sizeof(size_), 1, file_) == 1;
+  good_ = fclose(file_) == 0 && good_;
+  file_ = nullptr;
+  if (!good_)
+    LOG(ERROR) << "failed to write nucleus library " << filename_;
+  return good_;
+}
+
+bool BuildNucleusLibrary(Nucleus &nucleus, uint64_t n,
+                         const string &filename) {
+  NucleusLibraryWriter writer;
+  if (!writer.create(filename, nucleus.massNumber(),
+                     nucleus.nuclearPDF().parameters(),
+                     nucleus.repulsionDistance(), nucleus.nucleonSmearing()))
+    return false;
+
+  // configurations are stored in the frame of the nucleus - they are rotated
+  // when they are drawn
+  bool random_orientation = nucleus.randomOrientation();
+  nucleus.setRandomOrientation(false);
+
+  // generation fails occasionally (no configuration satisfying the repulsion
+  // distance is found) - like MCGlauber, a failed configuration is thrown
+  // again, and the build only fails after repeated errors
+  int max_errors = 10;
+  bool success = true;
+  for (uint64_t i = 0; success && i < n; ++i) {
+    bool generated = false;
+    for (int errors = 0; !generated && errors < max_errors; ++errors)
+      generated = nucleus.generate(0.0);
+    if (!generated) {
+      LOG(ERROR) << "repeated errors generating nuclei for library "
+                 << filename << " - aborting";
+      success = false;
+    } else {
+      success = writer.add(nucleus);
+    }
+  }
+  nucleus.setRandomOrientation(random_orientation);
+  nucleus.clear();
+
+  return writer.close() && success;
+}
+
+} // namespace sct
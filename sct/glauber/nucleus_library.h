@@ -0,0 +1,134 @@
+#ifndef SCT_GLAUBER_NUCLEUS_LIBRARY_H
+#define SCT_GLAUBER_NUCLEUS_LIBRARY_H
+
+/* A library of precomputed nucleon configurations for one nucleus setting
+ * (species & PDF parameters, repulsion distance and smearing), stored in a
+ * compact binary file that is memory-mapped for reading. Building heavy
+ * nuclei with a repulsion distance or smearing is the most expensive part of
+ * MCGlauber, and does not depend on the impact parameter - with a library
+ * (see Nucleus::setLibrary and MCGlauber::setNucleusLibrary), each nucleus is
+ * a configuration drawn from the library instead, with a new random rotation.
+ *
+ * Configurations are stored unrotated, in the frame of the nucleus. The file
+ * layout (little endian) is
+ *
+ *   char[8]  magic "SCTNUCL1"
+ *   uint32   mass number A
+ *   uint32   number of PDF parameters P
+ *   uint64   number of configurations N
+ *   int32    nucleon smearing (0: none, 1: hard core, 2: gaussian)
+ *   uint32   unused (zero)
+ *   float64  repulsion distance [fm]
+ *   P times: char[24] PDF parameter name (zero padded), float64 value
+ *   N times: A times float32 x, y, z [fm]
+ *
+ * Libraries of externally produced configurations - for instance nucleon
+ * positions from ab-initio calculations - are written in the same format with
+ * NucleusLibraryWriter, and are used in the same way.
+ */
+
+#include "sct/glauber/nucleon_pdf.h"
+#include "sct/lib/enumerations.h"
+#include "sct/lib/string/string_utils.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace sct {
+
+class Nucleus;
+
+// a read-only mapping of a library file. A single library can be shared by any
+// number of nuclei, in any number of threads
+class NucleusLibrary {
+public:
+  NucleusLibrary();
+  ~NucleusLibrary();
+
+  // maps filename into memory - returns false if it can not be read, or is
+  // not a nucleus library
+  bool open(const string &filename);
+  void close();
+  inline bool isOpen() const { return data_ != nullptr; }
+
+  inline const string &filename() const { return filename_; }
+  inline unsigned massNumber() const { return mass_number_; }
+  inline uint64_t size() const { return size_; }
+  inline NucleonSmearing smearing() const { return smearing_; }
+  inline double repulsionDistance() const { return repulsion_distance_; }
+  inline const parameter_list &parameters() const { return parameters_; }
+
+  // coordinates of configuration idx: x, y, z of each nucleon in turn
+  inline const float *configuration(uint64_t idx) const {
+    return configurations_ + idx * 3 * mass_number_;
+  }
+
+private:
+  NucleusLibrary(const NucleusLibrary &) = delete;
+  NucleusLibrary &operator=(const NucleusLibrary &) = delete;
+
+  string filename_;
+  unsigned mass_number_;
+  uint64_t size_;
+  NucleonSmearing smearing_;
+  double repulsion_distance_;
+  parameter_list parameters_;
+
+  // the mapped file, and the start of the configurations in it
+  void *data_;
+  size_t mapped_size_;
+  const float *configurations_;
+};
+
+// writes a library file one configuration at a time
+class NucleusLibraryWriter {
+public:
+  NucleusLibraryWriter();
+  ~NucleusLibraryWriter();
+
+  // creates filename (overwriting any existing file) for configurations of
+  // mass_number nucleons, described by the PDF parameters, repulsion distance
+  // & smearing they were generated with. Returns false if the file can not be
+  // created
+  bool create(const string &filename, unsigned mass_number,
+              const parameter_list &parameters = parameter_list(),
+              double repulsion_distance = 0.0,
+              NucleonSmearing smearing = NucleonSmearing::None);
+
+  // adds a configuration of massNumber() nucleons, given as coordinate arrays
+  bool add(const double *x, const double *y, const double *z);
+
+  // adds the nucleons of nucleus, which must be generated without an
+  // orientation or impact parameter (see BuildNucleusLibrary)
+  bool add(const Nucleus &nucleus);
+
+  // writes the number of configurations to the header, and closes the file.
+  // Returns false if any write failed
+  bool close();
+
+  inline unsigned massNumber() const { return mass_number_; }
+  inline uint64_t size() const { return size_; }
+
+private:
+  NucleusLibraryWriter(const NucleusLibraryWriter &) = delete;
+  NucleusLibraryWriter &operator=(const NucleusLibraryWriter &) = delete;
+
+  FILE *file_;
+  string filename_;
+  unsigned mass_number_;
+  uint64_t size_;
+  bool good_;
+  std::vector<float> buffer_;
+};
+
+// generates n configurations of nucleus, with its current settings, and
+// writes them to the library filename. The nuclei are generated without a
+// random orientation, at zero impact parameter. A configuration that fails to
+// generate is retried, up to 10 times. Returns false on failure
+bool BuildNucleusLibrary(Nucleus &nucleus, uint64_t n,
+                         const string &filename);
+
+} // namespace sct
+
+#endif // SCT_GLAUBER_NUCLEUS_LIBRARY_H
@@ -0,0 +1,156 @@
+#include "sct/glauber/nucleus.h"
+#include "sct/glauber/nucleus_library.h"
+#include "sct/lib/enumerations.h"
+#include "sct/lib/memory.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+// squared distance between nucleons i & j
+template <typename Coordinates>
+double Distance2(const Coordinates &x, const Coordinates &y,
+                 const Coordinates &z, unsigned i, unsigned j) {
+  return (x[i] - x[j]) * (x[i] - x[j]) + (y[i] - y[j]) * (y[i] - y[j]) +
+         (z[i] - z[j]) * (z[i] - z[j]);
+}
+} // namespace
+
+// externally produced configurations are read back with their header
+TEST(NucleusLibrary, roundTrip) {
+  std::string filename = testing::TempDir() + "nucleus_library_test.bin";
+  std::vector<double> x{0.0, 1.5, -2.25};
+  std::vector<double> y{0.5, -1.0, 3.0};
+  std::vector<double> z{-0.75, 2.0, 0.25};
+
+  sct::NucleusLibraryWriter writer;
+  ASSERT_TRUE(writer.create(filename, 3, {{"radius", 2.5}, {"beta2", 0.3}},
+                            0.4, sct::NucleonSmearing::Gaussian));
+  EXPECT_TRUE(writer.add(x.data(), y.data(), z.data()));
+  EXPECT_TRUE(writer.add(z.data(), x.data(), y.data()));
+  EXPECT_TRUE(writer.close());
+
+  sct::NucleusLibrary library;
+  ASSERT_TRUE(library.open(filename));
+  EXPECT_EQ(library.massNumber(), 3);
+  EXPECT_EQ(library.size(), 2);
+  EXPECT_EQ(library.repulsionDistance(), 0.4);
+  EXPECT_EQ(library.smearing(), sct::NucleonSmearing::Gaussian);
+  EXPECT_EQ(library.parameters().size(), 2);
+  EXPECT_EQ(library.parameters().at("radius"), 2.5);
+  EXPECT_EQ(library.parameters().at("beta2"), 0.3);
+
+  const float *first = library.configuration(0);
+  const float *second = library.configuration(1);
+  for (unsigned i = 0; i < 3; ++i) {
+    EXPECT_EQ(first[3 * i], x[i]);
+    EXPECT_EQ(first[3 * i + 1], y[i]);
+    EXPECT_EQ(first[3 * i + 2], z[i]);
+    EXPECT_EQ(second[3 * i], z[i]);
+    EXPECT_EQ(second[3 * i + 1], x[i]);
+    EXPECT_EQ(second[3 * i + 2], y[i]);
+  }
+
+  library.close();
+  std::remove(filename.c_str());
+}
+
+// files that are not libraries are rejected
+TEST(NucleusLibrary, invalidFile) {
+  std::string filename = testing::TempDir() + "nucleus_library_invalid.bin";
+  FILE *file = fopen(filename.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  std::vector<char> garbage(100, 'x');
+  fwrite(garbage.data(), 1, garbage.size(), file);
+  fclose(file);
+
+  sct::NucleusLibrary library;
+  EXPECT_FALSE(library.open(filename));
+  EXPECT_FALSE(library.isOpen());
+  EXPECT_FALSE(library.open(filename + ".missing"));
+  std::remove(filename.c_str());
+}
+
+// nuclei drawn from a library are rotated & offset copies of its
+// configurations, and each configuration is used reuse times in a row
+TEST(NucleusLibrary, nucleusFromLibrary) {
+  std::string filename = testing::TempDir() + "nucleus_library_au.bin";
+  sct::Nucleus builder(sct::GlauberSpecies::Au197);
+  builder.setRepulsionDistance(0.4);
+  ASSERT_TRUE(sct::BuildNucleusLibrary(builder, 5, filename));
+
+  auto library = sct::make_shared<sct::NucleusLibrary>();
+  ASSERT_TRUE(library->open(filename));
+  EXPECT_EQ(library->size(), 5);
+  EXPECT_EQ(library->repulsionDistance(), 0.4);
+
+  sct::Nucleus copper(sct::GlauberSpecies::Cu63);
+  EXPECT_FALSE(copper.setLibrary(library));
+
+  sct::Nucleus nucleus(sct::GlauberSpecies::Au197);
+  EXPECT_FALSE(nucleus.setLibrary(library, 0));
+  ASSERT_TRUE(nucleus.setLibrary(library, 3));
+
+  // the configuration in use is found by its pairwise distances, which do not
+  // change under rotation & offset
+  auto find_configuration = [&](const sct::Nucleus &drawn) {
+    for (unsigned c = 0; c < library->size(); ++c) {
+      const float *nucleons = library->configuration(c);
+      std::vector<float> x, y, z;
+      for (unsigned i = 0; i < library->massNumber(); ++i) {
+        x.push_back(nucleons[3 * i]);
+        y.push_back(nucleons[3 * i + 1]);
+        z.push_back(nucleons[3 * i + 2]);
+      }
+      bool match = true;
+      for (unsigned i = 1; match && i < drawn.size(); ++i) {
+        double expected = sqrt(Distance2(x, y, z, 0, i));
+        double distance = sqrt(Distance2(drawn.xArray(), drawn.yArray(),
+                                         drawn.zArray(), 0, i));
+        match = std::abs(distance - expected) < 1e-3;
+      }
+      if (match)
+        return static_cast<int>(c);
+    }
+    return -1;
+  };
+
+  for (int i = 0; i < 4; ++i) {
+    std::vector<int> used;
+    std::vector<double> theta;
+    for (int j = 0; j < 3; ++j) {
+      ASSERT_TRUE(nucleus.generate(1.5));
+      ASSERT_EQ(nucleus.size(), 197);
+      used.push_back(find_configuration(nucleus));
+      theta.push_back(nucleus.nucleusTheta());
+
+      // the center of mass is offset by b
+      double x_sum = 0.0;
+      for (auto x : nucleus.xArray())
+        x_sum += x;
+      EXPECT_NEAR(x_sum / nucleus.size(), 1.5, 1.0);
+    }
+    EXPECT_GE(used[0], 0);
+    EXPECT_EQ(used[0], used[1]);
+    EXPECT_EQ(used[0], used[2]);
+    EXPECT_NE(theta[0], theta[1]);
+  }
+
+  std::remove(filename.c_str());
+}
+
+// a nucleus that can never be generated fails the build after a bounded number
+// of attempts, instead of looping forever
+TEST(NucleusLibrary, buildFailure) {
+  std::string filename = testing::TempDir() + "nucleus_library_failure.bin";
+  sct::Nucleus builder(sct::GlauberSpecies::Au197);
+  builder.setRepulsionDistance(10.0);
+  EXPECT_FALSE(sct::BuildNucleusLibrary(builder, 5, filename));
+  EXPECT_EQ(builder.repulsionFailures(), 10);
+  EXPECT_TRUE(builder.randomOrientation());
+  std::remove(filename.c_str());
+}
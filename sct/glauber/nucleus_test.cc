@@ -87,6 +87,45 @@ TEST(nucleus, defaultGold) {
   EXPECT_LE(abs(nucleus.nucleusPhi()), sct::pi);   // [-pi, pi]
 }
 
+// the nucleon view should read from and write to the nucleon arrays
+TEST(nucleus, nucleonView) {
+  sct::Nucleus nucleus;
+  nucleus.setParameters(sct::GlauberSpecies::Cu63);
+  nucleus.generate(2.0);
+
+  ASSERT_EQ(nucleus.size(), 63);
+  EXPECT_EQ(nucleus.xArray().size(), 63);
+
+  for (int i = 0; i < nucleus.size(); ++i) {
+    EXPECT_EQ(nucleus[i].x(), nucleus.xArray()[i]);
+    EXPECT_EQ(nucleus[i].y(), nucleus.yArray()[i]);
+    EXPECT_EQ(nucleus[i].z(), nucleus.zArray()[i]);
+    EXPECT_EQ(nucleus[i].nColl(), 0);
+  }
+
+  nucleus[3].incrementNColl();
+  nucleus[3].incrementNColl();
+  nucleus[3].setMultiplicity(5);
+  EXPECT_EQ(nucleus.nCollArray()[3], 2);
+  EXPECT_EQ(nucleus.multiplicityArray()[3], 5);
+
+  sct::Nucleon nucleon = nucleus[3];
+  EXPECT_EQ(nucleon.x(), nucleus[3].x());
+  EXPECT_EQ(nucleon.y(), nucleus[3].y());
+  EXPECT_EQ(nucleon.z(), nucleus[3].z());
+  EXPECT_EQ(nucleon.nColl(), 2);
+  EXPECT_EQ(nucleon.multiplicity(), 5);
+  EXPECT_NEAR(nucleon.r(), nucleus[3].r(), 1e-12);
+
+  sct::Nucleon other = nucleus[7];
+  EXPECT_NEAR(nucleus[3].deltaR(other), nucleon.deltaR(other), 1e-12);
+  EXPECT_NEAR(nucleus[3].deltaXY(other), nucleon.deltaXY(other), 1e-12);
+
+  const sct::Nucleus &const_nucleus = nucleus;
+  EXPECT_EQ(const_nucleus[3].nColl(), 2);
+  EXPECT_TRUE(const_nucleus[3].participant());
+}
+
 TEST(nucleus, repulsionDistance) {
   sct::Nucleus nucleus;
   nucleus.setParameters(sct::GlauberSpecies::Au197);
@@ -104,12 +143,43 @@ TEST(nucleus, repulsionDistance) {
   }
 }
 
+// with a large repulsion distance, candidates are regularly rejected - the
+// accepted nucleons must still respect the repulsion distance, and every
+// candidate must be either accepted or rejected
+TEST(nucleus, repulsionStatistics) {
+  sct::Nucleus nucleus;
+  nucleus.setParameters(sct::GlauberSpecies::Au197);
+  double repulsion = 0.9;
+  nucleus.setRepulsionDistance(repulsion);
+
+  unsigned long accepted = 0;
+  for (int event = 0; event < 1e3; ++event) {
+    nucleus.generate(1.0);
+    accepted += nucleus.size();
+    for (int i = 0; i < nucleus.size(); ++i) {
+      for (int j = i + 1; j < nucleus.size(); ++j) {
+        EXPECT_GE(nucleus[i].deltaR(nucleus[j]), repulsion);
+      }
+    }
+  }
+
+  EXPECT_EQ(nucleus.repulsionFailures(), 0);
+  EXPECT_GT(nucleus.repulsionRejections(), 0);
+  EXPECT_EQ(nucleus.repulsionCandidates(),
+            accepted + nucleus.repulsionRejections());
+
+  nucleus.resetRepulsionStatistics();
+  EXPECT_EQ(nucleus.repulsionCandidates(), 0);
+  EXPECT_EQ(nucleus.repulsionRejections(), 0);
+}
+
 TEST(nucleus, sphericalDistribution) {
   // this will be a statistical test of the width of the generated nucleon
   // distribution in x, y, z
   sct::Nucleus nucleus;
   nucleus.setParameters(sct::GlauberSpecies::Au197);
   nucleus.setRepulsionDistance(0.00);
+  nucleus.setQAMode(sct::NucleusQA::Full);
 
   for (int event = 0; event < 1e4; ++event) {
     nucleus.generate();
@@ -126,6 +196,41 @@ TEST(nucleus, sphericalDistribution) {
   EXPECT_GE(projection_z->KolmogorovTest(projection_x), 0.01);
 }
 
+// the smearing offsets follow the profile set by setNucleonSmearing: a uniform
+// ball with area smear_area, or a gaussian with sigma 0.79/sqrt(3)
+TEST(nucleus, nucleonSmearing) {
+  sct::Nucleus nucleus;
+  nucleus.setParameters(sct::GlauberSpecies::Au197);
+  nucleus.setQAMode(sct::NucleusQA::Full);
+
+  double area = 4.2;
+  double radius = sqrt(area / sct::pi);
+  nucleus.setNucleonSmearing(sct::NucleonSmearing::HardCore, area);
+  for (int event = 0; event < 100; ++event)
+    nucleus.generate();
+  TH3D *smear = nucleus.generatedSmear();
+  double r2 = 0.0;
+  for (int axis = 1; axis <= 3; ++axis) {
+    double rms = smear->GetRMS(axis);
+    r2 += rms * rms;
+    EXPECT_NEAR(smear->GetMean(axis), 0.0, 0.01);
+  }
+  // <r^2> = 3/5 R^2 for a uniform ball
+  EXPECT_NEAR(r2, 0.6 * radius * radius, 0.02);
+
+  sct::Nucleus gaussian;
+  gaussian.setParameters(sct::GlauberSpecies::Au197);
+  gaussian.setQAMode(sct::NucleusQA::Full);
+  gaussian.setNucleonSmearing(sct::NucleonSmearing::Gaussian, area);
+  for (int event = 0; event < 100; ++event)
+    gaussian.generate();
+  smear = gaussian.generatedSmear();
+  for (int axis = 1; axis <= 3; ++axis) {
+    EXPECT_NEAR(smear->GetMean(axis), 0.0, 0.01);
+    EXPECT_NEAR(smear->GetRMS(axis), 0.79 / sqrt(3.0), 0.01);
+  }
+}
+
 TEST(nucleus, woodsSaxon1D) {
   sct::Nucleus nucleus;
   sct::GlauberSpecies species = sct::GlauberSpecies::Au197;
@@ -154,6 +259,78 @@ TEST(nucleus, woodsSaxon1D) {
               WS->GetParameter(1), 5e-3);
 }
 
+// the sampled radial distribution recorded in the QA histogram (weighted by
+// 1/r^2) should follow the Woods-Saxon density
+TEST(nucleus, woodsSaxon1DRCosTheta) {
+  sct::Nucleus nucleus;
+  sct::GlauberSpecies species = sct::GlauberSpecies::Pb208;
+  nucleus.setParameters(species);
+  nucleus.setRepulsionDistance(0.00);
+  nucleus.setQAMode(sct::NucleusQA::Full);
+
+  for (int i = 0; i < 2 * 1e4; ++i)
+    nucleus.generate();
+
+  TF1 *density = new TF1("density", "[2]/(1.0 + TMath::Exp((x - [0]) / [1]))",
+                         0, 20);
+  density->SetParameter(0, sct::NucleusInfo::instance().radius(species));
+  density->SetParameter(1, sct::NucleusInfo::instance().skinDepth(species));
+  density->SetParameter(2, 1);
+
+  TH1D *r = nucleus.generatedR();
+  r->Fit(density, "Q", "", 1.0, 12.0);
+
+  EXPECT_NEAR(sct::NucleusInfo::instance().radius(species),
+              density->GetParameter(0), 1e-2);
+  EXPECT_NEAR(sct::NucleusInfo::instance().skinDepth(species),
+              density->GetParameter(1), 1e-2);
+
+  // cos(theta) should be uniform
+  TH1D *cos_theta = nucleus.generatedCosTheta();
+  TF1 *flat = new TF1("flat", "[0]", -1, 1);
+  cos_theta->Fit(flat, "Q");
+  EXPECT_LT(flat->GetChisquare() / flat->GetNDF(), 2.0);
+}
+
+TEST(nucleus, QAMode) {
+  sct::Nucleus nucleus;
+  sct::GlauberSpecies species = sct::GlauberSpecies::Au197;
+  nucleus.setParameters(species);
+  unsigned mass_number = sct::NucleusInfo::instance().massNumber(species);
+
+  // nothing is allocated before the first nucleus is generated, or when QA is
+  // turned off
+  EXPECT_EQ(nucleus.QAMode(), sct::NucleusQA::Full);
+  EXPECT_EQ(nucleus.generatedR(), nullptr);
+  nucleus.setQAMode(sct::NucleusQA::Off);
+  for (int i = 0; i < 10; ++i)
+    nucleus.generate();
+  EXPECT_EQ(nucleus.generatedR(), nullptr);
+
+  // sampled QA records one in every N nuclei, without the dense histograms
+  nucleus.setQAMode(sct::NucleusQA::Sampled, 10);
+  for (int i = 0; i < 100; ++i)
+    nucleus.generate();
+  ASSERT_NE(nucleus.generatedCosTheta(), nullptr);
+  EXPECT_EQ(nucleus.generatedCosTheta()->GetEntries(), 10 * mass_number);
+  EXPECT_EQ(nucleus.generatedRCosTheta(), nullptr);
+  EXPECT_EQ(nucleus.generatedPosition(), nullptr);
+
+  // copies start without histograms, and merge into the original
+  sct::Nucleus copy(nucleus);
+  EXPECT_EQ(copy.generatedCosTheta(), nullptr);
+  copy.setQAMode(sct::NucleusQA::Full);
+  for (int i = 0; i < 5; ++i)
+    copy.generate();
+  ASSERT_NE(copy.generatedPosition(), nullptr);
+  EXPECT_EQ(copy.generatedPosition()->GetEntries(), 5 * mass_number);
+
+  nucleus.mergeHistograms(copy);
+  EXPECT_EQ(nucleus.generatedCosTheta()->GetEntries(), 15 * mass_number);
+  ASSERT_NE(nucleus.generatedPosition(), nullptr);
+  EXPECT_EQ(nucleus.generatedPosition()->GetEntries(), 5 * mass_number);
+}
+
 double WoodsSaxonDeformed(double *x, double *par) {
   double r = x[0];
   double costheta = x[1];
@@ -214,3 +391,27 @@ TEST(nucleus, woodsSaxon2D) {
   EXPECT_NEAR(fWSD->GetParameter(3),
               sct::NucleusInfo::instance().beta4(species), 1e-2);
 }
+
+// presampled radii are used by the next nucleus, and bound its nucleons
+TEST(nucleus, presampleRadii) {
+  sct::Nucleus nucleus;
+  nucleus.setParameters(sct::GlauberSpecies::Au197);
+
+  for (int event = 0; event < 100; ++event) {
+    double reach = 0.0;
+    ASSERT_TRUE(nucleus.presampleRadii(reach));
+    nucleus.generate(2.0);
+    double r_max = 0.0;
+    for (int i = 0; i < nucleus.size(); ++i) {
+      double dx = nucleus[i].x() - 2.0;
+      double r = sqrt(dx * dx + nucleus[i].y2() + nucleus[i].z2());
+      r_max = std::max(r_max, r);
+    }
+    EXPECT_NEAR(reach, r_max, 1e-9);
+  }
+
+  // radii can not be drawn in advance with a repulsion distance
+  double reach = 0.0;
+  nucleus.setRepulsionDistance(0.4);
+  EXPECT_FALSE(nucleus.presampleRadii(reach));
+}
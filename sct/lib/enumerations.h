@@ -58,11 +58,30 @@ enum class CollisionEnergy {
 // collision profile can either be a hard core, or gaussian
 enum class CollisionProfile { HardCore, Gaussian };
 
+// method used to find colliding nucleon pairs: either test every pair of
+// nucleons (brute force), or bin nucleus B in a 2D grid with a cell size equal
+// to the nucleon-nucleon interaction distance, and only test nucleons in
+// neighbouring cells (cell list)
+enum class CollisionSearch { BruteForce, CellList };
+
 // positional smearing of nucleons during glauber modeling
 // default is off (pure woods-saxon), can either smear in a hard sphere with a
 // constant probability, or with a 3D gaussian distribution
 enum class NucleonSmearing { None, HardCore, Gaussian };
 
+// QA histograms recorded while generating nuclei: none (off), 1D radial and
+// angular distributions for one in every N nuclei (sampled), or the 1D
+// distributions and the dense 2D/3D position histograms for every nucleus
+// (full)
+enum class NucleusQA { Off, Sampled, Full };
+
+// sampling of the multiplicity model: StGlauber draws one NBD sample per
+// source and one random number per track for the efficiency & trigger bias,
+// as StGlauber does. Fast draws the same distribution with one NBD sample
+// (the sum of n NBD(npp, k) samples follows NBD(n * npp, n * k)) and one
+// binomial sample each for the efficiency & trigger bias
+enum class MultiplicitySampling { StGlauber, Fast };
+
 // For systematics: vary the settings of the glauber model
 enum class GlauberMod {
   Nominal,           // nominal settings
@@ -287,9 +287,11 @@ void GlauberSystematics::runFile(GlauberMod key, shared_ptr<TFile> file) {
     event_dict[GlauberObservable::Multiplicity] = mult;
     event_dict[GlauberObservable::Centrality] = cent;
 
-    // weights
-    double unit_weight = 1.0;
-    double weight = use_unit_weight_ ? 1.0 : reader.multiplicity();
+    // weights - every histogram also carries the event weight from biased
+    // impact parameter sampling, which is one for unbiased samples
+    double unit_weight = reader.weight();
+    double weight =
+        (use_unit_weight_ ? 1.0 : reader.multiplicity()) * reader.weight();
 
     // fill in histograms with unit weight
     impact_parameter_.fillEvent(key, event_dict, unit_weight);
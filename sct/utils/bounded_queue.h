@@ -0,0 +1,98 @@
+#ifndef SCT_UTILS_BOUNDED_QUEUE_H
+#define SCT_UTILS_BOUNDED_QUEUE_H
+
+// a blocking first-in first-out queue with a fixed capacity, to hand work from
+// producer threads to consumer threads with bounded memory. push() blocks
+// while the queue is full, and pop() blocks while it is empty.
+
+// consumers call taskDone() after each item they pop is fully processed, so a
+// producer can wait() until everything it pushed has been handled. close()
+// wakes up all waiting threads: no more items can be pushed, and pop() returns
+// false once the remaining items are drained.
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace sct {
+
+template <typename T> class BoundedQueue {
+public:
+  explicit BoundedQueue(std::size_t capacity)
+      : capacity_(capacity > 0 ? capacity : 1), unfinished_(0),
+        closed_(false) {}
+
+  // adds value to the back of the queue, blocking while the queue is full.
+  // Returns false if the queue is closed
+  bool push(T value) {
+    std::unique_lock<std::mutex> guard(lock_);
+    not_full_.wait(guard,
+                   [&]() { return closed_ || queue_.size() < capacity_; });
+    if (closed_)
+      return false;
+    queue_.push_back(std::move(value));
+    ++unfinished_;
+    guard.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // removes the front of the queue into value, blocking while the queue is
+  // empty. Returns false if the queue is closed and empty
+  bool pop(T &value) {
+    std::unique_lock<std::mutex> guard(lock_);
+    not_empty_.wait(guard, [&]() { return closed_ || !queue_.empty(); });
+    if (queue_.empty())
+      return false;
+    value = std::move(queue_.front());
+    queue_.pop_front();
+    guard.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // marks one popped item as processed
+  void taskDone() {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (unfinished_ > 0 && --unfinished_ == 0)
+      finished_.notify_all();
+  }
+
+  // blocks until every pushed item has been popped and processed
+  void wait() {
+    std::unique_lock<std::mutex> guard(lock_);
+    finished_.wait(guard, [&]() { return unfinished_ == 0; });
+  }
+
+  // refuses any further items, and wakes up all waiting threads
+  void close() {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> guard(lock_);
+    return queue_.size();
+  }
+  inline std::size_t capacity() const { return capacity_; }
+
+private:
+  const std::size_t capacity_;
+  std::size_t unfinished_; // pushed items that are not yet processed
+  bool closed_;
+  std::deque<T> queue_;
+
+  mutable std::mutex lock_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::condition_variable finished_;
+};
+
+} // namespace sct
+
+#endif // SCT_UTILS_BOUNDED_QUEUE_H
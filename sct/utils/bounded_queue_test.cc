@@ -0,0 +1,65 @@
+#include "sct/utils/bounded_queue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(BoundedQueue, order) {
+  sct::BoundedQueue<int> queue(10);
+  for (int i = 0; i < 10; ++i)
+    EXPECT_TRUE(queue.push(i));
+  EXPECT_EQ(queue.size(), 10);
+
+  for (int i = 0; i < 10; ++i) {
+    int value = -1;
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_EQ(queue.size(), 0);
+}
+
+// the queue never holds more than its capacity, and the consumer sees every
+// item in order
+TEST(BoundedQueue, producerConsumer) {
+  sct::BoundedQueue<int> queue(4);
+  int n_items = 10000;
+  std::atomic<bool> overfull(false);
+  std::vector<int> received;
+
+  std::thread consumer([&]() {
+    int value;
+    while (queue.pop(value)) {
+      if (queue.size() > queue.capacity())
+        overfull = true;
+      received.push_back(value);
+      queue.taskDone();
+    }
+  });
+
+  for (int i = 0; i < n_items; ++i)
+    queue.push(i);
+  queue.wait();
+  EXPECT_EQ(received.size(), n_items);
+
+  queue.close();
+  consumer.join();
+
+  EXPECT_FALSE(overfull);
+  for (int i = 0; i < n_items; ++i)
+    EXPECT_EQ(received[i], i);
+}
+
+TEST(BoundedQueue, close) {
+  sct::BoundedQueue<int> queue(2);
+  queue.push(1);
+  queue.close();
+  EXPECT_FALSE(queue.push(2));
+
+  // remaining items are still drained after closing
+  int value = 0;
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(value, 1);
+  EXPECT_FALSE(queue.pop(value));
+}
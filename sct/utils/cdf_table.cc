@@ -0,0 +1,141 @@
+#include "sct/utils/cdf_table.h"
+
+#include "sct/lib/assert.h"
+#include "sct/lib/string/string_utils.h"
+#include "sct/utils/random.h"
+
+#include <algorithm>
+
+namespace sct {
+
+namespace {
+// number of function evaluations per bin used to integrate each bin, so that
+// discontinuous functions (step functions) are integrated accurately
+constexpr unsigned samples_per_bin = 8;
+}  // namespace
+
+CDFTable::CDFTable(std::function<double(double)> f, double x_min,
+                   double x_max, unsigned n_bins) {
+  SCT_ASSERT(x_max > x_min, "CDFTable requires x_max > x_min");
+  SCT_ASSERT(n_bins > 0, "CDFTable requires at least one bin");
+
+  // find the region where f is non-zero, at the resolution of the integration
+  unsigned n_scan = n_bins * samples_per_bin;
+  double scan_width = (x_max - x_min) / n_scan;
+  int first = -1;
+  int last = -1;
+  for (unsigned i = 0; i < n_scan; ++i) {
+    double val = f(x_min + (i + 0.5) * scan_width);
+    SCT_ASSERT(val >= 0.0, "CDFTable requires a non-negative function");
+    if (val > 0.0) {
+      if (first < 0)
+        first = i;
+      last = i;
+    }
+  }
+  SCT_ASSERT(first >= 0, "CDFTable requires a function with non-zero integral");
+
+  // shrink the range to the non-zero region, keeping one scan step of margin
+  // on each side, so the edges of the support are resolved
+  x_min_ = x_min + std::max(first - 1, 0) * scan_width;
+  double upper =
+      x_min + std::min<unsigned>(last + 2, n_scan) * scan_width;
+  bin_width_ = (upper - x_min_) / n_bins;
+
+  // integrate each bin with the midpoint rule
+  double sub_width = bin_width_ / samples_per_bin;
+  std::vector<double> weights(n_bins, 0.0);
+  for (unsigned i = 0; i < n_bins; ++i) {
+    double bin_low = x_min_ + i * bin_width_;
+    for (unsigned j = 0; j < samples_per_bin; ++j)
+      weights[i] += f(bin_low + (j + 0.5) * sub_width);
+    weights[i] *= sub_width;
+  }
+  build(weights);
+}
+
+CDFTable::CDFTable(const std::vector<double> &weights, double x_min,
+                   double x_max)
+    : x_min_(x_min) {
+  SCT_ASSERT(x_max > x_min, "CDFTable requires x_max > x_min");
+  SCT_ASSERT(weights.size() > 0, "CDFTable requires at least one bin");
+  for (auto &weight : weights)
+    SCT_ASSERT(weight >= 0.0, "CDFTable requires non-negative weights");
+  bin_width_ = (x_max - x_min) / weights.size();
+  build(weights);
+}
+
+void CDFTable::build(const std::vector<double> &weights) {
+  unsigned n_bins = weights.size();
+  cdf_.assign(n_bins + 1, 0.0);
+  for (unsigned i = 0; i < n_bins; ++i)
+    cdf_[i + 1] = cdf_[i] + weights[i];
+  SCT_ASSERT(cdf_[n_bins] > 0.0,
+             "CDFTable requires a function with non-zero integral");
+
+  // normalize
+  integral_ = cdf_[n_bins];
+  double norm = cdf_[n_bins];
+  for (auto &val : cdf_)
+    val /= norm;
+  cdf_[n_bins] = 1.0;
+
+  // build the guide table
+  guide_.resize(n_bins);
+  unsigned bin = 0;
+  for (unsigned k = 0; k < n_bins; ++k) {
+    double u = static_cast<double>(k) / n_bins;
+    while (bin < n_bins - 1 && cdf_[bin + 1] < u)
+      ++bin;
+    guide_[k] = bin;
+  }
+}
+
+double CDFTable::sample() const { return sample(Random::instance().uniform()); }
+
+double CDFTable::sample(double u) const {
+  unsigned n_bins = bins();
+  u = std::min(std::max(u, 0.0), 1.0);
+
+  // start from the guide table, and step forward to the first non-empty bin
+  // with cdf_[bin + 1] >= u
+  unsigned bin = guide_[std::min<unsigned>(u * n_bins, n_bins - 1)];
+  while (bin < n_bins - 1 &&
+         (cdf_[bin + 1] < u || cdf_[bin + 1] == cdf_[bin]))
+    ++bin;
+
+  // linear interpolation of the CDF within the bin
+  double width = cdf_[bin + 1] - cdf_[bin];
+  double frac = width > 0.0 ? (u - cdf_[bin]) / width : 0.0;
+  return x_min_ + (bin + frac) * bin_width_;
+}
+
+CDFTable2D::CDFTable2D(std::function<double(double, double)> f, double x_min,
+                       double x_max, double y_min, double y_max,
+                       unsigned n_x_bins, unsigned n_y_slices)
+    : y_min_(y_min) {
+  SCT_ASSERT(y_max > y_min, "CDFTable2D requires y_max > y_min");
+  SCT_ASSERT(n_y_slices > 0, "CDFTable2D requires at least one slice");
+
+  // tabulate f(x | y) at the center of each slice in y, and use the integral
+  // of each slice as the marginal distribution in y
+  slice_width_ = (y_max - y_min) / n_y_slices;
+  std::vector<double> slice_weights(n_y_slices);
+  conditional_.reserve(n_y_slices);
+  for (unsigned j = 0; j < n_y_slices; ++j) {
+    double y = y_min + (j + 0.5) * slice_width_;
+    conditional_.emplace_back([&f, y](double x) { return f(x, y); }, x_min,
+                              x_max, n_x_bins);
+    slice_weights[j] = conditional_.back().integral() * slice_width_;
+  }
+  marginal_ = make_unique<CDFTable>(slice_weights, y_min, y_max);
+}
+
+void CDFTable2D::sample(double &x, double &y) const {
+  y = marginal_->sample();
+  int slice = static_cast<int>((y - y_min_) / slice_width_);
+  slice = std::min<int>(std::max(slice, 0), conditional_.size() - 1);
+  x = conditional_[slice].sample();
+}
+
+}  // namespace sct
@@ -0,0 +1,91 @@
+#ifndef SCT_UTILS_CDF_TABLE_H
+#define SCT_UTILS_CDF_TABLE_H
+
+// samples a one dimensional distribution by inverting a tabulated cumulative
+// distribution function. The function is integrated once on construction, in
+// n_bins equal bins, and the CDF is interpolated linearly within each bin. A
+// guide table maps each random number to its starting bin, so sampling is
+// O(1) on average, with no calls back into the function.
+
+// if the function is only non-zero in a small part of [x_min, x_max] (for
+// instance, the narrow step function used for protons), the table is built
+// only over that region, so the resolution isn't wasted on empty bins.
+
+// the table is immutable after construction, and sampling only uses the
+// thread_local sct::Random, so a single table can be shared read-only between
+// threads.
+
+#include "sct/lib/memory.h"
+
+#include <functional>
+#include <vector>
+
+namespace sct {
+
+class CDFTable {
+public:
+  // tabulates f on [x_min, x_max] - f must be non-negative, with a non-zero
+  // integral in the range
+  CDFTable(std::function<double(double)> f, double x_min, double x_max,
+           unsigned n_bins = 4096);
+
+  // builds the table from the integrals of f in equal bins spanning
+  // [x_min, x_max] - f is taken to be constant within each bin
+  CDFTable(const std::vector<double> &weights, double x_min, double x_max);
+
+  // draws a random number from the tabulated distribution
+  double sample() const;
+
+  // returns the inverse of the tabulated CDF at u, for u in [0, 1]
+  double sample(double u) const;
+
+  // range covered by the table - may be smaller than the requested range
+  inline double xMin() const { return x_min_; }
+  inline double xMax() const { return x_min_ + bin_width_ * bins(); }
+  inline unsigned bins() const { return cdf_.size() - 1; }
+
+  // integral of the tabulated function over the range
+  inline double integral() const { return integral_; }
+
+private:
+  // builds the normalized CDF & guide table from the integral of each bin
+  void build(const std::vector<double> &weights);
+
+  double x_min_;
+  double integral_;
+  double bin_width_;
+
+  // cdf_[i] is the integral from x_min_ to the lower edge of bin i, normalized
+  // to one - cdf_ has n_bins + 1 entries
+  std::vector<double> cdf_;
+
+  // guide_[k] is the first bin that contains CDF values >= k / n_bins
+  std::vector<unsigned> guide_;
+};
+
+// samples a two dimensional distribution f(x, y). The marginal distribution in
+// y is tabulated in n_y_slices slices, and for each slice, the conditional
+// distribution f(x | y) is tabulated at the center of the slice. A sample draws
+// y from the marginal table, then x from the conditional table of that slice.
+// Like CDFTable, it is immutable and can be shared read-only between threads.
+class CDFTable2D {
+public:
+  CDFTable2D(std::function<double(double, double)> f, double x_min,
+             double x_max, double y_min, double y_max, unsigned n_x_bins = 512,
+             unsigned n_y_slices = 200);
+
+  // draws a random (x, y) pair from the tabulated distribution
+  void sample(double &x, double &y) const;
+
+  inline unsigned slices() const { return conditional_.size(); }
+
+private:
+  double y_min_;
+  double slice_width_;
+  unique_ptr<CDFTable> marginal_;
+  std::vector<CDFTable> conditional_;
+};
+
+}  // namespace sct
+
+#endif  // SCT_UTILS_CDF_TABLE_H
@@ -0,0 +1,92 @@
+#include "sct/utils/cdf_table.h"
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+// the inverse CDF of f(x) = x on [0, 1] is sqrt(u)
+TEST(CDFTable, linearInverse) {
+  sct::CDFTable table([](double x) { return x; }, 0.0, 1.0, 1000);
+
+  EXPECT_NEAR(table.xMin(), 0.0, 1e-12);
+  EXPECT_NEAR(table.xMax(), 1.0, 1e-12);
+  EXPECT_EQ(table.sample(0.0), 0.0);
+  EXPECT_NEAR(table.sample(1.0), 1.0, 1e-12);
+  for (int i = 1; i < 1000; ++i) {
+    double u = i / 1000.0;
+    EXPECT_NEAR(table.sample(u), std::sqrt(u), 1e-3);
+  }
+}
+
+// samples should reproduce the mean and variance of f(x) = x on [0, 1]
+TEST(CDFTable, linearMoments) {
+  sct::CDFTable table([](double x) { return x; }, 0.0, 1.0);
+
+  const int n = 1e6;
+  double sum = 0.0;
+  double sum2 = 0.0;
+  for (int i = 0; i < n; ++i) {
+    double x = table.sample();
+    EXPECT_GE(x, 0.0);
+    EXPECT_LE(x, 1.0);
+    sum += x;
+    sum2 += x * x;
+  }
+  double mean = sum / n;
+  double variance = sum2 / n - mean * mean;
+  EXPECT_NEAR(mean, 2.0 / 3.0, 2e-3);
+  EXPECT_NEAR(variance, 1.0 / 18.0, 1e-3);
+}
+
+// a narrow step function should be tabulated over its support only
+TEST(CDFTable, narrowStepFunction) {
+  double d = 1e-3;
+  sct::CDFTable table([d](double x) { return x < d ? 1.0 / d : 0.0; }, 0.0,
+                      20.0);
+
+  EXPECT_LT(table.xMax(), 2.0 * d);
+  for (int i = 0; i <= 100; ++i) {
+    double u = i / 100.0;
+    EXPECT_NEAR(table.sample(u), u * d, 1e-2 * d);
+  }
+}
+
+// zero-weight regions in the middle of the range should never be sampled
+TEST(CDFTable, gap) {
+  sct::CDFTable table(
+      [](double x) { return (x < 1.0 || x > 2.0) ? 1.0 : 0.0; }, 0.0, 3.0,
+      300);
+
+  for (int i = 0; i <= 1000; ++i) {
+    double x = table.sample(i / 1000.0);
+    EXPECT_FALSE(x > 1.0 + 1e-9 && x < 2.0 - 1e-9) << x;
+  }
+  EXPECT_NEAR(table.sample(0.25), 0.5, 1e-9);
+  EXPECT_NEAR(table.sample(0.75), 2.5, 1e-9);
+}
+
+// f(x, y) = x (1 + y) on [0, 1] x [0, 1]: x and y are independent, with
+// <x> = 2/3 and <y> = 5/9
+TEST(CDFTable2D, moments) {
+  sct::CDFTable2D table([](double x, double y) { return x * (1.0 + y); }, 0.0,
+                        1.0, 0.0, 1.0);
+
+  int n = 1e6;
+  double sum_x = 0.0;
+  double sum_y = 0.0;
+  double sum_xy = 0.0;
+  for (int i = 0; i < n; ++i) {
+    double x, y;
+    table.sample(x, y);
+    EXPECT_GE(x, 0.0);
+    EXPECT_LE(x, 1.0);
+    EXPECT_GE(y, 0.0);
+    EXPECT_LE(y, 1.0);
+    sum_x += x;
+    sum_y += y;
+    sum_xy += x * y;
+  }
+  EXPECT_NEAR(sum_x / n, 2.0 / 3.0, 2e-3);
+  EXPECT_NEAR(sum_y / n, 5.0 / 9.0, 2e-3);
+  EXPECT_NEAR(sum_xy / n, 10.0 / 27.0, 2e-3);
+}
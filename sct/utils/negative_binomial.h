@@ -4,6 +4,7 @@
 // implement histogram for NBD distribution
 
 #include "sct/lib/memory.h"
+#include "sct/utils/random.h"
 
 #include "TH1D.h"
 
@@ -18,8 +19,18 @@ class NegativeBinomial {
   // returns convolution with NBD
   double multiplicity(double npart, double ncoll) const;
 
-  // randomly sample from the NBD
-  unsigned random() const { return static_cast<unsigned>(nbd_->GetRandom()); }
+  // randomly sample from the NBD - sampled directly (see
+  // Random::negativeBinomial), not from distribution(), so it is not
+  // truncated
+  unsigned random() const {
+    return Random::instance().negativeBinomial(npp_, k_);
+  }
+
+  // randomly sample from NBD(npp*m, k*m), the distribution of the sum of m
+  // samples of the NBD
+  unsigned random(double m) const {
+    return Random::instance().negativeBinomial(npp_ * m, k_ * m);
+  }
 
   // evaluate NBD(npp*m, k*m; n)
   double evaluateNBD(int i, double m = 1.0) const;
@@ -28,6 +39,7 @@ class NegativeBinomial {
 
   inline double npp() const { return npp_; }
   inline double k() const { return k_; }
+  // the NBD tabulated for n in [0, 100)
   TH1D* distribution() const { return nbd_.get(); }
 
  private:
@@ -1,6 +1,7 @@
 #include "sct/utils/negative_binomial.h"
 #include "sct/lib/logging.h"
 
+#include <cmath>
 #include <memory>
 #include <random>
 
@@ -36,8 +37,29 @@ TEST(nbd, test_nbd_dist) {
 TEST(nbd, test_mean) {
   sct::NegativeBinomial nbd;
   TH1D* tmp = new TH1D("h", "h", 100, 0, 100);
-  for (int i = 0; i < 2e6; ++i) {
+  int n = 2e6;
+  for (int i = 0; i < n; ++i) {
     tmp->Fill((int)nbd.random());
   }
-  EXPECT_NEAR(nbd.npp(), tmp->GetMean(), 1e-3);
+  double variance = nbd.npp() + nbd.npp() * nbd.npp() / nbd.k();
+  EXPECT_NEAR(nbd.npp(), tmp->GetMean(), 5.0 * sqrt(variance / n));
+}
+
+// the sampled distribution is not truncated: its mean & variance match the
+// NBD for means far beyond the tabulated range
+TEST(nbd, test_large_mean) {
+  sct::NegativeBinomial nbd(2.38, 2.0);
+  double m = 300;
+  int n = 2e5;
+  double sum = 0.0;
+  double sum2 = 0.0;
+  for (int i = 0; i < n; ++i) {
+    double value = nbd.random(m);
+    sum += value;
+    sum2 += value * value;
+  }
+  double mean = nbd.npp() * m;
+  double variance = mean + mean * mean / (nbd.k() * m);
+  EXPECT_NEAR(sum / n, mean, 5.0 * sqrt(variance / n));
+  EXPECT_NEAR(sum2 / n - (sum / n) * (sum / n), variance, 0.02 * variance);
 }
@@ -0,0 +1,74 @@
+#include "sct/utils/philox.h"
+
+namespace sct {
+
+namespace {
+// multipliers and Weyl sequence constants for Philox4x32
+constexpr std::uint32_t philox_m0 = 0xD2511F53;
+constexpr std::uint32_t philox_m1 = 0xCD9E8D57;
+constexpr std::uint32_t philox_w0 = 0x9E3779B9;
+constexpr std::uint32_t philox_w1 = 0xBB67AE85;
+constexpr unsigned philox_rounds = 10;
+
+inline void mulhilo(std::uint32_t a, std::uint32_t b, std::uint32_t &hi,
+                    std::uint32_t &lo) {
+  std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+  hi = static_cast<std::uint32_t>(product >> 32);
+  lo = static_cast<std::uint32_t>(product);
+}
+} // namespace
+
+Philox4x32::Philox4x32(std::uint32_t seed, std::uint64_t stream) {
+  this->seed(seed, stream);
+}
+
+void Philox4x32::seed(std::uint32_t seed, std::uint64_t stream) {
+  key_ = {seed, static_cast<std::uint32_t>(stream >> 32)};
+  counter_ = {0, 0, 0, static_cast<std::uint32_t>(stream)};
+  index_ = 4;
+}
+
+void Philox4x32::setEvent(std::uint64_t event) {
+  counter_[0] = 0;
+  counter_[1] = static_cast<std::uint32_t>(event);
+  counter_[2] = static_cast<std::uint32_t>(event >> 32);
+  index_ = 4;
+}
+
+void Philox4x32::discard(std::uint64_t n) {
+  // position of the next output within the event - the block in output_ was
+  // generated from counter_[0] - 1
+  std::uint64_t position =
+      static_cast<std::uint64_t>(counter_[0]) * 4 - (4 - index_) + n;
+  position &= (std::uint64_t(1) << 34) - 1;
+
+  counter_[0] = static_cast<std::uint32_t>(position / 4);
+  index_ = 4;
+  if (position % 4 != 0) {
+    nextBlock();
+    index_ = position % 4;
+  }
+}
+
+Philox4x32::counter_type Philox4x32::block(counter_type counter,
+                                           key_type key) {
+  for (unsigned round = 0; round < philox_rounds; ++round) {
+    if (round > 0) {
+      key[0] += philox_w0;
+      key[1] += philox_w1;
+    }
+    std::uint32_t hi0, lo0, hi1, lo1;
+    mulhilo(philox_m0, counter[0], hi0, lo0);
+    mulhilo(philox_m1, counter[2], hi1, lo1);
+    counter = {hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0};
+  }
+  return counter;
+}
+
+void Philox4x32::nextBlock() {
+  output_ = block(counter_, key_);
+  ++counter_[0];
+  index_ = 0;
+}
+
+} // namespace sct
@@ -0,0 +1,66 @@
+#ifndef SCT_UTILS_PHILOX_H
+#define SCT_UTILS_PHILOX_H
+
+// Philox4x32-10 counter-based random number engine (Salmon et al., "Parallel
+// random numbers: as easy as 1, 2, 3", SC11). Each output block is a keyed
+// bijection of a 128 bit counter, so any position in the sequence can be
+// reached in O(1), and distinct keys or counters give independent streams
+// without any shared state.
+
+// the key holds the seed and the upper 32 bits of the stream ID, and the
+// counter holds the lower 32 bits of the stream ID, a 64 bit event index and a
+// 32 bit block index within the event. So a (seed, stream, event) triple
+// defines a sequence of 2^34 numbers, independent of what was drawn before.
+
+// satisfies the UniformRandomBitGenerator requirements, so it can be used with
+// the std:: distributions.
+
+#include <array>
+#include <cstdint>
+
+namespace sct {
+
+class Philox4x32 {
+public:
+  typedef std::uint32_t result_type;
+  typedef std::array<std::uint32_t, 4> counter_type;
+  typedef std::array<std::uint32_t, 2> key_type;
+
+  explicit Philox4x32(std::uint32_t seed = 0, std::uint64_t stream = 0);
+
+  // sets the seed and stream, and moves to the start of event 0
+  void seed(std::uint32_t seed, std::uint64_t stream = 0);
+
+  // moves to the start of the sequence for event, in the current stream
+  void setEvent(std::uint64_t event);
+
+  // advances the engine by n outputs in O(1) - wraps around within the
+  // current event after 2^34 outputs
+  void discard(std::uint64_t n);
+
+  inline result_type operator()() {
+    if (index_ == 4)
+      nextBlock();
+    return output_[index_++];
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xffffffff; }
+
+  // the Philox4x32-10 bijection - exposed for testing
+  static counter_type block(counter_type counter, key_type key);
+
+private:
+  // generates the output for the current counter, and increments the block
+  // index
+  void nextBlock();
+
+  key_type key_;
+  counter_type counter_; // {block, event low, event high, stream low}
+  counter_type output_;  // output of the last generated block
+  unsigned index_;       // next element of output_, 4 if exhausted
+};
+
+} // namespace sct
+
+#endif // SCT_UTILS_PHILOX_H
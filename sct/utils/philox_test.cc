@@ -0,0 +1,93 @@
+#include "sct/utils/philox.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// known answer tests from the Random123 distribution (kat_vectors)
+TEST(Philox4x32, knownAnswers) {
+  typedef sct::Philox4x32::counter_type counter;
+  typedef sct::Philox4x32::key_type key;
+
+  counter zero = sct::Philox4x32::block({0, 0, 0, 0}, {0, 0});
+  EXPECT_EQ(zero, (counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+
+  counter ones = sct::Philox4x32::block(
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+      {0xffffffff, 0xffffffff});
+  EXPECT_EQ(ones, (counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+
+  counter pi = sct::Philox4x32::block(
+      {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+      key{0xa4093822, 0x299f31d0});
+  EXPECT_EQ(pi, (counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+// discard(n) must land at the same position as n calls to operator()
+TEST(Philox4x32, discard) {
+  for (unsigned offset = 0; offset < 6; ++offset) {
+    for (unsigned n = 0; n < 20; ++n) {
+      sct::Philox4x32 stepped(12345, 3);
+      sct::Philox4x32 skipped(12345, 3);
+      for (unsigned i = 0; i < offset; ++i) {
+        stepped();
+        skipped();
+      }
+      for (unsigned i = 0; i < n; ++i)
+        stepped();
+      skipped.discard(n);
+      for (unsigned i = 0; i < 8; ++i)
+        EXPECT_EQ(stepped(), skipped()) << offset << " " << n;
+    }
+  }
+
+  // large skips are O(1), and consistent with smaller skips
+  sct::Philox4x32 a(1, 1);
+  sct::Philox4x32 b(1, 1);
+  a.discard(1000000007);
+  b.discard(1000000000);
+  b.discard(7);
+  EXPECT_EQ(a(), b());
+}
+
+// a (seed, stream, event) triple defines the sequence, independent of what
+// was drawn before
+TEST(Philox4x32, events) {
+  sct::Philox4x32 engine(42, 7);
+  engine.setEvent(100);
+  std::vector<unsigned> first;
+  for (int i = 0; i < 10; ++i)
+    first.push_back(engine());
+
+  sct::Philox4x32 other(42, 7);
+  for (int i = 0; i < 1000; ++i)
+    other();
+  other.setEvent(99);
+  EXPECT_NE(first[0], other());
+  other.setEvent(100);
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(first[i], other());
+
+  sct::Philox4x32 stream(42, 8);
+  stream.setEvent(100);
+  EXPECT_NE(first[0], stream());
+  sct::Philox4x32 seed(43, 7);
+  seed.setEvent(100);
+  EXPECT_NE(first[0], seed());
+}
+
+TEST(Philox4x32, uniform) {
+  sct::Philox4x32 engine(2018);
+  std::uniform_real_distribution<> uniform(0.0, 1.0);
+  unsigned n = 1e6;
+  double sum = 0.0;
+  double sum2 = 0.0;
+  for (unsigned i = 0; i < n; ++i) {
+    double x = uniform(engine);
+    sum += x;
+    sum2 += x * x;
+  }
+  EXPECT_NEAR(sum / n, 0.5, 1e-3);
+  EXPECT_NEAR(sum2 / n - (sum / n) * (sum / n), 1.0 / 12.0, 1e-3);
+}
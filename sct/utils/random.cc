@@ -2,8 +2,21 @@
 
 #include "sct/lib/math.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace sct {
 
+namespace {
+// number of values transformed at once by the batch functions
+constexpr unsigned batch_block = 256;
+
+// 53 bit double in [0, 1) from two 32 bit integers
+inline double unitDouble(std::uint32_t a, std::uint32_t b) {
+  return ((a >> 5) * 67108864.0 + (b >> 6)) * (1.0 / 9007199254740992.0);
+}
+} // namespace
+
 Counter::Counter() : counter_(0) {}
 
 Counter::~Counter() {}
@@ -14,14 +27,12 @@ Counter &Counter::instance() {
 }
 
 Random::Random()
-    : unit_uniform_(0.0, 1.0), two_unit_uniform_(0.0, 2.0),
-      two_unit_centered_uniform_(-1.0, 1.0), zero_to_pi_(0.0, pi) {
-  std::vector<double> x = {0.0, 1.0};
-  std::vector<double> w = {0.0, 1.0};
-  unit_linear_ =
-      std::piecewise_linear_distribution<>(x.begin(), x.end(), w.begin());
-
-  generator_.seed(54854);
+    : engine_(RandomEngine::MT19937), seed_(54854), stream_(0),
+      unit_uniform_(0.0, 1.0), two_unit_uniform_(0.0, 2.0),
+      two_unit_centered_uniform_(-1.0, 1.0), zero_to_pi_(0.0, pi),
+      bits_(2 * batch_block), scratch_(2 * batch_block) {
+  generator_.seed(seed_);
+  philox_.seed(seed_);
 }
 
 Random &Random::instance() {
@@ -32,36 +43,211 @@ Random &Random::instance() {
 Random::~Random() {}
 
 double Random::uniform() {
-  double ret = unit_uniform_(generator_);
+  double ret = draw(unit_uniform_);
   return ret;
 }
 
 double Random::uniform2() {
-  double ret = two_unit_uniform_(generator_);
+  double ret = draw(two_unit_uniform_);
   return ret;
 }
 
 double Random::centeredUniform() {
-  double ret = two_unit_centered_uniform_(generator_);
+  double ret = draw(two_unit_centered_uniform_);
   return ret;
 }
 
 double Random::zeroToPi() {
-  double ret = zero_to_pi_(generator_);
+  double ret = draw(zero_to_pi_);
   return ret;
 }
 
 double Random::linear() {
-  double ret = unit_linear_(generator_);
+  double ret = std::sqrt(draw(unit_uniform_));
   return ret;
 }
 
+double Random::gamma(double shape, double scale) {
+  typedef std::gamma_distribution<>::param_type param_type;
+  if (engine_ == RandomEngine::Philox)
+    return gamma_(philox_, param_type(shape, scale));
+  return gamma_(generator_, param_type(shape, scale));
+}
+
+unsigned Random::poisson(double mean) {
+  typedef std::poisson_distribution<unsigned>::param_type param_type;
+  if (mean <= 0.0)
+    return 0;
+  if (engine_ == RandomEngine::Philox)
+    return poisson_(philox_, param_type(mean));
+  return poisson_(generator_, param_type(mean));
+}
+
+unsigned Random::negativeBinomial(double mean, double k) {
+  if (mean <= 0.0)
+    return 0;
+  if (k <= 0.0)
+    return poisson(mean);
+  return poisson(gamma(k, mean / k));
+}
+
+unsigned Random::binomial(unsigned n, double p) {
+  typedef std::binomial_distribution<unsigned>::param_type param_type;
+  if (n == 0 || p <= 0.0)
+    return 0;
+  if (p >= 1.0)
+    return n;
+  if (engine_ == RandomEngine::Philox)
+    return binomial_(philox_, param_type(n, p));
+  return binomial_(generator_, param_type(n, p));
+}
+
+void Random::uniform(double *out, unsigned n) {
+  for (unsigned begin = 0; begin < n; begin += batch_block) {
+    unsigned count = std::min(batch_block, n - begin);
+    fillBits(bits_.data(), 2 * count);
+    const std::uint32_t *high = bits_.data();
+    const std::uint32_t *low = bits_.data() + count;
+    double *dst = out + begin;
+    for (unsigned i = 0; i < count; ++i)
+      dst[i] = unitDouble(high[i], low[i]);
+  }
+}
+
+void Random::isotropic(double *cos_theta, double *phi, unsigned n) {
+  uniform(cos_theta, n);
+  uniform(phi, n);
+  for (unsigned i = 0; i < n; ++i) {
+    cos_theta[i] = 2.0 * cos_theta[i] - 1.0;
+    phi[i] = 2.0 * pi * phi[i] - pi;
+  }
+}
+
+void Random::impactParameter(double *b, unsigned n, double b_min,
+                             double b_max) {
+  // inverse of the CDF of p(b) ~ b
+  double b_min2 = b_min * b_min;
+  double range2 = b_max * b_max - b_min2;
+  uniform(b, n);
+  for (unsigned i = 0; i < n; ++i)
+    b[i] = std::sqrt(b_min2 + b[i] * range2);
+}
+
+void Random::normal(double *out, unsigned n, double mean, double sigma) {
+  // each pair of uniform numbers gives two normal numbers, the first is
+  // stored in the lower half of the block, the second in the upper half
+  for (unsigned begin = 0; begin < n; begin += batch_block) {
+    unsigned count = std::min(batch_block, n - begin);
+    unsigned pairs = (count + 1) / 2;
+    double *u1 = scratch_.data();
+    double *u2 = scratch_.data() + pairs;
+    uniform(scratch_.data(), 2 * pairs);
+    double *dst = out + begin;
+    for (unsigned i = 0; i < pairs; ++i) {
+      double r = sigma * std::sqrt(-2.0 * std::log(1.0 - u1[i]));
+      double angle = 2.0 * pi * u2[i];
+      u1[i] = r * std::cos(angle);
+      u2[i] = r * std::sin(angle);
+    }
+    for (unsigned i = 0; i < pairs; ++i)
+      dst[i] = mean + u1[i];
+    for (unsigned i = pairs; i < count; ++i)
+      dst[i] = mean + u2[i - pairs];
+  }
+}
+
+void Random::uniformBall(double *x, double *y, double *z, unsigned n,
+                         double radius) {
+  // the radius is drawn with p(r) ~ r^2 by inversion, so no points are
+  // rejected - x & y hold u and the direction until they are transformed
+  uniform(x, n);
+  isotropic(y, z, n);
+  for (unsigned i = 0; i < n; ++i) {
+    double r = radius * std::cbrt(x[i]);
+    double cos_theta = y[i];
+    double r_sin_theta = r * std::sqrt(1.0 - cos_theta * cos_theta);
+    x[i] = r_sin_theta * std::cos(z[i]);
+    y[i] = r_sin_theta * std::sin(z[i]);
+    z[i] = r * cos_theta;
+  }
+}
+
+unsigned Random::uniformInt() {
+  if (engine_ == RandomEngine::Philox)
+    return philox_();
+  return generator_();
+}
+
 void Random::seed(int seed) {
   if (seed < 0) {
     std::random_device rd;
-    generator_.seed(rd());
+    seed_ = rd();
+  } else {
+    seed_ = seed;
+  }
+  stream_ = 0;
+  generator_.seed(seed_);
+  philox_.seed(seed_);
+  resetDistributions();
+}
+
+void Random::seed(unsigned seed, unsigned long long stream) {
+  seed_ = seed;
+  stream_ = stream;
+  std::seed_seq sequence{seed, static_cast<unsigned>(stream & 0xffffffff),
+                         static_cast<unsigned>(stream >> 32)};
+  generator_.seed(sequence);
+  philox_.seed(seed, stream);
+
+  // drop any state cached by the distributions from the previous stream
+  resetDistributions();
+}
+
+void Random::setEvent(unsigned long long event) {
+  if (engine_ == RandomEngine::Philox) {
+    philox_.setEvent(event);
   } else {
-    generator_.seed(seed);
+    std::seed_seq sequence{seed_, static_cast<unsigned>(stream_ & 0xffffffff),
+                           static_cast<unsigned>(stream_ >> 32),
+                           static_cast<unsigned>(event & 0xffffffff),
+                           static_cast<unsigned>(event >> 32)};
+    generator_.seed(sequence);
   }
+  resetDistributions();
 }
+
+void Random::setEngine(RandomEngine engine) {
+  engine_ = engine;
+  resetDistributions();
+}
+
+void Random::resetDistributions() {
+  unit_uniform_.reset();
+  two_unit_uniform_.reset();
+  two_unit_centered_uniform_.reset();
+  zero_to_pi_.reset();
+  gamma_.reset();
+  poisson_.reset();
+  binomial_.reset();
+}
+
+void Random::fillBits(std::uint32_t *out, unsigned n) {
+  if (engine_ == RandomEngine::Philox) {
+    for (unsigned i = 0; i < n; ++i)
+      out[i] = philox_();
+  } else {
+    for (unsigned i = 0; i < n; ++i)
+      out[i] = generator_();
+  }
+}
+
+ScopedRandomStream::ScopedRandomStream(RandomEngine engine, unsigned seed,
+                                       unsigned long long stream)
+    : saved_(Random::instance()) {
+  Random::instance().setEngine(engine);
+  Random::instance().seed(seed, stream);
+}
+
+ScopedRandomStream::~ScopedRandomStream() { Random::instance() = saved_; }
+
 } // namespace sct
@@ -11,12 +11,31 @@
 // the random number generator is thread_local, so each thread should set its
 // own globally unique seed, or let a random seed be used
 
+// two engines are available: std::mt19937 (the default), and the
+// counter-based Philox4x32 (see philox.h). With Philox, seed(seed, stream)
+// and setEvent(event) position the engine in O(1), so a (seed, stream, event)
+// triple fully defines the random sequence of an event, independent of which
+// thread generates it, or what was generated before
+
+// the batch functions fill caller-provided arrays. They draw the raw engine
+// output for a block of values at once, and transform it in plain scalar loops
+// - the gain over single draws comes from the block-wise engine calls, not
+// from SIMD, since the log/cos/sqrt transforms are not vectorized without
+// -ffast-math. They do not give the same values as the equivalent number of
+// single draws
+
+#include "sct/utils/philox.h"
+
 #include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <random>
+#include <vector>
 
 namespace sct {
 
+enum class RandomEngine { MT19937, Philox };
+
 class Counter {
 public:
   static Counter &instance();
@@ -54,22 +73,122 @@ public:
   // proportional to x
   double linear();
 
+  // samples a gamma distribution with the given shape & scale
+  double gamma(double shape, double scale = 1.0);
+
+  // samples a poisson distribution with the given mean. Returns 0 if the mean
+  // is not positive
+  unsigned poisson(double mean);
+
+  // samples a negative binomial distribution with the given mean & shape k
+  // (variance mean + mean^2 / k), as a poisson distribution with a gamma
+  // distributed mean. Exact for any mean & positive k, without truncation. A
+  // k that is not positive is treated as the k -> infinity (poisson) limit
+  unsigned negativeBinomial(double mean, double k);
+
+  // samples the number of successes in n trials with probability p each -
+  // p is clamped to [0, 1]
+  unsigned binomial(unsigned n, double p);
+
+  // batch versions: fill out[0, n)
+  // samples [0, 1) uniformly
+  void uniform(double *out, unsigned n);
+
+  // samples isotropic directions: cos(theta) in [-1, 1), phi in [-pi, pi)
+  void isotropic(double *cos_theta, double *phi, unsigned n);
+
+  // samples impact parameters in [b_min, b_max) with probability proportional
+  // to b
+  void impactParameter(double *b, unsigned n, double b_min, double b_max);
+
+  // samples a normal distribution, using the Box-Muller transform
+  void normal(double *out, unsigned n, double mean = 0.0, double sigma = 1.0);
+
+  // samples points uniformly inside a sphere of the given radius, centered at
+  // the origin
+  void uniformBall(double *x, double *y, double *z, unsigned n,
+                   double radius);
+
+  // samples a 32 bit unsigned integer uniformly - useful for deriving seeds
+  unsigned uniformInt();
+
   // reset the seed for the random number engine - a value less than zero will
   // make a call to std::random_device, for a random seed.
   void seed(int seed = -1);
 
+  // seeds the engine with an independent stream derived from (seed, stream).
+  // Used to give every chunk of events in a parallel job its own reproducible
+  // random sequence, independent of which thread generates it
+  void seed(unsigned seed, unsigned long long stream);
+
+  // moves to the start of the sequence for event, within the (seed, stream)
+  // set by the last call to seed(). This is O(1) for Philox - the MT19937
+  // engine is reseeded from (seed, stream, event) instead, which is much
+  // slower
+  void setEvent(unsigned long long event);
+
+  // selects the engine used by this thread. The engine keeps its seed, so
+  // seed() should be called after changing the engine
+  void setEngine(RandomEngine engine);
+  inline RandomEngine engine() const { return engine_; }
+
 private:
+  // draws from dist using the selected engine
+  template <typename Distribution> inline double draw(Distribution &dist) {
+    if (engine_ == RandomEngine::Philox)
+      return dist(philox_);
+    return dist(generator_);
+  }
+
+  // drops any state cached by the distributions
+  void resetDistributions();
+
+  // fills out[0, n) with raw 32 bit engine output
+  void fillBits(std::uint32_t *out, unsigned n);
+
+  RandomEngine engine_;
   std::mt19937 generator_;
+  Philox4x32 philox_;
+
+  // last (seed, stream), used to derive events in setEvent()
+  unsigned seed_;
+  unsigned long long stream_;
 
   std::uniform_real_distribution<> unit_uniform_;
   std::uniform_real_distribution<> two_unit_uniform_;
   std::uniform_real_distribution<> two_unit_centered_uniform_;
   std::uniform_real_distribution<> zero_to_pi_;
+  std::gamma_distribution<> gamma_;
+  std::poisson_distribution<unsigned> poisson_;
+  std::binomial_distribution<unsigned> binomial_;
 
-  std::piecewise_linear_distribution<> unit_linear_;
+  // scratch space for the batch functions
+  std::vector<std::uint32_t> bits_;
+  std::vector<double> scratch_;
 
+  // copies are only made by ScopedRandomStream, to save & restore the state
+  // of a thread
+  friend class ScopedRandomStream;
   Random();
-  Random(const Random &);
+  Random(const Random &) = default;
+  Random &operator=(const Random &) = default;
+};
+
+// reseeds the calling thread's Random with the stream (seed, stream) of
+// engine for the lifetime of the object, and restores its previous engine &
+// state afterwards - so library code that needs a reproducible stream of its
+// own (like an MCGlauber chunk) does not change the random sequence of the
+// caller
+class ScopedRandomStream {
+public:
+  ScopedRandomStream(RandomEngine engine, unsigned seed,
+                     unsigned long long stream);
+  ~ScopedRandomStream();
+
+private:
+  Random saved_;
+
+  ScopedRandomStream(const ScopedRandomStream &);
 };
 } // namespace sct
 
@@ -1,9 +1,15 @@
 #include "sct/lib/logging.h"
+#include "sct/lib/math.h"
+#include "sct/utils/cdf_table.h"
 #include "sct/utils/random.h"
 
+#include <cmath>
+#include <vector>
+
 #include "benchmark/benchmark.h"
 
 #include "TF1.h"
+#include "TF3.h"
 #include "TH1.h"
 
 static void BM_random_sample(benchmark::State& state) {
@@ -36,8 +42,145 @@ static void BM_root_tf1_sample(benchmark::State& state) {
   delete f;
 }
 
+// the same distribution as BM_root_tf1_sample, sampled from a tabulated
+// inverse CDF
+static void BM_cdf_table_sample(benchmark::State& state) {
+  sct::CDFTable table([](double x) { return x; }, 0, 100);
+
+  double total = 0.0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(total += table.sample());
+  }
+}
+
+// batch sampling - state.range(0) is the batch size. Compare to single draws
+// of the same distribution with a batch size of 1
+static void BM_batch_uniform(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  std::vector<double> values(state.range(0));
+  for (auto _ : state) {
+    rand.uniform(values.data(), values.size());
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_single_uniform(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  std::vector<double> values(state.range(0));
+  for (auto _ : state) {
+    for (auto& val : values) val = rand.uniform();
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_batch_isotropic(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  std::vector<double> cos_theta(state.range(0));
+  std::vector<double> phi(state.range(0));
+  for (auto _ : state) {
+    rand.isotropic(cos_theta.data(), phi.data(), cos_theta.size());
+    benchmark::DoNotOptimize(cos_theta.data());
+    benchmark::DoNotOptimize(phi.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_single_isotropic(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  std::vector<double> cos_theta(state.range(0));
+  std::vector<double> phi(state.range(0));
+  for (auto _ : state) {
+    for (unsigned i = 0; i < cos_theta.size(); ++i) {
+      cos_theta[i] = rand.centeredUniform();
+      phi[i] = rand.zeroToPi() * 2.0 - sct::pi;
+    }
+    benchmark::DoNotOptimize(cos_theta.data());
+    benchmark::DoNotOptimize(phi.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_batch_impact_parameter(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  std::vector<double> values(state.range(0));
+  for (auto _ : state) {
+    rand.impactParameter(values.data(), values.size(), 0.0, 20.0);
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_batch_normal(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  std::vector<double> values(state.range(0));
+  for (auto _ : state) {
+    rand.normal(values.data(), values.size());
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the NBD of the multiplicity model, sampled directly and from the tabulated
+// histogram that NegativeBinomial used before
+static void BM_negative_binomial(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  unsigned total = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(total += rand.negativeBinomial(2.38, 2.0));
+  }
+}
+
+static void BM_root_th1_negative_binomial(benchmark::State& state) {
+  TH1D h("nbd_benchmark", "", 100, 0, 100);
+  for (int i = 0; i < 100; ++i)
+    h.SetBinContent(i + 1, std::pow(2.0 / 4.38, 2.0) * (i + 1) *
+                               std::pow(2.38 / 4.38, i));
+  unsigned total = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(total += static_cast<unsigned>(h.GetRandom()));
+  }
+}
+
+static void BM_batch_uniform_ball(benchmark::State& state) {
+  sct::Random& rand = sct::Random::instance();
+  std::vector<double> x(state.range(0));
+  std::vector<double> y(state.range(0));
+  std::vector<double> z(state.range(0));
+  for (auto _ : state) {
+    rand.uniformBall(x.data(), y.data(), z.data(), x.size(), 1.0);
+    benchmark::DoNotOptimize(x.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the nucleon smearing used before the native samplers: a uniform ball drawn
+// from a TF3 with GetRandom3
+static void BM_root_tf3_ball(benchmark::State& state) {
+  TF3 f("ball", "(x*x+y*y+z*z<1)", -1, 1, -1, 1, -1, 1);
+  double x, y, z;
+  for (auto _ : state) {
+    for (int i = 0; i < state.range(0); ++i)
+      f.GetRandom3(x, y, z);
+    benchmark::DoNotOptimize(x);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
 BENCHMARK(BM_random_sample)->Range(1e4, 1e6);
 BENCHMARK(BM_root_th1_sample)->Range(1e4, 1e6);
 BENCHMARK(BM_root_tf1_sample)->Range(1e4, 1e6);
+BENCHMARK(BM_cdf_table_sample)->Range(1e4, 1e6);
+BENCHMARK(BM_batch_uniform)->Range(1, 4096);
+BENCHMARK(BM_single_uniform)->Range(1, 4096);
+BENCHMARK(BM_batch_isotropic)->Range(1, 4096);
+BENCHMARK(BM_single_isotropic)->Range(1, 4096);
+BENCHMARK(BM_batch_impact_parameter)->Range(1, 4096);
+BENCHMARK(BM_batch_normal)->Range(1, 4096);
+BENCHMARK(BM_negative_binomial);
+BENCHMARK(BM_root_th1_negative_binomial);
+BENCHMARK(BM_batch_uniform_ball)->Range(1, 4096);
+BENCHMARK(BM_root_tf3_ball)->Range(1, 4096);
 
 BENCHMARK_MAIN();
@@ -1,8 +1,10 @@
 #include "sct/utils/random.h"
 #include "sct/lib/logging.h"
+#include "sct/lib/math.h"
 
 #include "gtest/gtest.h"
 
+#include <cmath>
 #include <future>
 #include <stdlib.h>
 #include <thread>
@@ -113,4 +115,210 @@ TEST(random, threaded) {
   EXPECT_EQ(result1, result2);
   EXPECT_EQ(result1, result3);
   EXPECT_NE(result3, result4);
-}
\ No newline at end of file
+}
+TEST(random, streams) {
+  sct::Random &random = sct::Random::instance();
+
+  random.seed(42, 7);
+  double first = random.uniform();
+  random.uniform();
+  random.seed(42, 7);
+  EXPECT_EQ(first, random.uniform());
+
+  random.seed(42, 8);
+  EXPECT_NE(first, random.uniform());
+  random.seed(43, 7);
+  EXPECT_NE(first, random.uniform());
+}
+
+TEST(random, philoxEvents) {
+  sct::Random &random = sct::Random::instance();
+  random.setEngine(sct::RandomEngine::Philox);
+
+  // an event's sequence only depends on (seed, stream, event)
+  random.seed(42, 7);
+  random.setEvent(1000);
+  double first = random.uniform();
+  double second = random.centeredUniform();
+
+  random.seed(42, 7);
+  for (int i = 0; i < 100; ++i)
+    random.uniform();
+  random.setEvent(999);
+  EXPECT_NE(first, random.uniform());
+  random.setEvent(1000);
+  EXPECT_EQ(first, random.uniform());
+  EXPECT_EQ(second, random.centeredUniform());
+
+  random.seed(42, 8);
+  random.setEvent(1000);
+  EXPECT_NE(first, random.uniform());
+
+  // the distributions are unchanged by the engine
+  unsigned n_throws = 1e6;
+  double counter = 0.0;
+  for (int i = 0; i < n_throws; ++i)
+    counter += random.linear();
+  EXPECT_NEAR(2.0 / 3.0, counter / n_throws, 1e-3);
+
+  random.setEngine(sct::RandomEngine::MT19937);
+}
+
+TEST(random, batchUniform) {
+  sct::Random &random = sct::Random::instance();
+  unsigned n = 1e6 + 3;
+  std::vector<double> values(n);
+  random.uniform(values.data(), n);
+  double sum = 0.0;
+  for (auto &val : values) {
+    EXPECT_LE(0.0, val);
+    EXPECT_GT(1.0, val);
+    sum += val;
+  }
+  EXPECT_NEAR(0.5, sum / n, 1e-3);
+}
+
+TEST(random, batchIsotropic) {
+  sct::Random &random = sct::Random::instance();
+  unsigned n = 1e6;
+  std::vector<double> cos_theta(n);
+  std::vector<double> phi(n);
+  random.isotropic(cos_theta.data(), phi.data(), n);
+  double sum_cos = 0.0;
+  double sum_cos2 = 0.0;
+  double sum_phi = 0.0;
+  for (unsigned i = 0; i < n; ++i) {
+    EXPECT_LE(-1.0, cos_theta[i]);
+    EXPECT_GT(1.0, cos_theta[i]);
+    EXPECT_LE(-sct::pi, phi[i]);
+    EXPECT_GT(sct::pi, phi[i]);
+    sum_cos += cos_theta[i];
+    sum_cos2 += cos_theta[i] * cos_theta[i];
+    sum_phi += phi[i];
+  }
+  EXPECT_NEAR(0.0, sum_cos / n, 2e-3);
+  EXPECT_NEAR(1.0 / 3.0, sum_cos2 / n, 2e-3);
+  EXPECT_NEAR(0.0, sum_phi / n, 5e-3);
+}
+
+TEST(random, batchImpactParameter) {
+  sct::Random &random = sct::Random::instance();
+  unsigned n = 1e6;
+  double b_min = 2.0;
+  double b_max = 10.0;
+  std::vector<double> b(n);
+  random.impactParameter(b.data(), n, b_min, b_max);
+  double sum = 0.0;
+  for (auto &val : b) {
+    EXPECT_LE(b_min, val);
+    EXPECT_GE(b_max, val);
+    sum += val;
+  }
+  // <b> = 2/3 (b_max^3 - b_min^3) / (b_max^2 - b_min^2)
+  double mean = 2.0 / 3.0 * (std::pow(b_max, 3) - std::pow(b_min, 3)) /
+                (b_max * b_max - b_min * b_min);
+  EXPECT_NEAR(mean, sum / n, 5e-3);
+}
+
+TEST(random, batchNormal) {
+  sct::Random &random = sct::Random::instance();
+  unsigned n = 1e6 + 1;
+  std::vector<double> values(n);
+  random.normal(values.data(), n, 1.0, 2.0);
+  double sum = 0.0;
+  double sum2 = 0.0;
+  for (auto &val : values) {
+    sum += val;
+    sum2 += val * val;
+  }
+  double mean = sum / n;
+  EXPECT_NEAR(1.0, mean, 5e-3);
+  EXPECT_NEAR(4.0, sum2 / n - mean * mean, 1e-2);
+}
+
+TEST(random, batchUniformBall) {
+  sct::Random &random = sct::Random::instance();
+  unsigned n = 1e6;
+  double radius = 1.5;
+  std::vector<double> x(n);
+  std::vector<double> y(n);
+  std::vector<double> z(n);
+  random.uniformBall(x.data(), y.data(), z.data(), n, radius);
+  double sum_x = 0.0;
+  double sum_r2 = 0.0;
+  unsigned inner = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    double r2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+    EXPECT_GE(radius * radius * (1.0 + 1e-12), r2);
+    sum_x += x[i];
+    sum_r2 += r2;
+    if (r2 < radius * radius / 4.0)
+      inner++;
+  }
+  // <r^2> = 3/5 R^2, and 1/8 of the volume is within R/2
+  EXPECT_NEAR(0.0, sum_x / n, 3e-3);
+  EXPECT_NEAR(0.6 * radius * radius, sum_r2 / n, 3e-3);
+  EXPECT_NEAR(0.125, (double)inner / n, 1e-3);
+}
+
+// a scoped stream gives the stream of (seed, stream), and the thread's own
+// sequence continues afterwards as if it had not been used
+TEST(random, scopedStream) {
+  sct::Random &random = sct::Random::instance();
+  random.setEngine(sct::RandomEngine::MT19937);
+  random.seed(42);
+  std::vector<double> expected;
+  for (int i = 0; i < 10; ++i)
+    expected.push_back(random.uniform());
+
+  random.seed(42);
+  for (int i = 0; i < 5; ++i)
+    EXPECT_EQ(random.uniform(), expected[i]);
+  std::vector<double> scoped;
+  {
+    sct::ScopedRandomStream stream(sct::RandomEngine::Philox, 7, 3);
+    EXPECT_EQ(random.engine(), sct::RandomEngine::Philox);
+    for (int i = 0; i < 5; ++i)
+      scoped.push_back(random.uniform());
+  }
+  EXPECT_EQ(random.engine(), sct::RandomEngine::MT19937);
+  for (int i = 5; i < 10; ++i)
+    EXPECT_EQ(random.uniform(), expected[i]);
+
+  random.setEngine(sct::RandomEngine::Philox);
+  random.seed(7, 3);
+  for (int i = 0; i < 5; ++i)
+    EXPECT_EQ(random.uniform(), scoped[i]);
+  random.setEngine(sct::RandomEngine::MT19937);
+}
+
+TEST(random, negativeBinomial) {
+  sct::Random &random = sct::Random::instance();
+  int n = 1e6;
+  double mean = 2.38;
+  double k = 2.0;
+  double sum = 0.0;
+  double sum2 = 0.0;
+  unsigned zeros = 0;
+  for (int i = 0; i < n; ++i) {
+    double value = random.negativeBinomial(mean, k);
+    sum += value;
+    sum2 += value * value;
+    if (value == 0)
+      zeros++;
+  }
+  double sample_mean = sum / n;
+  EXPECT_NEAR(mean, sample_mean, 5e-3);
+  EXPECT_NEAR(mean + mean * mean / k, sum2 / n - sample_mean * sample_mean,
+              3e-2);
+  // P(0) = (k / (mean + k))^k
+  EXPECT_NEAR(std::pow(k / (mean + k), k), (double)zeros / n, 2e-3);
+  EXPECT_EQ(random.negativeBinomial(0.0, k), 0);
+  EXPECT_EQ(random.poisson(0.0), 0);
+
+  // a non-positive k falls back to the poisson distribution
+  sum = 0.0;
+  for (int i = 0; i < n; ++i)
+    sum += random.negativeBinomial(mean, 0.0);
+  EXPECT_NEAR(mean, sum / n, 5.0 * sqrt(mean / n));
+}
@@ -0,0 +1,37 @@
+#include "sct/utils/root_random.h"
+#include "sct/utils/random.h"
+
+#include <mutex>
+
+namespace sct {
+
+RootRandom::RootRandom() : TRandom() {}
+
+RootRandom::~RootRandom() {}
+
+void RootRandom::install() {
+  static std::once_flag flag;
+  // the previous gRandom is left alive, since ROOT or the user may still hold
+  // a pointer to it
+  std::call_once(flag, []() { gRandom = new RootRandom(); });
+}
+
+Double_t RootRandom::Rndm() {
+  // ROOT generators never return exactly zero
+  double ret = 0.0;
+  while (ret == 0.0)
+    ret = Random::instance().uniform();
+  return ret;
+}
+
+void RootRandom::RndmArray(Int_t n, Double_t *array) {
+  for (Int_t i = 0; i < n; ++i)
+    array[i] = Rndm();
+}
+
+void RootRandom::RndmArray(Int_t n, Float_t *array) {
+  for (Int_t i = 0; i < n; ++i)
+    array[i] = Rndm();
+}
+
+} // namespace sct
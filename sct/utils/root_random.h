@@ -0,0 +1,35 @@
+#ifndef SCT_UTILS_ROOT_RANDOM_H
+#define SCT_UTILS_ROOT_RANDOM_H
+
+// ROOT's sampling routines (TF1::GetRandom, TF2::GetRandom2, TH1::GetRandom,
+// ...) draw from the global gRandom, which is shared between all threads and
+// is seeded independently of sct::Random. RootRandom is a TRandom that forwards
+// every draw to the calling thread's sct::Random, so that ROOT sampling is
+// thread safe and reproducible from the sct seeds.
+
+// to route ROOT through sct::Random, call RootRandom::install() once, in the
+// program's main() - it replaces gRandom for the remainder of the program.
+// The sct library does not install it itself.
+
+#include "TRandom.h"
+
+namespace sct {
+
+class RootRandom : public TRandom {
+public:
+  RootRandom();
+  virtual ~RootRandom();
+
+  // replaces gRandom with a RootRandom instance. Safe to call multiple times,
+  // and from multiple threads
+  static void install();
+
+  // samples (0, 1) from the calling thread's sct::Random
+  Double_t Rndm() override;
+  void RndmArray(Int_t n, Double_t *array) override;
+  void RndmArray(Int_t n, Float_t *array) override;
+};
+
+} // namespace sct
+
+#endif // SCT_UTILS_ROOT_RANDOM_H
@@ -0,0 +1,86 @@
+#include "sct/utils/thread_pool.h"
+
+namespace sct {
+
+namespace {
+// the pool and queue of the worker running on this thread, if any
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local unsigned current_queue = 0;
+} // namespace
+
+ThreadPool::ThreadPool(unsigned n_threads)
+    : next_queue_(0), queued_(0), stop_(false) {
+  if (n_threads == 0)
+    n_threads = std::thread::hardware_concurrency();
+  if (n_threads == 0)
+    n_threads = 1;
+
+  for (unsigned i = 0; i < n_threads; ++i)
+    queues_.push_back(make_unique<TaskQueue>());
+  for (unsigned i = 0; i < n_threads; ++i)
+    threads_.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stop_ = true;
+  }
+  available_.notify_all();
+  for (auto &thread : threads_)
+    thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  unsigned id = current_pool == this ? current_queue
+                                     : next_queue_++ % queues_.size();
+  // counted first, so queued_ never drops below the tasks in the queues
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    ++queued_;
+  }
+  {
+    std::lock_guard<std::mutex> guard(queues_[id]->lock);
+    queues_[id]->tasks.push_back(std::move(task));
+  }
+  available_.notify_one();
+}
+
+void ThreadPool::work(unsigned id) {
+  current_pool = this;
+  current_queue = id;
+
+  std::function<void()> task;
+  while (true) {
+    if (take(id, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    // a task counted in queued_ may not be in a queue yet - take() is retried
+    std::unique_lock<std::mutex> guard(lock_);
+    available_.wait(guard, [&]() { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ == 0)
+      return;
+  }
+}
+
+bool ThreadPool::take(unsigned id, std::function<void()> &task) {
+  for (unsigned i = 0; i < queues_.size(); ++i) {
+    TaskQueue &queue = *queues_[(id + i) % queues_.size()];
+    {
+      std::lock_guard<std::mutex> guard(queue.lock);
+      if (queue.tasks.empty())
+        continue;
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    --queued_;
+    return true;
+  }
+  return false;
+}
+
+} // namespace sct
@@ -0,0 +1,69 @@
+#ifndef SCT_UTILS_THREAD_POOL_H
+#define SCT_UTILS_THREAD_POOL_H
+
+// a fixed set of worker threads that run submitted tasks, shared by everything
+// that submits to it - for instance, the chunks of several MCGlauber runs
+// that are driven from different threads, so that no core idles while any run
+// has work left.
+
+// every worker has its own task queue. Tasks submitted from outside the pool
+// are spread over the queues in turn, and tasks submitted by a worker go to
+// its own queue. A worker runs the tasks of its own queue in order, and when
+// it is empty, steals the oldest task of another queue - so tasks start
+// roughly in submission order, and work moves to idle workers.
+
+// tasks must not throw: errors have to be passed back to the submitter, for
+// instance with a std::exception_ptr. The destructor runs all remaining tasks
+// before the workers are joined
+
+#include "sct/lib/memory.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sct {
+
+class ThreadPool {
+public:
+  // n_threads = 0 uses one worker per hardware thread
+  explicit ThreadPool(unsigned n_threads = 0);
+  ~ThreadPool();
+
+  // queues task to be run by one of the workers
+  void submit(std::function<void()> task);
+
+  inline unsigned size() const { return threads_.size(); }
+
+private:
+  struct TaskQueue {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void work(unsigned id);
+
+  // takes the oldest task of queue id, or of any other queue, starting with
+  // the queue after id. Returns false if all queues are empty
+  bool take(unsigned id, std::function<void()> &task);
+
+  std::vector<unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> threads_;
+
+  std::atomic<unsigned> next_queue_; // queue for the next outside submission
+
+  // tasks in the queues, and shutdown flag - workers sleep on available_ when
+  // there is nothing to take
+  std::mutex lock_;
+  std::condition_variable available_;
+  unsigned queued_;
+  bool stop_;
+};
+
+} // namespace sct
+
+#endif // SCT_UTILS_THREAD_POOL_H
@@ -0,0 +1,103 @@
+#include "sct/utils/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+// blocks each task until n different workers have started a task (or a
+// timeout passes), so that every worker has to take part - a worker that
+// holds a blocked task can not take the others
+class WorkerLatch {
+public:
+  explicit WorkerLatch(unsigned n) : n_(n) {}
+
+  void arrive() {
+    std::unique_lock<std::mutex> guard(lock_);
+    workers_.insert(std::this_thread::get_id());
+    all_started_.notify_all();
+    all_started_.wait_for(guard, std::chrono::seconds(10),
+                          [this]() { return workers_.size() >= n_; });
+  }
+
+  unsigned workers() {
+    std::lock_guard<std::mutex> guard(lock_);
+    return workers_.size();
+  }
+
+private:
+  unsigned n_;
+  std::mutex lock_;
+  std::condition_variable all_started_;
+  std::set<std::thread::id> workers_;
+};
+} // namespace
+
+// every task runs exactly once, and the destructor waits for all of them
+TEST(ThreadPool, runsAllTasks) {
+  int n_tasks = 10000;
+  std::vector<std::atomic<int>> runs(n_tasks);
+  for (auto &count : runs)
+    count = 0;
+
+  {
+    sct::ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    for (int i = 0; i < n_tasks; ++i)
+      pool.submit([&runs, i]() { runs[i]++; });
+  }
+
+  for (int i = 0; i < n_tasks; ++i)
+    EXPECT_EQ(runs[i], 1);
+}
+
+// tasks from several submitting threads are shared out over all workers
+TEST(ThreadPool, sharedBetweenSubmitters) {
+  WorkerLatch latch(4);
+  std::atomic<int> done(0);
+
+  sct::ThreadPool pool(4);
+  std::vector<std::thread> submitters;
+  for (int i = 0; i < 2; ++i) {
+    submitters.push_back(std::thread([&]() {
+      for (int j = 0; j < 20; ++j) {
+        pool.submit([&]() {
+          latch.arrive();
+          done++;
+        });
+      }
+    }));
+  }
+  for (auto &thread : submitters)
+    thread.join();
+  while (done < 40)
+    std::this_thread::yield();
+
+  EXPECT_EQ(latch.workers(), 4);
+}
+
+// tasks submitted by a worker all go to its own queue, and are stolen by the
+// idle workers
+TEST(ThreadPool, stealing) {
+  WorkerLatch latch(4);
+  std::atomic<int> done(0);
+  {
+    sct::ThreadPool pool(4);
+    pool.submit([&]() {
+      for (int i = 0; i < 40; ++i) {
+        pool.submit([&]() {
+          latch.arrive();
+          done++;
+        });
+      }
+    });
+  }
+  EXPECT_EQ(done, 40);
+  EXPECT_EQ(latch.workers(), 4);
+}